@@ -31,11 +31,23 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <stdlib.h>
+
 #include "Adafruit_GFX.h"
 #include "Adafruit_SSD1351.h"
 #include "glcdfont.h"
 #define pgm_read_byte(addr) (*(const unsigned char *)(addr))
 
+// expanded 6x8 glyphs in panel order, keyed by character and colors
+#define GLYPH_CACHE_SIZE 32
+typedef struct Glyph {
+  unsigned char c;
+  char valid;
+  unsigned int color, bg;
+  unsigned char pixels[6 * 8 * 2];
+} Glyph;
+static Glyph glyphCache[GLYPH_CACHE_SIZE];
+
 int cursor_x=0;
 int cursor_y=0;
 unsigned char textsize=1;
@@ -58,42 +70,56 @@ Adafruit_GFX(int w, int h):
 }
 */
 
-// Draw a circle outline
-void drawCircle(int x0, int y0, int r, unsigned int color) {
-  int f = 1 - r;
-  int ddF_x = 1;
-  int ddF_y = -2 * r;
-  int x = 0;
-  int y = r;
-
-  drawPixel(x0  , y0+r, color);
-  drawPixel(x0  , y0-r, color);
-  drawPixel(x0+r, y0  , color);
-  drawPixel(x0-r, y0  , color);
+// Span rasterizer: shapes hand their pixels and lines to addSpan() and any
+// span that extends the pending one into a bigger rectangle is joined with
+// it, so a run of pixels or equal columns costs one window instead of many.
+static int spanX, spanY, spanW = 0, spanH = 0;
+static unsigned int spanColor;
+
+static void flushSpans(void) {
+  if (spanW <= 0 || spanH <= 0) return;
+  // clip to the screen, the driver cuts rects crossing the far edges short
+  if (spanX < 0) { spanW += spanX; spanX = 0; }
+  if (spanY < 0) { spanH += spanY; spanY = 0; }
+  if (spanX + spanW > WIDTH) spanW = WIDTH - spanX;
+  if (spanY + spanH > HEIGHT) spanH = HEIGHT - spanY;
+  if (spanW > 0 && spanH > 0) {
+    if (spanW == 1 && spanH == 1)
+      drawPixel(spanX, spanY, spanColor);
+    else
+      fillRect(spanX, spanY, spanW, spanH, spanColor);
+  }
+  spanW = spanH = 0;
+}
 
-  while (x<y) {
-    if (f >= 0) {
-      y--;
-      ddF_y += 2;
-      f += ddF_y;
+static void addSpan(int x, int y, int w, int h, unsigned int color) {
+  if (w <= 0 || h <= 0) return;
+  if (spanW > 0 && color == spanColor) {
+    // same rows, touching on the left or right
+    if (y == spanY && h == spanH && (x == spanX + spanW || x + w == spanX)) {
+      if (x < spanX) spanX = x;
+      spanW += w;
+      return;
+    }
+    // same columns, touching above or below
+    if (x == spanX && w == spanW && (y == spanY + spanH || y + h == spanY)) {
+      if (y < spanY) spanY = y;
+      spanH += h;
+      return;
     }
-    x++;
-    ddF_x += 2;
-    f += ddF_x;
-  
-    drawPixel(x0 + x, y0 + y, color);
-    drawPixel(x0 - x, y0 + y, color);
-    drawPixel(x0 + x, y0 - y, color);
-    drawPixel(x0 - x, y0 - y, color);
-    drawPixel(x0 + y, y0 + x, color);
-    drawPixel(x0 - y, y0 + x, color);
-    drawPixel(x0 + y, y0 - x, color);
-    drawPixel(x0 - y, y0 - x, color);
   }
+  flushSpans();
+  spanX = x;
+  spanY = y;
+  spanW = w;
+  spanH = h;
+  spanColor = color;
 }
 
-void drawCircleHelper( int x0, int y0,
-               int r, unsigned char cornername, unsigned int color) {
+// Plots one octant of a circle, (sx, sy) picks the quadrant and swap
+// mirrors it across the diagonal. Consecutive points share a row (or a
+// column when swapped) and join into lines.
+static void circleOctant(int x0, int y0, int r, int sx, int sy, char swap, unsigned int color) {
   int f     = 1 - r;
   int ddF_x = 1;
   int ddF_y = -2 * r;
@@ -109,41 +135,69 @@ void drawCircleHelper( int x0, int y0,
     x++;
     ddF_x += 2;
     f     += ddF_x;
-    if (cornername & 0x4) {
-      drawPixel(x0 + x, y0 + y, color);
-      drawPixel(x0 + y, y0 + x, color);
-    } 
-    if (cornername & 0x2) {
-      drawPixel(x0 + x, y0 - y, color);
-      drawPixel(x0 + y, y0 - x, color);
-    }
-    if (cornername & 0x8) {
-      drawPixel(x0 - y, y0 + x, color);
-      drawPixel(x0 - x, y0 + y, color);
-    }
-    if (cornername & 0x1) {
-      drawPixel(x0 - y, y0 - x, color);
-      drawPixel(x0 - x, y0 - y, color);
-    }
+    if (swap)
+      addSpan(x0 + sx*y, y0 + sy*x, 1, 1, color);
+    else
+      addSpan(x0 + sx*x, y0 + sy*y, 1, 1, color);
+  }
+}
+
+// Draw a circle outline
+void drawCircle(int x0, int y0, int r, unsigned int color) {
+  // each axis point leads into the octant next to it
+  addSpan(x0  , y0+r, 1, 1, color);
+  circleOctant(x0, y0, r,  1,  1, 0, color);
+  addSpan(x0+r, y0  , 1, 1, color);
+  circleOctant(x0, y0, r,  1,  1, 1, color);
+  addSpan(x0  , y0-r, 1, 1, color);
+  circleOctant(x0, y0, r,  1, -1, 0, color);
+  addSpan(x0-r, y0  , 1, 1, color);
+  circleOctant(x0, y0, r, -1, -1, 1, color);
+  circleOctant(x0, y0, r, -1,  1, 0, color);
+  circleOctant(x0, y0, r,  1, -1, 1, color);
+  circleOctant(x0, y0, r, -1,  1, 1, color);
+  circleOctant(x0, y0, r, -1, -1, 0, color);
+  flushSpans();
+}
+
+void drawCircleHelper( int x0, int y0,
+               int r, unsigned char cornername, unsigned int color) {
+  if (cornername & 0x4) {
+    circleOctant(x0, y0, r,  1,  1, 0, color);
+    circleOctant(x0, y0, r,  1,  1, 1, color);
+  }
+  if (cornername & 0x2) {
+    circleOctant(x0, y0, r,  1, -1, 0, color);
+    circleOctant(x0, y0, r,  1, -1, 1, color);
   }
+  if (cornername & 0x8) {
+    circleOctant(x0, y0, r, -1,  1, 1, color);
+    circleOctant(x0, y0, r, -1,  1, 0, color);
+  }
+  if (cornername & 0x1) {
+    circleOctant(x0, y0, r, -1, -1, 1, color);
+    circleOctant(x0, y0, r, -1, -1, 0, color);
+  }
+  flushSpans();
 }
 
 void fillCircle(int x0, int y0, int r,
 			      unsigned int color) {
-  drawFastVLine(x0, y0-r, 2*r+1, color);
+  addSpan(x0, y0-r, 1, 2*r+1, color);
   fillCircleHelper(x0, y0, r, 3, 0, color);
 }
 
-// Used to do circles and roundrects
-void fillCircleHelper(int x0, int y0, int r,
-    unsigned char cornername, int delta, unsigned int color) {
-
+// Emits the columns of one side of a filled circle, sx is 1 for the right
+// side and -1 for the left, moving outwards from the center
+static void circleColumns(int x0, int y0, int r, int sx, int delta, unsigned int color) {
   int f     = 1 - r;
   int ddF_x = 1;
   int ddF_y = -2 * r;
   int x     = 0;
   int y     = r;
+  int col = -1, half = 0;
 
+  // inner columns, one per step
   while (x<y) {
     if (f >= 0) {
       y--;
@@ -153,16 +207,37 @@ void fillCircleHelper(int x0, int y0, int r,
     x++;
     ddF_x += 2;
     f     += ddF_x;
+    addSpan(x0+sx*x, y0-y, 1, 2*y+1+delta, color);
+  }
 
-    if (cornername & 0x1) {
-      drawFastVLine(x0+x, y0-y, 2*y+1+delta, color);
-      drawFastVLine(x0+y, y0-x, 2*x+1+delta, color);
-    }
-    if (cornername & 0x2) {
-      drawFastVLine(x0-x, y0-y, 2*y+1+delta, color);
-      drawFastVLine(x0-y, y0-x, 2*x+1+delta, color);
+  // outer columns repeat until y steps, only the tallest one is drawn
+  f = 1 - r; ddF_x = 1; ddF_y = -2 * r; x = 0; y = r;
+  while (x<y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f     += ddF_y;
     }
+    x++;
+    ddF_x += 2;
+    f     += ddF_x;
+    if (col != y && col >= 0)
+      addSpan(x0+sx*col, y0-half, 1, 2*half+1+delta, color);
+    col = y;
+    half = x;
   }
+  if (col >= 0)
+    addSpan(x0+sx*col, y0-half, 1, 2*half+1+delta, color);
+}
+
+// Used to do circles and roundrects
+void fillCircleHelper(int x0, int y0, int r,
+    unsigned char cornername, int delta, unsigned int color) {
+  if (cornername & 0x1)
+    circleColumns(x0, y0, r, 1, delta, color);
+  if (cornername & 0x2)
+    circleColumns(x0, y0, r, -1, delta, color);
+  flushSpans();
 }
 
 // Bresenham's algorithm - thx wikpedia
@@ -196,9 +271,9 @@ void drawLine(int x0, int y0, int x1, int y1, unsigned int color) {
 
   for (; x0<=x1; x0++) {
     if (steep) {
-      drawPixel(y0, x0, color);
+      addSpan(y0, x0, 1, 1, color);
     } else {
-      drawPixel(x0, y0, color);
+      addSpan(x0, y0, 1, 1, color);
     }
     err -= dy;
     if (err < 0) {
@@ -206,6 +281,7 @@ void drawLine(int x0, int y0, int x1, int y1, unsigned int color) {
       err += dx;
     }
   }
+  flushSpans();
 }
 
 // Draw a rectangle
@@ -264,7 +340,7 @@ void drawRoundRect(int x, int y, int w,
 void fillRoundRect(int x, int y, int w,
 				 int h, int r, unsigned int color) {
   // smarter version
-  fillRect(x+r, y, w-2*r, h, color);
+  addSpan(x+r, y, w-2*r, h, color);
 
   // draw four corners
   fillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color);
@@ -286,13 +362,7 @@ void fillTriangle ( int x0, int y0,
 				  int x2, int y2, unsigned int color) {
 
   int a, b, y, last;
-  int
-    dx01 = x1 - x0,
-    dy01 = y1 - y0,
-    dx02 = x2 - x0,
-    dy02 = y2 - y0,
-    dx12 = x2 - x1,
-    dy12 = y2 - y1;
+  int dx01, dy01, dx02, dy02, dx12, dy12;
   int
     sa   = 0,
     sb   = 0;						
@@ -314,10 +384,19 @@ void fillTriangle ( int x0, int y0,
     else if(x1 > b) b = x1;
     if(x2 < a)      a = x2;
     else if(x2 > b) b = x2;
-    drawFastHLine(a, y0, b-a+1, color);
+    addSpan(a, y0, b-a+1, 1, color);
+    flushSpans();
     return;
   }
 
+  // edges of the sorted corners
+  dx01 = x1 - x0;
+  dy01 = y1 - y0;
+  dx02 = x2 - x0;
+  dy02 = y2 - y0;
+  dx12 = x2 - x1;
+  dy12 = y2 - y1;
+
 
 
   // For upper part of triangle, find scanline crossings for segments
@@ -339,7 +418,7 @@ void fillTriangle ( int x0, int y0,
     b = x0 + (x2 - x0) * (y - y0) / (y2 - y0);
     */
     if(a > b) swap(a,b);
-    drawFastHLine(a, y, b-a+1, color);
+    addSpan(a, y, b-a+1, 1, color);
   }
 
   // For lower part of triangle, find scanline crossings for segments
@@ -356,8 +435,9 @@ void fillTriangle ( int x0, int y0,
     b = x0 + (x2 - x0) * (y - y0) / (y2 - y0);
     */
     if(a > b) swap(a,b);
-    drawFastHLine(a, y, b-a+1, color);
+    addSpan(a, y, b-a+1, 1, color);
   }
+  flushSpans();
 }
 
 //Draw XBitMap Files (*.xbm), exported from GIMP,
@@ -439,40 +519,80 @@ void write(unsigned char c) {
 #endif
 }
 */
+// Expands a character into the cache, or returns the copy already there
+static const unsigned char *getGlyph(unsigned char c, unsigned int color, unsigned int bg) {
+  Glyph *g = &glyphCache[c % GLYPH_CACHE_SIZE];
+  unsigned char line, *p;
+  char i, j;
+
+  if (g->valid && g->c == c && g->color == color && g->bg == bg)
+    return g->pixels;
+
+  for (i=0; i<6; i++ ) {
+    line = (i == 5) ? 0x0 : font[(c*5)+i];
+    p = &g->pixels[i * 2];
+    for (j = 0; j<8; j++) {
+      unsigned int pix = (line & 0x1) ? color : bg;
+      p[0] = pix >> 8;
+      p[1] = pix;
+      p += 6 * 2; // next row
+      line >>= 1;
+    }
+  }
+  g->c = c;
+  g->color = color;
+  g->bg = bg;
+  g->valid = 1;
+  return g->pixels;
+}
+
 // Draw a character
 void drawChar(int x, int y, unsigned char c,
 			    unsigned int color, unsigned int bg, unsigned char size) {
 
-  unsigned char line;	
-  char i;						
-  char j;						
-						
+  unsigned char line;
+  char i;
+  char j, start;
+  int left, right, top, bottom;
+
   if((x >= WIDTH)            || // Clip right
      (y >= HEIGHT)           || // Clip bottom
      ((x + 6 * size - 1) < 0) || // Clip left
      ((y + 8 * size - 1) < 0))   // Clip top
     return;
 
+  // opaque default size text goes out as one 6x8 window
+  if (size == 1 && bg != color) {
+    drawImage(x, y, 6, 8, getGlyph(c, color, bg));
+    return;
+  }
+
+  // otherwise draw each column as runs of same colored pixels, clipped
+  // here because the driver only clips the far edges and cuts them short
   for (i=0; i<6; i++ ) {
-    if (i == 5) 
+    if (i == 5)
       line = 0x0;
-    else 
+    else
       line = font[(c*5)+i];
-    for (j = 0; j<8; j++) {
-      if (line & 0x1) {
-        if (size == 1) // default size
-          drawPixel(x+i, y+j, color);
-        else {  // big size
-          fillRect(x+(i*size), y+(j*size), size, size, color);
-        } 
-      } else if (bg != color) {
-        if (size == 1) // default size
-          drawPixel(x+i, y+j, bg);
-        else {  // big size
-          fillRect(x+i*size, y+j*size, size, size, bg);
-        }
+    left = x + i*size;
+    right = left + size;
+    if (left < 0) left = 0;
+    if (right > WIDTH) right = WIDTH;
+    for (j = 0; j<8; ) {
+      char set = line & 0x1;
+      start = j;
+      while (j < 8 && (line & 0x1) == set) {
+        line >>= 1;
+        j++;
       }
-      line >>= 1;
+      if (!set && bg == color) // transparent background
+        continue;
+      top = y + start*size;
+      bottom = y + j*size;
+      if (top < 0) top = 0;
+      if (bottom > HEIGHT) bottom = HEIGHT;
+      if (left < right && top < bottom)
+        fillRect(left, top, right - left, bottom - top, set ? color : bg);
     }
   }
 }
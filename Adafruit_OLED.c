@@ -21,13 +21,22 @@
 #include "pin_mux_config.h"
 
 #include "Adafruit_SSD1351.h"
+#include "framebuffer.h"
+#include "spi_dma.h"
 
 // flush buffer variable
 static unsigned long buf;
 
+// one uDMA transfer worth of a single color, rebuilt when the color changes
+#define FILL_PATTERN_SIZE DMA_MAX_TRANSFER
+static unsigned char fillPattern[FILL_PATTERN_SIZE];
+static unsigned int fillPatternColor;
+static char fillPatternValid = 0;
+
 //*****************************************************************************
 
 void writeCommand(unsigned char c) {
+    spiDmaWait();                          // queued transfers own the bus until done
     GPIOPinWrite(GPIOA3_BASE, 0x10, 0x00); // sets DC
     MAP_SPICSEnable(GSPI_BASE);            // enable internal chip select
     GPIOPinWrite(GPIOA1_BASE, 0x80, 0x00); // enable OC
@@ -39,6 +48,7 @@ void writeCommand(unsigned char c) {
 //*****************************************************************************
 
 void writeData(unsigned char c) {
+    spiDmaWait();                          // queued transfers own the bus until done
     GPIOPinWrite(GPIOA3_BASE, 0x10, 0xff); // sets DC
     MAP_SPICSEnable(GSPI_BASE);            // enable the internal chip select
     GPIOPinWrite(GPIOA1_BASE, 0x80, 0x00); // enable OC
@@ -48,6 +58,65 @@ void writeData(unsigned char c) {
     MAP_SPICSDisable(GSPI_BASE);           // disable the internal chip select
 }
 
+//*****************************************************************************
+// Streaming writes: DC, CS and OC are driven once for a whole payload and the
+// bytes are clocked out back to back, instead of toggling all three per byte.
+
+static void beginTransfer(unsigned char dc) {
+    GPIOPinWrite(GPIOA3_BASE, 0x10, dc);   // sets DC for the whole burst
+    MAP_SPICSEnable(GSPI_BASE);            // enable internal chip select
+    GPIOPinWrite(GPIOA1_BASE, 0x80, 0x00); // enable OC
+}
+
+static void transferByte(unsigned char c) {
+    MAP_SPIDataPut(GSPI_BASE, c);          // send the byte over SPI
+    MAP_SPIDataGet(GSPI_BASE, &buf);       // flush, also waits for the byte to shift out
+}
+
+static void endTransfer(void) {
+    GPIOPinWrite(GPIOA1_BASE, 0x80, 0xff); // sets OC
+    MAP_SPICSDisable(GSPI_BASE);           // disable the internal chip select
+}
+
+// sends a command followed by its parameter bytes as a single data burst
+static void writeCommandData(unsigned char c, unsigned char d0, unsigned char d1) {
+    writeCommand(c);
+    beginTransfer(0xff);
+    transferByte(d0);
+    transferByte(d1);
+    endTransfer();
+}
+
+// sets the RAM window to (x, y, w, h) and leaves the bus open for pixel data,
+// every beginWindow() must be closed by an endWindow()
+void beginWindow(int x, int y, int w, int h) {
+    writeCommandData(SSD1351_CMD_SETCOLUMN, x, x+w-1);
+    writeCommandData(SSD1351_CMD_SETROW, y, y+h-1);
+    writeCommand(SSD1351_CMD_WRITERAM);
+    beginTransfer(0xff);
+}
+
+// pushes the same color count times into the open window
+void pushColor(unsigned int color, unsigned long count) {
+    unsigned char hi = color >> 8, lo = color;
+    while (count--) {
+        transferByte(hi);
+        transferByte(lo);
+    }
+}
+
+// pushes count pixels that are already in panel order (high byte first)
+void pushPixels(const unsigned char *pixels, unsigned long count) {
+    count *= 2;
+    while (count--) {
+        transferByte(*pixels++);
+    }
+}
+
+void endWindow(void) {
+    endTransfer();
+}
+
 //*****************************************************************************
 void Adafruit_Init(void) {
 
@@ -163,7 +232,47 @@ unsigned int Color565(unsigned char r, unsigned char g, unsigned char b) {
 }
 
 void fillScreen(unsigned int fillcolor) {
-  fillRect(0, 0, SSD1351WIDTH, SSD1351HEIGHT, fillcolor);
+  fillRectFast(0, 0, SSD1351WIDTH, SSD1351HEIGHT, fillcolor);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Fills a rectangle by repeating a prebuilt color pattern on the
+            uDMA, a full screen goes out as one window and 32 transfers.
+            With the framebuffer on, only full screen clears skip it
+*/
+/**************************************************************************/
+void fillRectFast(int x, int y, int w, int h, unsigned int fillcolor)
+{
+  unsigned int i;
+
+  if (isFrameBufferEnabled()) {
+    if (x > 0 || y > 0 || x + w < SSD1351WIDTH || y + h < SSD1351HEIGHT) {
+      fbFillRect(x, y, w, h, fillcolor);
+      return;
+    }
+    fbFillScreen(fillcolor);
+  }
+
+  // clip to the screen
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > SSD1351WIDTH) w = SSD1351WIDTH - x;
+  if (y + h > SSD1351HEIGHT) h = SSD1351HEIGHT - y;
+  if (w <= 0 || h <= 0) return;
+
+  if (!fillPatternValid || fillPatternColor != fillcolor) {
+    spiDmaWait(); // the old pattern may still be going out
+    for (i = 0; i < FILL_PATTERN_SIZE; i += 2) {
+      fillPattern[i] = fillcolor >> 8;
+      fillPattern[i + 1] = fillcolor;
+    }
+    fillPatternColor = fillcolor;
+    fillPatternValid = 1;
+  }
+
+  spiDmaQueueWindow(x, y, w, h);
+  spiDmaQueueRepeat(DMA_DATA, fillPattern, FILL_PATTERN_SIZE, (unsigned long) w * h * 2);
 }
 
 /**************************************************************************/
@@ -173,7 +282,10 @@ void fillScreen(unsigned int fillcolor) {
 /**************************************************************************/
 void fillRect(unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int fillcolor)
 {
-  unsigned int i;
+  if (isFrameBufferEnabled()) {
+    fbFillRect(x, y, w, h, fillcolor);
+    return;
+  }
 
   // Bounds check
   if ((x >= SSD1351WIDTH) || (y >= SSD1351HEIGHT))
@@ -191,25 +303,19 @@ void fillRect(unsigned int x, unsigned int y, unsigned int w, unsigned int h, un
     w = SSD1351WIDTH - x - 1;
   }
 
-  // set location
-  writeCommand(SSD1351_CMD_SETCOLUMN);
-  writeData(x);
-  writeData(x+w-1);
-  writeCommand(SSD1351_CMD_SETROW);
-  writeData(y);
-  writeData(y+h-1);
-  // fill!
-  writeCommand(SSD1351_CMD_WRITERAM);
-
-  for (i=0; i < w*h; i++) {
-    writeData(fillcolor >> 8);
-    writeData(fillcolor);
-  }
+  // set location and fill!
+  beginWindow(x, y, w, h);
+  pushColor(fillcolor, (unsigned long) w*h);
+  endWindow();
 }
 
 void drawFastVLine(int x, int y, int h, unsigned int color) {
 
-  unsigned int i;
+  if (isFrameBufferEnabled()) {
+    fbFillRect(x, y, 1, h, color);
+    return;
+  }
+
   // Bounds check
   if ((x >= SSD1351WIDTH) || (y >= SSD1351HEIGHT))
 	return;
@@ -222,27 +328,21 @@ void drawFastVLine(int x, int y, int h, unsigned int color) {
 
   if (h < 0) return;
 
-  // set location
-  writeCommand(SSD1351_CMD_SETCOLUMN);
-  writeData(x);
-  writeData(x);
-  writeCommand(SSD1351_CMD_SETROW);
-  writeData(y);
-  writeData(y+h-1);
-  // fill!
-  writeCommand(SSD1351_CMD_WRITERAM);
-
-  for (i=0; i < h; i++) {
-    writeData(color >> 8);
-    writeData(color);
-  }
+  // set location and fill!
+  beginWindow(x, y, 1, h);
+  pushColor(color, h);
+  endWindow();
 }
 
 
 
 void drawFastHLine(int x, int y, int w, unsigned int color) {
 
-  unsigned int i;
+  if (isFrameBufferEnabled()) {
+    fbFillRect(x, y, w, 1, color);
+    return;
+  }
+
   // Bounds check
   if ((x >= SSD1351WIDTH) || (y >= SSD1351HEIGHT))
 	return;
@@ -255,34 +355,55 @@ void drawFastHLine(int x, int y, int w, unsigned int color) {
 
   if (w < 0) return;
 
-  // set location
-  writeCommand(SSD1351_CMD_SETCOLUMN);
-  writeData(x);
-  writeData(x+w-1);
-  writeCommand(SSD1351_CMD_SETROW);
-  writeData(y);
-  writeData(y);
-  // fill!
-  writeCommand(SSD1351_CMD_WRITERAM);
-
-  for (i=0; i < w; i++) {
-    writeData(color >> 8);
-    writeData(color);
-  }
+  // set location and fill!
+  beginWindow(x, y, w, 1);
+  pushColor(color, w);
+  endWindow();
 }
 
 
 
 
+// draws a w x h block of pixels in panel order (high byte first) as one
+// window, clipped to the screen
+void drawImage(int x, int y, int w, int h, const unsigned char *pixels)
+{
+  int j, skipX = 0, skipY = 0, stride = w * 2;
+
+  if (isFrameBufferEnabled()) {
+    fbBlit(x, y, w, h, pixels);
+    return;
+  }
+
+  // clip to the screen
+  if (x < 0) { skipX = -x; w += x; x = 0; }
+  if (y < 0) { skipY = -y; h += y; y = 0; }
+  if (x + w > SSD1351WIDTH) w = SSD1351WIDTH - x;
+  if (y + h > SSD1351HEIGHT) h = SSD1351HEIGHT - y;
+  if (w <= 0 || h <= 0) return;
+
+  pixels += skipY * stride + skipX * 2;
+  beginWindow(x, y, w, h);
+  for (j = 0; j < h; j++) {
+    pushPixels(pixels, w);
+    pixels += stride;
+  }
+  endWindow();
+}
+
 void drawPixel(int x, int y, unsigned int color)
 {
+  if (isFrameBufferEnabled()) {
+    fbFillRect(x, y, 1, 1, color);
+    return;
+  }
+
   if ((x >= SSD1351WIDTH) || (y >= SSD1351HEIGHT)) return;
   if ((x < 0) || (y < 0)) return;
 
-  goTo(x, y);
-
-  writeData(color >> 8);
-  writeData(color);
+  beginWindow(x, y, 1, 1);
+  pushColor(color, 1);
+  endWindow();
 }
 
 
@@ -98,8 +98,10 @@ class Adafruit_SSD1351  : public virtual Adafruit_GFX {
   // drawing primitives!
   void drawPixel(int x, int y, unsigned int color);
   void fillRect(unsigned int x0, unsigned int y0, unsigned int w, unsigned int h, unsigned int color);
+  void fillRectFast(int x, int y, int w, int h, unsigned int color);
   void drawFastHLine(int x, int y, int w, unsigned int color);
   void drawFastVLine(int x, int y, int h, unsigned int color);
+  void drawImage(int x, int y, int w, int h, const unsigned char *pixels);
   void fillScreen(unsigned int fillcolor);
 
   void invert(char);
@@ -114,6 +116,12 @@ class Adafruit_SSD1351  : public virtual Adafruit_GFX {
   void writeData(unsigned char d);
   void writeCommand(unsigned char c);
 
+  // streaming window writes, CS and DC stay asserted until endWindow()
+  void beginWindow(int x, int y, int w, int h);
+  void pushColor(unsigned int color, unsigned long count);
+  void pushPixels(const unsigned char *pixels, unsigned long count);
+  void endWindow(void);
+
 
   void writeData_unsafe(unsigned int d);
 
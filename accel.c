@@ -0,0 +1,87 @@
+/*
+ * accel.c
+ *
+ *  Timer driven accelerometer sampling with a moving average filter
+ */
+
+#include <stdbool.h>
+
+// Driverlib includes
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "hw_ints.h"
+#include "rom.h"
+#include "rom_map.h"
+#include "prcm.h"
+#include "interrupt.h"
+#include "timer.h"
+
+// Common interface includes
+#include "i2c_if.h"
+#include "timer_if.h"
+
+#include "accel.h"
+
+static AccelSample queue[ACCEL_QUEUE_SIZE];
+static volatile unsigned int head = 0, tail = 0; // ISR pushes at head, game pops at tail
+static volatile unsigned long dropped = 0;
+
+// filter state, only touched by the game side
+static AccelSample window[ACCEL_FILTER_LEN];
+static int sumX = 0, sumY = 0;
+static unsigned int filled = 0, next = 0;
+
+void InitAccel(void) {
+    head = tail = 0;
+    Timer_IF_Init(PRCM_TIMERA1, TIMERA1_BASE, TIMER_CFG_PERIODIC, TIMER_A, 0);
+    Timer_IF_IntSetup(TIMERA1_BASE, TIMER_A, AccelIntHandler);
+    MAP_IntPrioritySet(INT_TIMERA1A, ACCEL_INT_PRIORITY); // Timer_IF_IntSetup leaves it at level 1
+    Timer_IF_Start(TIMERA1_BASE, TIMER_A, ACCEL_SAMPLE_MS);
+}
+
+// The I2C read is blocking and runs here. At 400 kHz the write of the
+// register pointer, the repeated start and three bytes take about 56 bit
+// times, ~140 us, so the handler holds the CPU for ~150 us every
+// ACCEL_SAMPLE_MS. A NACK ends the burst early. Its priority keeps the
+// SPI DMA end of transfer and the sound timer from waiting on it
+void AccelIntHandler(void) {
+    unsigned char reg = ACCEL_X_REG, buf[3];
+
+    Timer_IF_InterruptClear(TIMERA1_BASE);
+    // X MSB, Y LSB, Y MSB in one transaction
+    if (I2C_IF_ReadFrom(ACCEL_DEV, &reg, 1, buf, 3) < 0) return;
+
+    if (head - tail >= ACCEL_QUEUE_SIZE) { // game fell behind, keep the older samples
+        dropped++;
+        return;
+    }
+    queue[head % ACCEL_QUEUE_SIZE].x = (signed char) buf[0];
+    queue[head % ACCEL_QUEUE_SIZE].y = (signed char) buf[2];
+    head++; // publish after the sample is written
+}
+
+bool accelPop(AccelSample *sample) {
+    if (tail == head) return false;
+    *sample = queue[tail % ACCEL_QUEUE_SIZE];
+    tail++;
+    return true;
+}
+
+void accelTilt(int *x, int *y) {
+    AccelSample sample;
+
+    while (accelPop(&sample)) {
+        AccelSample *old = &window[next];
+        sumX += sample.x - old->x; // old is zero until the window fills
+        sumY += sample.y - old->y;
+        *old = sample;
+        next = (next + 1) % ACCEL_FILTER_LEN;
+        if (filled < ACCEL_FILTER_LEN) filled++;
+    }
+    *x = filled ? sumX / (int) filled : 0;
+    *y = filled ? sumY / (int) filled : 0;
+}
+
+unsigned long accelDropped(void) {
+    return dropped;
+}
@@ -0,0 +1,34 @@
+/*
+ * accel.h
+ *
+ *  Background BMA222 sampling. TIMERA1 fires every ACCEL_SAMPLE_MS and its
+ *  handler reads both axes in one I2C burst into a single producer, single
+ *  consumer ring. The game drains the ring when it wants input and gets a
+ *  moving average instead of one noisy reading.
+ */
+
+#ifndef ACCEL_H_
+#define ACCEL_H_
+
+#include <stdbool.h>
+
+#define ACCEL_DEV        0x18 // BMA222 address
+#define ACCEL_X_REG      0x03 // X MSB, Y MSB is two registers further
+#define ACCEL_SAMPLE_MS  10
+#define ACCEL_QUEUE_SIZE 16   // samples, power of two
+#define ACCEL_FILTER_LEN 8    // samples averaged, power of two
+// below the SPI DMA and the sound timer, both preempt the I2C burst
+#define ACCEL_INT_PRIORITY INT_PRIORITY_LVL_2
+
+typedef struct AccelSample {
+    signed char x, y;
+} AccelSample;
+
+void InitAccel(void);
+void AccelIntHandler(void);
+
+bool accelPop(AccelSample *sample);
+void accelTilt(int *x, int *y); // drains the ring, returns the filtered axes
+unsigned long accelDropped(void); // samples lost to a full ring
+
+#endif /* ACCEL_H_ */
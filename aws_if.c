@@ -3,6 +3,7 @@
 
 // standard includes
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 
 // Simplelink includes
@@ -524,27 +525,43 @@ static int set_time() {
     return SUCCESS;
 }
 
+static SlSockAddrIn_t serverAddr; // resolved once, reconnects skip the DNS lookup
+static bool serverResolved = false;
+
+static int resolveServer() {
+    unsigned int uiIP;
+    long lRetVal = -1;
+
+    if (serverResolved) {
+        return SUCCESS;
+    }
+    lRetVal = sl_NetAppDnsGetHostByName(g_Host, strlen((const char *)g_Host),
+                                    (unsigned long*)&uiIP, SL_AF_INET);
+
+    if(lRetVal < 0) {
+        return printErrConvenience("Device couldn't retrieve the host name \n\r", lRetVal);
+    }
+
+    serverAddr.sin_family = SL_AF_INET;
+    serverAddr.sin_port = sl_Htons(GOOGLE_DST_PORT);
+    serverAddr.sin_addr.s_addr = sl_Htonl(uiIP);
+    serverResolved = true;
+    return SUCCESS;
+}
+
 //*****************************************************************************
 //
-//! This function demonstrates how certificate can be used with SSL.
-//! The procedure includes the following steps:
-//! 1) connect to an open AP
-//! 2) get the server name via a DNS request
-//! 3) define all socket options and point to the CA certificate
-//! 4) connect to the server via TCP
+//! Opens a secure socket with the TLS method, cipher and certificates set,
+//! not connected yet
 //!
-//! \param None
+//! \param nonBlocking - sl_Connect returns SL_EALREADY until the handshake
+//!                      is done instead of waiting for it
 //!
-//! \return  0 on success else error code
-//! \return  LED1 is turned solid in case of success
-//!    LED2 is turned solid in case of failure
+//! \return  socket on success else error code
 //!
 //*****************************************************************************
-static int tls_connect() {
-    SlSockAddrIn_t    Addr;
-    int    iAddrSize;
+static int tls_socket(bool nonBlocking) {
     unsigned char    ucMethod = SL_SO_SEC_METHOD_TLSV1_2;
-    unsigned int uiIP;
 //    unsigned int uiCipher = SL_SEC_MASK_TLS_ECDHE_RSA_WITH_AES_256_CBC_SHA;
     unsigned int uiCipher = SL_SEC_MASK_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256;
 // SL_SEC_MASK_SSL_RSA_WITH_RC4_128_SHA
@@ -557,20 +574,10 @@ static int tls_connect() {
 // SL_SEC_MASK_TLS_RSA_WITH_AES_256_CBC_SHA256
 // SL_SEC_MASK_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256
 // SL_SEC_MASK_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256 // does not work (-340, handshake fails)
+    SlSockNonblocking_t nonBlockingOption;
     long lRetVal = -1;
     int iSockID;
 
-    lRetVal = sl_NetAppDnsGetHostByName(g_Host, strlen((const char *)g_Host),
-                                    (unsigned long*)&uiIP, SL_AF_INET);
-
-    if(lRetVal < 0) {
-        return printErrConvenience("Device couldn't retrieve the host name \n\r", lRetVal);
-    }
-
-    Addr.sin_family = SL_AF_INET;
-    Addr.sin_port = sl_Htons(GOOGLE_DST_PORT);
-    Addr.sin_addr.s_addr = sl_Htonl(uiIP);
-    iAddrSize = sizeof(SlSockAddrIn_t);
     //
     // opens a secure socket
     //
@@ -585,6 +592,7 @@ static int tls_connect() {
     lRetVal = sl_SetSockOpt(iSockID, SL_SOL_SOCKET, SL_SO_SECMETHOD, &ucMethod,\
                                sizeof(ucMethod));
     if(lRetVal < 0) {
+        sl_Close(iSockID);
         return printErrConvenience("Device couldn't set socket options \n\r", lRetVal);
     }
     //
@@ -593,6 +601,7 @@ static int tls_connect() {
     lRetVal = sl_SetSockOpt(iSockID, SL_SOL_SOCKET, SL_SO_SECURE_MASK, &uiCipher,\
                            sizeof(uiCipher));
     if(lRetVal < 0) {
+        sl_Close(iSockID);
         return printErrConvenience("Device couldn't set socket options \n\r", lRetVal);
     }
 
@@ -609,6 +618,7 @@ static int tls_connect() {
                            strlen(SL_SSL_CA_CERT));
 
     if(lRetVal < 0) {
+        sl_Close(iSockID);
         return printErrConvenience("Device couldn't set socket options \n\r", lRetVal);
     }
 // END: COMMENT THIS OUT IF DISABLING SERVER VERIFICATION
@@ -623,6 +633,7 @@ static int tls_connect() {
                            strlen(SL_SSL_CLIENT));
 
     if(lRetVal < 0) {
+        sl_Close(iSockID);
         return printErrConvenience("Device couldn't set socket options \n\r", lRetVal);
     }
 
@@ -634,13 +645,22 @@ static int tls_connect() {
                            strlen(SL_SSL_PRIVATE));
 
     if(lRetVal < 0) {
+        sl_Close(iSockID);
         return printErrConvenience("Device couldn't set socket options \n\r", lRetVal);
     }
 
+    nonBlockingOption.NonblockingEnabled = nonBlocking;
+    lRetVal = sl_SetSockOpt(iSockID, SL_SOL_SOCKET, SL_SO_NONBLOCKING, \
+                            &nonBlockingOption, sizeof(nonBlockingOption));
+    if(lRetVal < 0) {
+        sl_Close(iSockID);
+        return printErrConvenience("Device couldn't set socket options \n\r", lRetVal);
+    }
+    return iSockID;
+}
 
-    /* connect to the peer device - Google server */
-    lRetVal = sl_Connect(iSockID, ( SlSockAddr_t *)&Addr, iAddrSize);
-
+// prints the outcome of sl_Connect, returns false when it failed
+static bool tls_connected(long lRetVal) {
     if(lRetVal >= 0) {
         UART_PRINT("Device has connected to the website:");
         UART_PRINT(SERVER_NAME);
@@ -655,11 +675,50 @@ static int tls_connect() {
         UART_PRINT("Device couldn't connect to server:");
         UART_PRINT(SERVER_NAME);
         UART_PRINT("\n\r");
-        return printErrConvenience("Device couldn't connect to server \n\r", lRetVal);
+        printErrConvenience("Device couldn't connect to server \n\r", lRetVal);
+        return false;
     }
 
     GPIO_IF_LedOff(MCU_RED_LED_GPIO);
     GPIO_IF_LedOn(MCU_GREEN_LED_GPIO);
+    return true;
+}
+
+//*****************************************************************************
+//
+//! This function demonstrates how certificate can be used with SSL.
+//! The procedure includes the following steps:
+//! 1) connect to an open AP
+//! 2) get the server name via a DNS request
+//! 3) define all socket options and point to the CA certificate
+//! 4) connect to the server via TCP
+//!
+//! \param None
+//!
+//! \return  0 on success else error code
+//! \return  LED1 is turned solid in case of success
+//!    LED2 is turned solid in case of failure
+//!
+//*****************************************************************************
+static int tls_connect() {
+    long lRetVal = -1;
+    int iSockID;
+
+    lRetVal = resolveServer();
+    if(lRetVal < 0) {
+        return lRetVal;
+    }
+    iSockID = tls_socket(false);
+    if(iSockID < 0) {
+        return iSockID;
+    }
+
+    /* connect to the peer device - Google server */
+    lRetVal = sl_Connect(iSockID, ( SlSockAddr_t *)&serverAddr, sizeof(SlSockAddrIn_t));
+    if(!tls_connected(lRetVal)) {
+        sl_Close(iSockID);
+        return lRetVal;
+    }
     return iSockID;
 }
 
@@ -724,111 +783,26 @@ int connectToAccessPoint() {
 }
 
 
-// method that creates a GET request based
-// and sends it to the given TLS port
-static char* http_get(int iTLSSockID){
-    char acSendBuff[512];
-    static char acRecvbuff[1460];
-    char* pcBufHeaders;
-    int lRetVal = 0;
-
-    // add the headers to the request
-    pcBufHeaders = acSendBuff;
-    strcpy(pcBufHeaders, GETHEADER);
-    pcBufHeaders += strlen(GETHEADER);
-    strcpy(pcBufHeaders, HOSTHEADER);
-    pcBufHeaders += strlen(HOSTHEADER);
-    strcpy(pcBufHeaders, CHEADER);
-    pcBufHeaders += strlen(CHEADER);
-    strcpy(pcBufHeaders, "\r\n\r\n");
-
-    //
-    // Send the packet to the server */
-    //
-    lRetVal = sl_Send(iTLSSockID, acSendBuff, strlen(acSendBuff), 0);
-    if(lRetVal < 0) {
-        sl_Close(iTLSSockID);
-        GPIO_IF_LedOn(MCU_RED_LED_GPIO);
-        return "";
-    }
-    lRetVal = sl_Recv(iTLSSockID, &acRecvbuff[0], sizeof(acRecvbuff), SL_MSG_DONTWAIT);
-    if(lRetVal < 0 && lRetVal != -11) {
+// method that queues the constant GET request on the HTTP session
+static bool http_get(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg){
+    if (!httpSend(GET_REQUEST, sizeof(GET_REQUEST) - 1, onBody, onDone, arg)) {
         GPIO_IF_LedOn(MCU_RED_LED_GPIO);
-        return "";
-    } else if(lRetVal == -11) {
-        sprintf(acRecvbuff, "%s", "POLL");
-    } else {
-        acRecvbuff[lRetVal+1] = '\0';
+        return false;
     }
-
-    return acRecvbuff;
+    return true;
 }
 
-// method that creates a POST request based on the string
-// and sends it to the given TLS port
-static char* http_post(int iTLSSockID, char *text){
-    char acSendBuff[512];
-    static char acRecvbuff[1460];
-    char cCLLength[200];
-    char* pcBufHeaders;
-    int lRetVal = 0;
-
-    // construct the headers
-    pcBufHeaders = acSendBuff;
-    strcpy(pcBufHeaders, POSTHEADER);
-    pcBufHeaders += strlen(POSTHEADER);
-    strcpy(pcBufHeaders, HOSTHEADER);
-    pcBufHeaders += strlen(HOSTHEADER);
-    strcpy(pcBufHeaders, CHEADER);
-    pcBufHeaders += strlen(CHEADER);
-    strcpy(pcBufHeaders, "\r\n\r\n");
-
-    // get the entire data length
-    int dataLength = strlen(DATA_PREF) + strlen((const char *) text) + strlen(DATA_SUFF);
-
-    strcpy(pcBufHeaders, CTHEADER);
-    pcBufHeaders += strlen(CTHEADER);
-    strcpy(pcBufHeaders, CLHEADER1);
-
-    // add the data length to the headers
-    pcBufHeaders += strlen(CLHEADER1);
-    sprintf(cCLLength, "%d", dataLength);
-
-    strcpy(pcBufHeaders, cCLLength);
-    pcBufHeaders += strlen(cCLLength);
-    strcpy(pcBufHeaders, CLHEADER2);
-    pcBufHeaders += strlen(CLHEADER2);
-
-    // append the data to the request
-    strcpy(pcBufHeaders, DATA_PREF);
-    pcBufHeaders += strlen(DATA_PREF);
-    strcpy(pcBufHeaders, (const char *) text);
-    pcBufHeaders += strlen((const char *) text);
-    strcpy(pcBufHeaders, DATA_SUFF);
-    pcBufHeaders += strlen(DATA_SUFF);
-
-    int testDataLength = strlen(pcBufHeaders);
+// method that closes the request built by buildRequest and
+// queues it on the HTTP session
+static bool http_post(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg){
+    const char *request;
+    int length = finishRequest(&request);
 
-    //
-    // Send the packet to the server */
-    //
-    lRetVal = sl_Send(iTLSSockID, acSendBuff, strlen(acSendBuff), 0);
-    if(lRetVal < 0) {
-        sl_Close(iTLSSockID);
+    if (!httpSend(request, length, onBody, onDone, arg)) {
         GPIO_IF_LedOn(MCU_RED_LED_GPIO);
-        return "";
+        return false;
     }
-    lRetVal = sl_Recv(iTLSSockID, &acRecvbuff[0], sizeof(acRecvbuff), SL_MSG_DONTWAIT);
-    if(lRetVal < 0 && lRetVal != -11) {
-        GPIO_IF_LedOn(MCU_RED_LED_GPIO);
-        return "";
-    } else if(lRetVal == -11) {
-        sprintf(acRecvbuff, "%s", "POLL");
-    } else {
-        acRecvbuff[lRetVal+1] = '\0';
-    }
-
-    return 0;
+    return true;
 }
 
 // return value and TLS port variable
@@ -848,6 +822,10 @@ void networkConnect(void) {
     accessReturnVal = tls_connect();
     if(accessReturnVal < 0) {
         ERR_PRINT(accessReturnVal);
+    } else {
+#if ENABLE_MQTT != 1
+        httpOpen(accessReturnVal);
+#endif
     }
 }
 
@@ -856,41 +834,115 @@ void networkKill(void) {
     sl_Stop(SL_STOP_TIMEOUT);
 }
 
-static bool firstElem = true;
-static char emptyString[] = "";
-static char *newRequest = "";
-// send the string over with TLS encryption
-void buildRequest(char *var, char *text) {
-    if(firstElem) {
-        sprintf(newRequest, "%s\"%s\": \"%s\"", newRequest, var, text);
-        firstElem = false;
-    } else {
-        sprintf(newRequest, "%s,\r\n\"%s\": \"%s\"", newRequest, var, text);
+bool sendRequest(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg) {
+    return http_post(onBody, onDone, arg);
+}
+
+bool receiveString(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg) {
+    return http_get(onBody, onDone, arg);
+}
+
+#if ENABLE_MQTT == 1
+static MqttCallback listenCallback;
+static void *listenArg;
+static int retryWait = 0;                    // polls until the next reconnect
+static int retryPolls = RETRY_FIRST_POLLS;   // doubles after every failure
+static int connectingSocket = -1;            // socket whose TLS handshake is running
+static int connectPolls = 0;                 // polls spent on that handshake
+
+static bool startSession(void) {
+    return mqttConnect(accessReturnVal, THING_NAME, listenCallback, listenArg) &&
+           mqttSubscribe(UPDATE_ACCEPTED) &&
+           mqttSubscribe(GET_ACCEPTED) &&
+           mqttPublish(GET_TOPIC, "", 0);
+}
+
+bool networkListen(MqttCallback onMessage, void *arg) {
+    listenCallback = onMessage;
+    listenArg = arg;
+    if (accessReturnVal < 0 || !startSession()) {
+        printErrConvenience("MQTT session failed, retrying \n\r", accessReturnVal);
+        retryWait = retryPolls;
+        return false;
     }
+    return true;
 }
 
-char* sendRequest(void) {
-    static char *returnVal;
-    returnVal = http_post(accessReturnVal, newRequest);
-    strcpy(newRequest, emptyString);
-    firstElem = true;
-    return returnVal;
+// the next reconnect waits twice as long, up to RETRY_MAX_POLLS
+static void retryLater(const char *msg) {
+    printErrConvenience((char *) msg, accessReturnVal);
+    retryWait = retryPolls;
+    retryPolls = retryPolls * 2 > RETRY_MAX_POLLS ? RETRY_MAX_POLLS : retryPolls * 2;
 }
 
-char* receiveString(void) {
-    return http_get(accessReturnVal);
+// opens a new TLS socket once the backoff ran out and then steps its
+// handshake once per poll, so the frame loop never waits on the server
+static void reconnect(void) {
+    SlSockNonblocking_t nonBlockingOption;
+    long lRetVal;
+
+    if (connectingSocket < 0) {
+        if (retryWait > 0) {
+            retryWait--;
+            return;
+        }
+        if (accessReturnVal >= 0) {
+            sl_Close(accessReturnVal);
+            accessReturnVal = -1;
+        }
+        if (resolveServer() < 0 || (connectingSocket = tls_socket(true)) < 0) {
+            retryLater("MQTT reconnect failed \n\r");
+            return;
+        }
+        connectPolls = 0;
+    }
+
+    lRetVal = sl_Connect(connectingSocket, (SlSockAddr_t *) &serverAddr, sizeof(SlSockAddrIn_t));
+    if (lRetVal == SL_EALREADY && ++connectPolls < RETRY_CONNECT_POLLS) {
+        return; // handshake still running
+    }
+    if (lRetVal == SL_EALREADY || !tls_connected(lRetVal)) {
+        sl_Close(connectingSocket);
+        connectingSocket = -1;
+        retryLater("MQTT reconnect failed \n\r");
+        return;
+    }
+
+    // the session sends with plain blocking writes like the first socket
+    nonBlockingOption.NonblockingEnabled = 0;
+    sl_SetSockOpt(connectingSocket, SL_SOL_SOCKET, SL_SO_NONBLOCKING,
+                  &nonBlockingOption, sizeof(nonBlockingOption));
+    accessReturnVal = connectingSocket;
+    connectingSocket = -1;
+    if (!startSession()) {
+        retryLater("MQTT reconnect failed \n\r");
+        return;
+    }
+    UART_PRINT("MQTT session reopened \n\r");
 }
 
-char* networkReceive(void) {
-    static char acRecvbuff[1460];
-    int lRetVal = sl_Recv(accessReturnVal, &acRecvbuff[0], sizeof(acRecvbuff), SL_MSG_DONTWAIT);
-    if(lRetVal < 0 && lRetVal != -11) {
-        GPIO_IF_LedOn(MCU_RED_LED_GPIO);
-        return "";
-    } else if(lRetVal == -11) {
-        sprintf(acRecvbuff, "%s", "POLL");
-    } else {
-        acRecvbuff[lRetVal+1] = '\0';
+bool publishRequest(void) {
+    const char *body;
+    int length;
+    if (!requestStarted()) {
+        return false;
+    }
+    length = finishBody(&body); // dropped when the session is down, everything is sent again once it is back
+    return mqttConnected() && mqttPublish(UPDATE_TOPIC, body, length);
+}
+#endif
+
+void networkReceive(void) {
+#if ENABLE_MQTT == 1
+    if (!mqttAlive()) {
+        reconnect();
+        return;
     }
-    return acRecvbuff;
+    mqttPoll();
+    if (mqttConnected()) {
+        retryPolls = RETRY_FIRST_POLLS; // the broker took us, start over with short waits
+    }
+#else
+    httpPoll();
+#endif
 }
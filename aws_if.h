@@ -8,13 +8,23 @@
 #ifndef AWS_IF_H_
 #define AWS_IF_H_
 
+#include <stdbool.h>
+
+#include "http.h"
+#include "mqtt.h"
+#include "request.h"
+
 #define MAX_URI_SIZE 128
 #define URI_SIZE MAX_URI_SIZE + 1
 
 #define APPLICATION_NAME        "SSL"
 #define APPLICATION_VERSION     "1.1.1.EEC.Spring2018"
 #define SERVER_NAME             "a1euv4eww1wx8z-ats.iot.us-west-2.amazonaws.com"
+#if ENABLE_MQTT == 1
+#define GOOGLE_DST_PORT         MQTT_PORT
+#else
 #define GOOGLE_DST_PORT         8443
+#endif
 
 #define SL_SSL_CA_CERT "/cert/ca.pem" //starfield class2 rootca (from firefox) // <-- this one works
 #define SL_SSL_PRIVATE "/cert/private.key"
@@ -31,16 +41,16 @@
 
 #define ZEROCHAR '0'
 
-#define POSTHEADER "POST /things/CC3200_Thing/shadow HTTP/1.1\r\n"
-#define GETHEADER "GET /things/CC3200_Thing/shadow HTTP/1.1\r\n"
-#define HOSTHEADER "Host: a1euv4eww1wx8z-ats.iot.us-west-2.amazonaws.com\r\n"
-#define CHEADER "Connection: Keep-Alive\r\n"
-#define CTHEADER "Content-Type: application/json; charset=utf-8\r\n"
-#define CLHEADER1 "Content-Length: "
-#define CLHEADER2 "\r\n\r\n"
-
-#define DATA_PREF "{\"state\": {\r\n\"desired\" : {\r\n"
-#define DATA_SUFF "\r\n}}}\r\n\r\n"
+// the same shadow over MQTT, the accepted topics echo the whole document
+#define THING_NAME          "CC3200_Thing"
+#define SHADOW_TOPIC        "$aws/things/" THING_NAME "/shadow/"
+#define UPDATE_TOPIC        SHADOW_TOPIC "update"
+#define UPDATE_ACCEPTED     SHADOW_TOPIC "update/accepted"
+#define GET_TOPIC           SHADOW_TOPIC "get"
+#define GET_ACCEPTED        SHADOW_TOPIC "get/accepted"
+#define RETRY_FIRST_POLLS   30   // ~1 s before the first reconnect
+#define RETRY_MAX_POLLS     1800 // backoff stops growing at ~1 min
+#define RETRY_CONNECT_POLLS 450  // ~15 s for a reconnect's TLS handshake
 
 // Application specific status/error codes
 typedef enum {
@@ -70,18 +80,30 @@ typedef struct {
 static long WlanConnect();
 static int set_time();
 static long InitializeAppVariables();
+static int resolveServer();
+static int tls_socket(bool nonBlocking);
+static bool tls_connected(long lRetVal);
 static int tls_connect();
 static int connectToAccessPoint();
-static char* http_get(int iTLSSockID);
-static char* http_post(int iTLSSockID, char *text);
+static bool http_get(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg);
+static bool http_post(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg);
 
 // "public" function prototypes
 void networkConnect(void);
 void networkKill(void);
-void buildRequest(char *var, char *text);
-char* sendRequest(void);
-char* receiveString(void);
-char* networkReceive(void);
+// queue the POST built so far or the GET on the session, both can be in
+// flight at once and the callbacks run from networkReceive
+bool sendRequest(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg);
+bool receiveString(HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg);
+#if ENABLE_MQTT == 1
+// subscribes to the shadow documents and asks for the current one, a
+// failure is printed and the session is retried from networkReceive
+bool networkListen(MqttCallback onMessage, void *arg);
+// publishes the update built so far, dropped when nothing was built
+bool publishRequest(void);
+#endif
+// polls the session, call it every frame
+void networkReceive(void);
 
 
 long printErrConvenience(char * msg, long retVal);
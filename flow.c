@@ -0,0 +1,84 @@
+/*
+ * flow.c
+ *
+ *  Incremental breadth first search over the maze tiles
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "map.h"
+#include "flow.h"
+
+void flowReset(FlowField *flow) {
+    flow->ready = false;
+    flow->building = false;
+    flow->front = 0;
+    flow->wantX = flow->wantY = -1;
+    flow->targetX = flow->targetY = -1;
+}
+
+void flowTarget(FlowField *flow, int tx, int ty) {
+    flow->wantX = tx;
+    flow->wantY = ty;
+}
+
+static void startBuild(FlowField *flow) {
+    unsigned char (*next)[MAP_SIZE] = flow->dist[!flow->front];
+
+    memset(next, FLOW_UNREACHABLE, sizeof(flow->dist[0]));
+    flow->targetX = flow->wantX;
+    flow->targetY = flow->wantY;
+    next[flow->targetY][flow->targetX] = 0;
+    flow->queue[0] = flow->targetY * MAP_SIZE + flow->targetX;
+    flow->head = 0;
+    flow->tail = 1;
+    flow->building = true;
+}
+
+static void visit(FlowField *flow, unsigned char (*next)[MAP_SIZE], int tx, int ty, unsigned char d) {
+    if (tx < 0 || ty < 0 || tx >= MAP_SIZE || ty >= MAP_SIZE) return;
+    if (IS_WALL(tx, ty) || next[ty][tx] != FLOW_UNREACHABLE) return;
+    next[ty][tx] = d;
+    flow->queue[flow->tail++] = ty * MAP_SIZE + tx;
+}
+
+void flowUpdate(FlowField *flow) {
+    unsigned char (*next)[MAP_SIZE];
+    int cells, tx, ty;
+    unsigned char d;
+
+    if (!flow->building) {
+        // only start over when the target moved, or nothing was ever built
+        if (flow->wantX < 0 || (flow->ready && flow->wantX == flow->targetX && flow->wantY == flow->targetY)) {
+            return;
+        }
+        if (IS_WALL(flow->wantX, flow->wantY)) return;
+        startBuild(flow);
+    }
+
+    next = flow->dist[!flow->front];
+    for (cells = 0; cells < FLOW_CELLS_PER_TICK && flow->head < flow->tail; cells++) {
+        tx = flow->queue[flow->head] % MAP_SIZE;
+        ty = flow->queue[flow->head] / MAP_SIZE;
+        flow->head++;
+        d = next[ty][tx] < FLOW_UNREACHABLE - 1 ? next[ty][tx] + 1 : FLOW_UNREACHABLE - 1;
+        visit(flow, next, tx, ty - 1, d);
+        visit(flow, next, tx - 1, ty, d);
+        visit(flow, next, tx + 1, ty, d);
+        visit(flow, next, tx, ty + 1, d);
+    }
+
+    if (flow->head == flow->tail) { // done, swap it in
+        flow->front = !flow->front;
+        flow->ready = true;
+        flow->building = false;
+    }
+}
+
+unsigned char flowDistance(const FlowField *flow, int tx, int ty) {
+    if (!flow->ready || tx < 0 || ty < 0 || tx >= MAP_SIZE || ty >= MAP_SIZE) {
+        return FLOW_UNREACHABLE;
+    }
+    return flow->dist[flow->front][ty][tx];
+}
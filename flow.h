@@ -0,0 +1,37 @@
+/*
+ * flow.h
+ *
+ *  Distance field toward a target tile, shared by every baddie. The field
+ *  is rebuilt with a breadth first search that only expands
+ *  FLOW_CELLS_PER_TICK tiles per call to flowUpdate(), so a rebuild is
+ *  spread over a few ticks. Baddies keep reading the last finished field
+ *  while the next one is being built.
+ */
+
+#ifndef FLOW_H_
+#define FLOW_H_
+
+#include <stdbool.h>
+
+#include "map.h"
+
+#define FLOW_CELLS_PER_TICK 96   // the maze has under 400 open tiles, so about 4 ticks per field
+#define FLOW_UNREACHABLE    0xFF
+
+typedef struct FlowField {
+    unsigned char dist[2][MAP_SIZE][MAP_SIZE]; // finished field and the one being built
+    unsigned short queue[MAP_SIZE * MAP_SIZE]; // tiles as ty * MAP_SIZE + tx
+    unsigned short head, tail;
+    unsigned char front;      // index of the finished field
+    bool ready;               // front holds a finished field
+    bool building;
+    int targetX, targetY;     // target of the field being built
+    int wantX, wantY;         // latest target asked for
+} FlowField;
+
+void flowReset(FlowField *flow);
+void flowTarget(FlowField *flow, int tx, int ty); // picked up once the current build is done
+void flowUpdate(FlowField *flow);
+unsigned char flowDistance(const FlowField *flow, int tx, int ty); // steps to the target
+
+#endif /* FLOW_H_ */
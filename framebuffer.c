@@ -0,0 +1,246 @@
+/*
+ * framebuffer.c
+ *
+ *  Off-screen RGB565 framebuffer with dirty-rectangle flushing
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "framebuffer.h"
+#include "spi_dma.h"
+
+typedef struct DirtyRect {
+    int x0, y0; // inclusive
+    int x1, y1; // exclusive
+} DirtyRect;
+
+// pixels are kept in panel order (high byte first) so rows can be pushed as is
+static unsigned char frameBuffer[HEIGHT][WIDTH * 2];
+static DirtyRect dirty[FB_MAX_DIRTY];
+static int dirtyCount = 0;
+static DirtyRect queued[FB_MAX_DIRTY]; // framebuffer rects the DMA may still read
+static int queuedCount = 0;
+static unsigned char bounce[FB_BOUNCE_SIZE]; // partial rows packed for the DMA
+static int bounceUsed = 0;                   // bytes the DMA may still read
+static bool enabled = false;
+
+void setFrameBuffer(bool enable) {
+    enabled = enable;
+    dirtyCount = 0;
+}
+
+bool isFrameBufferEnabled(void) {
+    return enabled;
+}
+
+static long area(int x0, int y0, int x1, int y1) {
+    return (long) (x1 - x0) * (y1 - y0);
+}
+
+// pixels that merging would resend without need, negative when they overlap
+static long mergeCost(DirtyRect *r, int x0, int y0, int x1, int y1) {
+    long joined = area(r->x0 < x0 ? r->x0 : x0, r->y0 < y0 ? r->y0 : y0,
+                       r->x1 > x1 ? r->x1 : x1, r->y1 > y1 ? r->y1 : y1);
+    return joined - area(r->x0, r->y0, r->x1, r->y1) - area(x0, y0, x1, y1);
+}
+
+static void absorb(DirtyRect *r, int x0, int y0, int x1, int y1) {
+    if (x0 < r->x0) r->x0 = x0;
+    if (y0 < r->y0) r->y0 = y0;
+    if (x1 > r->x1) r->x1 = x1;
+    if (y1 > r->y1) r->y1 = y1;
+}
+
+// adds a rect to a list, merging while the grown rect is cheap to join
+// with another one, or into the one that grows the least once it is full
+static void addRect(DirtyRect *rects, int *count, int x0, int y0, int x1, int y1) {
+    int i, best;
+    bool merged = true;
+    long cost, bestCost;
+
+    while (merged) {
+        merged = false;
+        for (i = 0; i < *count; i++) {
+            if (mergeCost(&rects[i], x0, y0, x1, y1) <= FB_MERGE_SLACK) {
+                if (rects[i].x0 < x0) x0 = rects[i].x0;
+                if (rects[i].y0 < y0) y0 = rects[i].y0;
+                if (rects[i].x1 > x1) x1 = rects[i].x1;
+                if (rects[i].y1 > y1) y1 = rects[i].y1;
+                rects[i] = rects[--*count];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (*count < FB_MAX_DIRTY) {
+        rects[(*count)++] = (DirtyRect) { x0, y0, x1, y1 };
+        return;
+    }
+
+    best = 0;
+    bestCost = mergeCost(&rects[0], x0, y0, x1, y1);
+    for (i = 1; i < *count; i++) {
+        cost = mergeCost(&rects[i], x0, y0, x1, y1);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = i;
+        }
+    }
+    absorb(&rects[best], x0, y0, x1, y1);
+}
+
+void fbMarkDirty(int x, int y, int w, int h) {
+    int x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+    // clip to the screen
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > WIDTH) x1 = WIDTH;
+    if (y1 > HEIGHT) y1 = HEIGHT;
+    if (x0 >= x1 || y0 >= y1) return;
+    addRect(dirty, &dirtyCount, x0, y0, x1, y1);
+}
+
+// waits for the last flush when the clipped rect covers rows it still reads
+static void waitForRows(int x0, int y0, int x1, int y1) {
+    int i;
+    if (queuedCount == 0) {
+        return;
+    }
+    if (!spiDmaBusy()) {
+        queuedCount = 0;
+        return;
+    }
+    for (i = 0; i < queuedCount; i++) {
+        if (x0 < queued[i].x1 && queued[i].x0 < x1 && y0 < queued[i].y1 && queued[i].y0 < y1) {
+            spiDmaWait();
+            queuedCount = 0;
+            return;
+        }
+    }
+}
+
+void fbFillRect(int x, int y, int w, int h, unsigned int color) {
+    int i, j;
+    unsigned char hi = color >> 8, lo = color;
+
+    // clip to the screen
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > WIDTH) w = WIDTH - x;
+    if (y + h > HEIGHT) h = HEIGHT - y;
+    if (w <= 0 || h <= 0) return;
+    waitForRows(x, y, x + w, y + h);
+
+    // build the first row, then copy it down
+    for (i = 0; i < w; i++) {
+        frameBuffer[y][(x + i) * 2] = hi;
+        frameBuffer[y][(x + i) * 2 + 1] = lo;
+    }
+    for (j = y + 1; j < y + h; j++) {
+        memcpy(&frameBuffer[j][x * 2], &frameBuffer[y][x * 2], w * 2);
+    }
+    fbMarkDirty(x, y, w, h);
+}
+
+// a flush still going out may send some rows in the new color, the clear
+// queued after it covers them anyway, so nothing waits for it here
+void fbFillScreen(unsigned int color) {
+    int i, j;
+
+    for (i = 0; i < WIDTH; i++) {
+        frameBuffer[0][i * 2] = color >> 8;
+        frameBuffer[0][i * 2 + 1] = color;
+    }
+    for (j = 1; j < HEIGHT; j++) {
+        memcpy(frameBuffer[j], frameBuffer[0], WIDTH * 2);
+    }
+    dirtyCount = 0;
+}
+
+// copies a w x h block of panel order pixels, clipped to the screen
+void fbBlit(int x, int y, int w, int h, const unsigned char *pixels) {
+    int j, skipX = 0, skipY = 0, stride = w * 2;
+
+    if (x < 0) { skipX = -x; w += x; x = 0; }
+    if (y < 0) { skipY = -y; h += y; y = 0; }
+    if (x + w > WIDTH) w = WIDTH - x;
+    if (y + h > HEIGHT) h = HEIGHT - y;
+    if (w <= 0 || h <= 0) return;
+    waitForRows(x, y, x + w, y + h);
+
+    pixels += skipY * stride + skipX * 2;
+    for (j = y; j < y + h; j++) {
+        memcpy(&frameBuffer[j][x * 2], pixels, w * 2);
+        pixels += stride;
+    }
+    fbMarkDirty(x, y, w, h);
+}
+
+// joins the two dirty rects that waste the fewest pixels together
+static void mergeCheapest(void) {
+    int i, j, bestI = 0, bestJ = 1;
+    long cost, bestCost = -1;
+    for (i = 0; i < dirtyCount; i++) {
+        for (j = i + 1; j < dirtyCount; j++) {
+            cost = mergeCost(&dirty[i], dirty[j].x0, dirty[j].y0, dirty[j].x1, dirty[j].y1);
+            if (bestCost < 0 || cost < bestCost) {
+                bestCost = cost;
+                bestI = i;
+                bestJ = j;
+            }
+        }
+    }
+    absorb(&dirty[bestI], dirty[bestJ].x0, dirty[bestJ].y0, dirty[bestJ].x1, dirty[bestJ].y1);
+    dirty[bestJ] = dirty[--dirtyCount];
+}
+
+// queues the dirty rects on the SPI DMA and returns right away, the next
+// frame only waits for the transfer if it draws over a rect still going out.
+// Every rect is one window and one data descriptor, partial rows are packed
+// into the bounce buffer, so a flush never waits for free descriptors
+unsigned long flushFrame(void) {
+    int i, j, w, h, fit;
+    unsigned long sent = 0;
+    unsigned char *packed;
+
+    fit = spiDmaFree() / FB_RECT_DESCS;
+    if (dirtyCount == 0 || fit == 0) {
+        return 0; // the rects stay dirty and go out with the next frame
+    }
+    while (dirtyCount > fit) {
+        mergeCheapest();
+    }
+    if (!spiDmaBusy()) { // nothing reads the buffers anymore
+        queuedCount = 0;
+        bounceUsed = 0;
+    }
+
+    for (i = 0; i < dirtyCount; i++) {
+        w = dirty[i].x1 - dirty[i].x0;
+        h = dirty[i].y1 - dirty[i].y0;
+        if (w < WIDTH && bounceUsed + w * h * 2 > FB_BOUNCE_SIZE) {
+            dirty[i].x0 = 0; // no room to pack it, send whole rows instead
+            dirty[i].x1 = w = WIDTH;
+        }
+        spiDmaQueueWindow(dirty[i].x0, dirty[i].y0, w, h);
+        if (w == WIDTH) { // full rows are contiguous in the buffer
+            spiDmaQueue(DMA_DATA, frameBuffer[dirty[i].y0], (unsigned long) w * h * 2, NULL, NULL);
+            addRect(queued, &queuedCount, dirty[i].x0, dirty[i].y0, dirty[i].x1, dirty[i].y1);
+        } else { // the copy is what goes out, the rect can be drawn over right away
+            packed = &bounce[bounceUsed];
+            for (j = dirty[i].y0; j < dirty[i].y1; j++) {
+                memcpy(&bounce[bounceUsed], &frameBuffer[j][dirty[i].x0 * 2], w * 2);
+                bounceUsed += w * 2;
+            }
+            spiDmaQueue(DMA_DATA, packed, (unsigned long) w * h * 2, NULL, NULL);
+        }
+        sent += (unsigned long) w * h * 2;
+    }
+    dirtyCount = 0;
+    return sent;
+}
@@ -0,0 +1,31 @@
+/*
+ * framebuffer.h
+ *
+ *  Off-screen copy of the panel. While enabled, the drawing primitives in
+ *  Adafruit_OLED.c render here and flushFrame() sends the merged dirty
+ *  rectangles to the panel once per tick.
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <stdbool.h>
+
+#define FB_MAX_DIRTY   8  // dirty rectangles tracked per frame
+#define FB_MERGE_SLACK 8  // extra pixels worth resending to save a window setup
+#define FB_BOUNCE_SIZE 4096 // bytes for packing partial width rects into one transfer
+#define FB_RECT_DESCS  6  // DMA descriptors per flushed rect, window setup and data
+
+void setFrameBuffer(bool enable);
+bool isFrameBufferEnabled(void);
+
+void fbFillRect(int x, int y, int w, int h, unsigned int color);
+// fills the whole copy and drops the dirty rects, the caller sends the
+// clear to the panel itself
+void fbFillScreen(unsigned int color);
+void fbBlit(int x, int y, int w, int h, const unsigned char *pixels);
+void fbMarkDirty(int x, int y, int w, int h);
+
+unsigned long flushFrame(void); // returns the number of pixel bytes sent
+
+#endif /* FRAMEBUFFER_H_ */
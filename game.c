@@ -0,0 +1,356 @@
+/*
+ * game.c
+ *
+ *  Pac and baddie movement, collisions and pellet scoring
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "map.h"
+#include "sound.h"
+#include "maze.h"
+#include "game.h"
+
+#define AMBUSH_TILES 4 // how far in front of the pac the ambusher aims
+
+static const int badColors[NUM_BADDIES] = { BAD_1_COLOR, BAD_2_COLOR, BAD_3_COLOR, BAD_4_COLOR };
+static const unsigned char badModes[NUM_BADDIES] = { AI_CHASE, AI_AMBUSH, AI_SCATTER, AI_RANDOM };
+static const MapPos scatterCorners[NUM_BADDIES] = { { 3, 1 }, { 28, 1 }, { 3, 30 }, { 28, 30 } };
+
+static bool enemyHit(struct Pac* pac, struct Baddie* bad) {
+    // check if enemy and pac share grid coords
+    return ((int)pac->x/4 == (int)bad->x/4 && (int)pac->y/4 == (int)bad->y/4);
+}
+
+// only called on a tile center, where the tile's own mask is the answer
+static void determineValidMoves(struct Baddie* bad) {
+    unsigned char open = tileMask(bad->x / TILE_PIXELS, bad->y / TILE_PIXELS);
+    int dir;
+    for (dir = 0; dir < 4; dir++) { // U L R D, same order as the mask bits
+        bad->validMoves[dir] = (open >> dir) & 1;
+    }
+}
+
+// valid move that gets closest to the pac, 4 when the field has no way there
+static int chaseDir(Game *game, struct Baddie *bad) {
+    int tx = (bad->x + 2) / TILE_PIXELS, ty = (bad->y + 2) / TILE_PIXELS;
+    int i, dir, start = rngRange(&bad->rng, 4); // random start breaks ties
+    int best = 4;
+    unsigned char d, bestDist = FLOW_UNREACHABLE;
+    for (i = 0; i < 4; i++) {
+        dir = (start + i) & 3;
+        if (!bad->validMoves[dir]) continue;
+        d = flowDistance(&game->flow, tx + dirX[dir], ty + dirY[dir]);
+        if (d < bestDist) {
+            bestDist = d;
+            best = dir;
+        }
+    }
+    return best;
+}
+
+// valid move whose next tile is closest in a straight line to (targetX, targetY),
+// turning back only when it is the only way out
+static int aimDir(struct Baddie *bad, int targetX, int targetY) {
+    int tx = (bad->x + 2) / TILE_PIXELS, ty = (bad->y + 2) / TILE_PIXELS;
+    int dir, dx, dy;
+    long dist, bestDist = -1;
+    int best = 4, back = 4;
+    for (dir = 0; dir < 4; dir++) {
+        if (!bad->validMoves[dir]) continue;
+        if (dirX[dir] == -bad->velX && dirY[dir] == -bad->velY) {
+            back = dir;
+            continue;
+        }
+        dx = tx + dirX[dir] - targetX;
+        dy = ty + dirY[dir] - targetY;
+        dist = (long) dx * dx + (long) dy * dy;
+        if (bestDist < 0 || dist < bestDist) {
+            bestDist = dist;
+            best = dir;
+        }
+    }
+    return best != 4 ? best : back;
+}
+
+static int ambushDir(Game *game, struct Baddie *bad) {
+    int px = (game->pac.x + 2) / TILE_PIXELS, py = (game->pac.y + 2) / TILE_PIXELS;
+    return aimDir(bad, px + game->xVel * AMBUSH_TILES, py + game->yVel * AMBUSH_TILES);
+}
+
+static int scatterDir(Game *game, struct Baddie *bad) {
+    (void) game;
+    return aimDir(bad, scatterCorners[bad->id].x, scatterCorners[bad->id].y);
+}
+
+// any valid move but straight back
+static int randomDir(Game *game, struct Baddie *bad) {
+    int i, dir, start = rngRange(&bad->rng, 4);
+    (void) game;
+    for (i = 0; i < 4; i++) {
+        dir = (start + i) & 3;
+        if (bad->validMoves[dir] && !(dirX[dir] == -bad->velX && dirY[dir] == -bad->velY)) {
+            return dir;
+        }
+    }
+    return 4;
+}
+
+typedef int (*BaddieStrategy)(Game *game, struct Baddie *bad); // direction 0-3, 4 for none
+
+static const BaddieStrategy strategies[AI_MODES] = { chaseDir, ambushDir, scatterDir, randomDir };
+
+static int runStrategy(Game *game, struct Baddie *bad) {
+    unsigned long start;
+    int dir;
+    game->decisions++;
+    if (game->io->clock == NULL) {
+        return strategies[bad->ai](game, bad);
+    }
+    start = game->io->clock();
+    dir = strategies[bad->ai](game, bad);
+    game->decisionTime += game->io->clock() - start;
+    return dir;
+}
+
+// only on a junction is there a choice to make
+static bool atJunction(struct Baddie *bad) {
+    return bad->stepsLeft == 0 && isJunction(bad->x / TILE_PIXELS, bad->y / TILE_PIXELS);
+}
+
+// decides next move direction of bad based on queue & valid moves
+static void decideVelocities(Game *game, struct Baddie *bad) {
+    int dirChoice = 4, i;
+    if (bad->dirQueue[0] != '\0') { // dir queue not empty
+        do {
+            if (bad->dirQueue[0] == '\0') {
+                break;
+            }
+            dirChoice = bad->dirQueue[0] - '0';
+            i = 1;
+            while (bad->dirQueue[i - 1] != '\0') {
+                bad->dirQueue[i - 1] = bad->dirQueue[i];
+                i++;
+            }
+            if (bad->dirQueue[0] == '\0') {
+                bad->ready = true; // set enemy ready to recieve next dir
+            }
+        } while (dirChoice < 0 || dirChoice > 3 || !bad->validMoves[dirChoice]); // find first valid move in queue, set that as dir
+    } else if(bad->id != game->selectedBaddie) { // queue empty
+        int sanityCheck = 0; // prevents looping forever in case no valid moves
+        dirChoice = runStrategy(game, bad);
+        if (dirChoice == 4) { // strategy had nothing, wander
+            dirChoice = rngRange(&bad->rng, 4); // choose ran num 0-3 to start in valid moves
+        }
+        while (!bad->validMoves[dirChoice] && sanityCheck < 4) {
+            dirChoice++; // iterate through dir till valid found
+            sanityCheck++;
+            if (dirChoice == 4) dirChoice = 0;
+        }
+    }
+    switch (dirChoice) {
+        case 0:
+            bad->velY = -1; // move up
+            break;
+        case 1:
+            bad->velX = -1; // move left
+            break;
+        case 2:
+            bad->velX = 1; // move down
+            break;
+        case 3:
+            bad->velY = 1; // move right
+            break;
+    }
+}
+
+static int moveDir(struct Baddie *bad) {
+    if (bad->velY < 0) return 0;
+    if (bad->velX < 0) return 1;
+    if (bad->velX > 0) return 2;
+    if (bad->velY > 0) return 3;
+    return 4;
+}
+
+// counts down the corridor to the next junction, the maze is only looked at on arrival
+static void updateBaddieLoc(struct Baddie* bad) {
+    const Junction *at;
+    int dir;
+    if (bad->stepsLeft == 0) { // on a tile center, set off down the next corridor
+        dir = moveDir(bad);
+        if (dir == 4) return;
+        if (!bad->validMoves[dir]) { // wall ahead
+            bad->velX = 0;
+            bad->velY = 0;
+            return;
+        }
+        at = bad->node != NO_JUNCTION ? getJunction(bad->node) : NULL;
+        if (at && at->x * TILE_PIXELS == bad->x && at->y * TILE_PIXELS == bad->y) {
+            bad->stepsLeft = at->length[dir] * TILE_PIXELS;
+            bad->node = at->next[dir];
+        } else { // spawned mid corridor
+            unsigned char length;
+            bad->node = walkCorridor(bad->x / TILE_PIXELS, bad->y / TILE_PIXELS, dir, &length);
+            bad->stepsLeft = length * TILE_PIXELS;
+        }
+        if (bad->stepsLeft == 0) { // open but no corridor, only in a broken maze
+            bad->velX = 0;
+            bad->velY = 0;
+            return;
+        }
+    }
+    bad->x += bad->velX;
+    bad->y += bad->velY;
+    if (--bad->stepsLeft == 0) {
+        determineValidMoves(bad); // arrived at the next junction
+    }
+}
+
+// function that updates the Pac's location accordingly and keeps it within bounds
+static void updatePacLoc(struct Pac *pac, int *xVel, int *yVel) {
+
+    bool yGreater = abs(*yVel) > abs(*xVel); // determine greater vel
+    if(*yVel > MAX_VEL) *yVel = MAX_VEL; // bind vel to +-1
+    if(*yVel < -MAX_VEL) *yVel = -MAX_VEL;
+    if(*xVel > MAX_VEL) *xVel = MAX_VEL;
+    if(*xVel < -MAX_VEL) *xVel = -MAX_VEL;
+    if (*yVel == 0 && *xVel == 0) return; // no movement
+
+    if(yCollision(pac->x, pac->y, *yVel) && xCollision(pac->x, pac->y, *xVel)) { // there's a collision in both directions
+        *xVel = 0;
+        *yVel = 0;
+        return;
+        // don't move
+    }
+    if(yGreater) { // y is greater
+        if (!yCollision(pac->x, pac->y, *yVel)) { // no collision moving in y
+            (*pac).y += *yVel;
+            (*pac).x = (((*pac).x + 2) / 4) * 4;
+            return;
+            // move y, position x on rails
+        }
+        yGreater = false;
+    }
+    if(!yGreater) { // either x is greater or y collided
+        if (!xCollision(pac->x, pac->y, *xVel)) { // no collision moving in y
+            (*pac).x += *xVel;
+            (*pac).y = (((*pac).y + 2) / 4) * 4;
+            return;
+            // move x, position y on rails
+        }
+        if (!yCollision(pac->x, pac->y, *yVel)) { // no collision moving in y
+            (*pac).y += *yVel;
+            (*pac).x = (((*pac).x + 2) / 4) * 4;
+            return;
+            // move y, position x on rails
+        }
+    }
+}
+
+void gameInit(Game *game, const GameIO *io) {
+    int i;
+    memset(game, 0, sizeof(*game));
+    for (i = 0; i < NUM_BADDIES; i++) {
+        game->bads[i].id = i;
+        game->bads[i].x = -1;
+        game->bads[i].y = -1;
+        game->bads[i].color = badColors[i];
+        game->bads[i].ai = badModes[i];
+    }
+    game->selectedBaddie = -1;
+    game->io = io;
+    buildMaze();
+}
+
+void gameReset(Game *game, unsigned long seed) {
+    int i;
+    game->seed = seed;
+    resetPellets(); // reset eaten pellets to active
+    game->pellets = countPellets();
+    // set pac location
+    game->pac.x = pacSpawn.x * TILE_PIXELS;
+    game->pac.y = pacSpawn.y * TILE_PIXELS;
+    // level start is slow anyway, build the first field in one go
+    flowReset(&game->flow);
+    flowTarget(&game->flow, pacSpawn.x, pacSpawn.y);
+    while (!game->flow.ready) {
+        flowUpdate(&game->flow);
+    }
+    for (i = 0; i < NUM_BADDIES; i++) {
+        struct Baddie *bad = &game->bads[i];
+        rngSeedStream(&bad->rng, seed, i);
+        if (i >= NUM_ENEMY_SPAWNS) { // impossible location so program knows it isn't initialized
+            bad->x = -1;
+            bad->y = -1;
+            continue;
+        }
+        bad->x = enemySpawns[i].x * TILE_PIXELS;
+        bad->y = enemySpawns[i].y * TILE_PIXELS;
+        bad->velY = 0;
+        bad->velX = 0;
+        strcpy(bad->dirQueue, ""); // clear dir queue
+        bad->ready = false;
+        bad->stepsLeft = 0;
+        bad->node = NO_JUNCTION;
+        determineValidMoves(bad);
+        decideVelocities(game, bad); // set random move dir
+    }
+    game->selectedBaddie = -1;
+    game->inputTimer = 0;
+}
+
+GameResult gameStep(Game *game) {
+    const GameIO *io = game->io;
+    struct Pac *pac = &game->pac;
+    GameResult result = GAME_RUNNING;
+    int bad;
+
+    if (game->inputTimer >= GAME_INPUT_PERIOD - 1) { // get new data 10 times a second
+        game->inputTimer = 0;
+        io->readInput(game, &game->xVel, &game->yVel);
+    } else {
+        game->inputTimer++;
+    }
+    io->syncNetwork(game); // commands take effect on the tick they arrive
+
+    updatePacLoc(pac, &game->xVel, &game->yVel); // update the pac's location
+    io->drawSprite(PAC_SPRITE, pac->x, pac->y, PLAYER_COLOR);
+    flowTarget(&game->flow, (pac->x + 2) / TILE_PIXELS, (pac->y + 2) / TILE_PIXELS);
+    flowUpdate(&game->flow); // a slice of the next field every tick
+    for (bad = 0; bad < NUM_BADDIES; bad++) { // iterate through bads
+        struct Baddie *b = &game->bads[bad];
+        updateBaddieLoc(b); // try to move bad
+        // if velocities zero (collision)
+        if (b->velX == 0 && b->velY == 0) {
+            decideVelocities(game, b); // next move in queue or toward the pac
+        } else if (b->dirQueue[0] == '\0' && b->id != game->selectedBaddie && atJunction(b)) {
+            int dir = runStrategy(game, b);
+            if (dir != 4) { // turn the way the strategy wants
+                b->velX = dirX[dir];
+                b->velY = dirY[dir];
+            }
+        }
+        io->drawSprite(BAD_SPRITE(bad), b->x, b->y, b->color);
+        if (enemyHit(pac, b)) { // check if enemy collision with pac
+            io->present();
+            return GAME_LOST; // gg u loose
+        }
+    }
+
+    if (HAS_PELLET(pac->x/TILE_PIXELS, pac->y/TILE_PIXELS)) {
+        // update score if pac has entered a point tile
+        EAT_PELLET(pac->x/TILE_PIXELS, pac->y/TILE_PIXELS);
+        io->clearTile(pac->x/TILE_PIXELS, pac->y/TILE_PIXELS);
+        pac->score++;
+        game->pellets--;
+        if (game->pellets == 0) {
+            result = GAME_CLEARED;
+        }
+        io->drawScore(pac->score);
+        io->playSound(BEEP);
+    }
+    io->present(); // send the tiles the sprites moved across
+    return result;
+}
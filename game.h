@@ -0,0 +1,99 @@
+/*
+ * game.h
+ *
+ *  Hardware independent game core. Movement, collisions and scoring only
+ *  talk to the outside world through the GameIO backends, so the same code
+ *  runs on the board or in a headless simulation.
+ */
+
+#ifndef GAME_H_
+#define GAME_H_
+
+#include <stdbool.h>
+
+#include "map.h"
+#include "flow.h"
+#include "rng.h"
+
+#define PAC_SIZE          4
+#define MAX_VEL           1
+#define NUM_BADDIES       4
+#define GAME_INPUT_PERIOD 3 // ticks between input reads
+#define PAC_SPRITE        0
+#define BAD_SPRITE(i)     ((i) + 1) // bads come after the pac so they draw on top
+
+// how a baddie picks its way when it has no queued moves
+typedef enum {
+    AI_CHASE = 0, // shortest path to the pac
+    AI_AMBUSH,    // heads for the tiles in front of the pac
+    AI_SCATTER,   // patrols its own corner of the maze
+    AI_RANDOM,    // random turns
+    AI_MODES
+} BaddieAI;
+
+typedef enum {
+    GAME_RUNNING = 0,
+    GAME_LOST,    // a baddie caught the pac
+    GAME_CLEARED  // every pellet eaten
+} GameResult;
+
+// pac struct
+struct Pac {
+    int x;
+    int y;
+    int score;
+};
+
+struct Baddie {
+    int id;
+    int x;
+    int y;
+    int velX;
+    int velY;
+    int color;
+    char dirQueue[8];
+    bool ready;
+    bool validMoves[4];
+    unsigned char ai; // BaddieAI, picked per id by gameInit
+    Rng rng;          // own stream so bads deciding on the same tick don't correlate
+    unsigned char node; // junction it is heading to or standing on
+    int stepsLeft;      // pixels to go before reaching node
+};
+
+struct Game;
+
+typedef struct GameIO {
+    // input, raw velocities before they get clamped to MAX_VEL
+    void (*readInput)(struct Game *game, int *xVel, int *yVel);
+    // network, runs every tick, after the input read on ticks that have one
+    void (*syncNetwork)(struct Game *game);
+    // display
+    void (*drawSprite)(int id, int x, int y, unsigned int color);
+    void (*clearTile)(int tx, int ty);
+    void (*drawScore)(int score);
+    void (*present)(void); // end of tick, everything for this tick is drawn
+    // sound
+    void (*playSound)(char *song);
+    // optional, when set every strategy call is timed with it
+    unsigned long (*clock)(void);
+} GameIO;
+
+typedef struct Game {
+    struct Pac pac;
+    struct Baddie bads[NUM_BADDIES];
+    int xVel, yVel;     // velocities of the pac
+    int pellets;        // pellets left on the map
+    int selectedBaddie; // last baddie given moves over the network, -1 for none
+    int inputTimer;
+    FlowField flow;     // distances to the pac, shared by all the bads
+    unsigned long seed; // level seed, replaying with it gives the same game
+    unsigned long decisions;    // strategy calls since gameInit
+    unsigned long decisionTime; // io->clock ticks spent in them
+    const GameIO *io;
+} Game;
+
+void gameInit(Game *game, const GameIO *io);
+void gameReset(Game *game, unsigned long seed); // restores the pellets and puts everyone on their spawn
+GameResult gameStep(Game *game);
+
+#endif /* GAME_H_ */
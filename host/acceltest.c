@@ -0,0 +1,191 @@
+/*
+ * acceltest.c
+ *
+ *  Runs accel.c against a BMA222 stand-in on a simulated I2C bus, with
+ *  the timer interrupt fired by the test. Checks the burst read and its
+ *  byte mapping, that the timer sits below the SPI DMA interrupt, a
+ *  failed transfer, the ring filling up while the game is busy, and the
+ *  moving average against one kept here. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "hw_memmap.h"
+#include "hw_ints.h"
+#include "interrupt.h"
+#include "prcm.h"
+#include "timer.h"
+#include "i2c_if.h"
+#include "timer_if.h"
+#include "accel.h"
+#include "spi_dma.h"
+#include "rng.h"
+#include "check.h"
+
+static void (*handler)(void);
+static unsigned long periodMs;
+static int pending;               // timer interrupts not cleared yet
+static unsigned char regs[0x40];  // BMA222 register file
+static bool busError;
+static int transfers;
+static int timerPriority = INT_PRIORITY_LVL_0; // the reset level
+
+void Timer_IF_Init(unsigned long ePeripheral, unsigned long ulBase, unsigned long ulConfig,
+                   unsigned long ulTimer, unsigned long ulValue) {
+    CHECK(ePeripheral == PRCM_TIMERA1 && ulBase == TIMERA1_BASE && ulConfig == TIMER_CFG_PERIODIC &&
+          ulTimer == TIMER_A && ulValue == 0, "timer set up as %lx %lx %lx", ePeripheral, ulBase, ulConfig);
+}
+
+void Timer_IF_IntSetup(unsigned long ulBase, unsigned long ulTimer, void (*TimerBaseIntHandler)(void)) {
+    (void) ulBase;
+    (void) ulTimer;
+    handler = TimerBaseIntHandler;
+    timerPriority = INT_PRIORITY_LVL_1; // what timer_if.c sets
+}
+
+void IntPrioritySet(unsigned long ulInterrupt, unsigned char ucPriority) {
+    CHECK(ulInterrupt == INT_TIMERA1A, "priority set for interrupt %lu", ulInterrupt);
+    timerPriority = ucPriority;
+}
+
+void Timer_IF_InterruptClear(unsigned long ulBase) {
+    CHECK(ulBase == TIMERA1_BASE, "cleared timer %lx", ulBase);
+    pending--;
+}
+
+void Timer_IF_Start(unsigned long ulBase, unsigned long ulTimer, unsigned long ulValue) {
+    (void) ulBase;
+    (void) ulTimer;
+    periodMs = ulValue;
+}
+
+// a register pointer write then a burst read, the pointer auto increments
+int I2C_IF_ReadFrom(unsigned char ucDevAddr, unsigned char *pucWrDataBuf, unsigned char ucWrLen,
+                    unsigned char *pucRdDataBuf, unsigned char ucRdLen) {
+    int i;
+    transfers++;
+    CHECK(ucDevAddr == ACCEL_DEV && ucWrLen == 1, "transfer to %02x writing %d", ucDevAddr, ucWrLen);
+    if (busError || ucDevAddr != ACCEL_DEV) {
+        return -1;
+    }
+    for (i = 0; i < ucRdLen; i++) {
+        pucRdDataBuf[i] = regs[(pucWrDataBuf[0] + i) % sizeof(regs)];
+    }
+    return 0;
+}
+
+// the BMA222 keeps 8 bit axes in the MSB registers, the LSBs read as noise
+static void setAxes(int x, int y, Rng *rng) {
+    regs[0x02] = rngNext(rng);
+    regs[0x03] = (unsigned char) x;
+    regs[0x04] = rngNext(rng);
+    regs[0x05] = (unsigned char) y;
+    regs[0x06] = rngNext(rng);
+}
+
+static void fire(void) {
+    pending++;
+    handler();
+    CHECK(pending == 0, "interrupt left pending");
+}
+
+// the samples accelTilt drained, for the reference average
+static AccelSample seen[ACCEL_FILTER_LEN];
+static int seenCount;
+
+static void expectTilt(const char *what) {
+    int x, y, refX = 0, refY = 0, n = seenCount < ACCEL_FILTER_LEN ? seenCount : ACCEL_FILTER_LEN, i;
+    accelTilt(&x, &y);
+    for (i = seenCount - n; i < seenCount; i++) {
+        refX += seen[i % ACCEL_FILTER_LEN].x;
+        refY += seen[i % ACCEL_FILTER_LEN].y;
+    }
+    if (n > 0) {
+        refX /= n;
+        refY /= n;
+    }
+    CHECK(x == refX && y == refY, "%s: tilt %d,%d, the last %d samples average %d,%d", what, x, y, n, refX, refY);
+}
+
+static void checkBurst(Rng *rng) {
+    AccelSample s;
+    int xs[] = { 0, 1, -1, 127, -128, 64 }, ys[] = { 0, -1, 1, -128, 127, -64 }, i;
+
+    InitAccel();
+    CHECK(handler == AccelIntHandler && periodMs == ACCEL_SAMPLE_MS, "timer at %lu ms", periodMs);
+    // the blocking I2C read must never hold off an SPI DMA end of transfer
+    CHECK(timerPriority == ACCEL_INT_PRIORITY && timerPriority > DMA_INT_PRIORITY,
+          "sampling timer at priority %02x, the SPI DMA at %02x", timerPriority, DMA_INT_PRIORITY);
+    expectTilt("before any sample");
+    for (i = 0; i < 6; i++) {
+        setAxes(xs[i], ys[i], rng);
+        transfers = 0;
+        fire();
+        CHECK(transfers == 1, "%d transfers for one sample", transfers);
+        CHECK(accelPop(&s) && s.x == xs[i] && s.y == ys[i], "read %d,%d for %d,%d", s.x, s.y, xs[i], ys[i]);
+        CHECK(!accelPop(&s), "more than one sample per interrupt");
+    }
+
+    busError = true;
+    fire();
+    busError = false;
+    CHECK(!accelPop(&s), "a failed transfer was queued");
+}
+
+static void checkFull(Rng *rng) {
+    AccelSample s;
+    unsigned long before = accelDropped();
+    int i;
+
+    for (i = 0; i < ACCEL_QUEUE_SIZE + 5; i++) {
+        setAxes(i, -i, rng);
+        fire();
+    }
+    CHECK(accelDropped() - before == 5, "%lu dropped", accelDropped() - before);
+    for (i = 0; i < ACCEL_QUEUE_SIZE; i++) { // the oldest samples are the ones kept
+        CHECK(accelPop(&s) && s.x == i && s.y == -i, "sample %d came back as %d,%d", i, s.x, s.y);
+    }
+    CHECK(!accelPop(&s), "ring holds more than its size");
+}
+
+// the 10 ms timer against ~30 fps frames, with a stalled frame now and then
+static void checkFilter(Rng *rng) {
+    unsigned long before = accelDropped();
+    int ms, nextFrame = 0, x = 0, y = 0, expectDropped = 0, queued = 0;
+
+    for (ms = 0; ms < 20000; ms++) {
+        if (ms % ACCEL_SAMPLE_MS == 0) {
+            x += (int) rngRange(rng, 21) - 10;
+            y += (int) rngRange(rng, 21) - 10;
+            x = x > 127 ? 127 : x < -128 ? -128 : x;
+            y = y > 127 ? 127 : y < -128 ? -128 : y;
+            setAxes(x, y, rng);
+            fire();
+            if (queued == ACCEL_QUEUE_SIZE) {
+                expectDropped++;
+            } else {
+                seen[seenCount % ACCEL_FILTER_LEN].x = x;
+                seen[seenCount % ACCEL_FILTER_LEN].y = y;
+                seenCount++;
+                queued++;
+            }
+        }
+        if (ms == nextFrame) {
+            expectTilt("frame");
+            queued = 0;
+            nextFrame += rngRange(rng, 50) == 0 ? 250 : 33;
+        }
+    }
+    CHECK(expectDropped > 0 && accelDropped() - before == (unsigned long) expectDropped,
+          "%lu dropped, %d expected", accelDropped() - before, expectDropped);
+}
+
+int main(void) {
+    Rng rng;
+    rngSeed(&rng, 222);
+    checkBurst(&rng);
+    checkFull(&rng);
+    checkFilter(&rng);
+    return checkResult("acceltest");
+}
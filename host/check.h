@@ -0,0 +1,30 @@
+/*
+ * check.h
+ *
+ *  Shared by the host tests. CHECK prints and counts a failed condition
+ *  and carries on, checkResult prints the verdict at the end of main.
+ */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+// prints "name: ok" or "name: FAILED", returns the exit status for main
+static int checkResult(const char *name) {
+    printf("%s: %s\n", name, failures ? "FAILED" : "ok");
+    return failures != 0;
+}
+
+#endif /* CHECK_H_ */
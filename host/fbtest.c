@@ -0,0 +1,300 @@
+/*
+ * fbtest.c
+ *
+ *  Runs the framebuffer against a simulated SPI DMA that models the
+ *  descriptor queue and the panel RAM. Checks the bytes each flush sends,
+ *  that the panel ends up showing what was drawn, that a flush never
+ *  overruns the queue and that nothing the DMA still reads is drawn over.
+ *
+ *    fbtest           checks, exits 1 on a mismatch
+ *    fbtest -p file   also writes the panel after the random run as a PPM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "Adafruit_GFX.h"
+#include "framebuffer.h"
+#include "spi_dma.h"
+#include "rng.h"
+#include "check.h"
+
+#define WINDOW_DESCS (FB_RECT_DESCS - 1) // column, row and RAM write setup
+#define RANDOM_FRAMES 3000
+
+// a queued descriptor, data ones remember a hash of their source so a
+// change before it goes out shows up
+typedef struct Desc {
+    bool window;
+    int x, y, w, h;
+    const unsigned char *src;
+    unsigned long count;
+    unsigned long hash;
+} Desc;
+
+static Desc queue[DMA_QUEUE_SIZE];
+static int head = 0, tail = 0;
+
+static unsigned char panel[HEIGHT][WIDTH * 2];    // what the OLED shows
+static int winX, winY, winW, winH;
+static long cursor;                               // byte in the window
+
+static unsigned char expect[HEIGHT][WIDTH * 2];   // what was drawn
+static unsigned long bytesSent, windows, waits;
+
+static unsigned long hashBytes(const unsigned char *src, unsigned long count) {
+    unsigned long h = 2166136261UL; // FNV-1a
+    while (count--) {
+        h = ((h ^ *src++) * 16777619UL) & 0xFFFFFFFF;
+    }
+    return h;
+}
+
+static Desc *push(void) {
+    CHECK(head - tail < DMA_QUEUE_SIZE, "descriptor queue overrun, a flush would wait");
+    return &queue[head++ % DMA_QUEUE_SIZE];
+}
+
+void spiDmaQueue(unsigned char dc, const unsigned char *src, unsigned long count,
+                 DmaDoneCallback done, void *arg) {
+    Desc *desc = push();
+    CHECK(dc == DMA_DATA && done == NULL && arg == NULL, "unexpected data descriptor");
+    desc->window = false;
+    desc->src = src;
+    desc->count = count;
+    desc->hash = hashBytes(src, count);
+}
+
+void spiDmaQueueWindow(int x, int y, int w, int h) {
+    Desc *desc = NULL;
+    int i;
+    for (i = 0; i < WINDOW_DESCS; i++) { // command and range bytes, the last one does the work here
+        desc = push();
+        desc->window = false;
+        desc->count = 0;
+    }
+    CHECK(x >= 0 && y >= 0 && w > 0 && h > 0 && x + w <= WIDTH && y + h <= HEIGHT,
+          "window %d,%d %dx%d is off the panel", x, y, w, h);
+    desc->window = true;
+    desc->x = x;
+    desc->y = y;
+    desc->w = w;
+    desc->h = h;
+    windows++;
+}
+
+bool spiDmaBusy(void) {
+    return head != tail;
+}
+
+int spiDmaFree(void) {
+    return DMA_QUEUE_SIZE - (head - tail);
+}
+
+// the panel takes the window setup and then the pixels row by row
+static void runOne(void) {
+    Desc *desc = &queue[tail++ % DMA_QUEUE_SIZE];
+    unsigned long i;
+    if (desc->window) {
+        winX = desc->x;
+        winY = desc->y;
+        winW = desc->w;
+        winH = desc->h;
+        cursor = 0;
+    } else if (desc->count > 0) {
+        CHECK(hashBytes(desc->src, desc->count) == desc->hash, "a source changed while it was queued");
+        for (i = 0; i < desc->count; i++, cursor++) {
+            panel[winY + (cursor / 2 / winW) % winH][(winX + cursor / 2 % winW) * 2 + cursor % 2] = desc->src[i];
+        }
+        bytesSent += desc->count;
+    }
+}
+
+static void runDma(int n) {
+    while (n-- > 0 && head != tail) {
+        runOne();
+    }
+}
+
+void spiDmaWait(void) {
+    waits++;
+    runDma(DMA_QUEUE_SIZE);
+}
+
+// the same clipping the framebuffer does, on the expected image
+static void fill(int x, int y, int w, int h, unsigned int color) {
+    int i, j;
+    fbFillRect(x, y, w, h, color);
+    for (j = y; j < y + h; j++) {
+        for (i = x; i < x + w; i++) {
+            if (i >= 0 && j >= 0 && i < WIDTH && j < HEIGHT) {
+                expect[j][i * 2] = color >> 8;
+                expect[j][i * 2 + 1] = color;
+            }
+        }
+    }
+}
+
+static void blit(int x, int y, int w, int h, const unsigned char *pixels) {
+    int i, j;
+    fbBlit(x, y, w, h, pixels);
+    for (j = 0; j < h; j++) {
+        for (i = 0; i < w; i++) {
+            if (x + i >= 0 && y + j >= 0 && x + i < WIDTH && y + j < HEIGHT) {
+                expect[y + j][(x + i) * 2] = pixels[(j * w + i) * 2];
+                expect[y + j][(x + i) * 2 + 1] = pixels[(j * w + i) * 2 + 1];
+            }
+        }
+    }
+}
+
+static void checkPanel(const char *what) {
+    int x, y;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH * 2; x++) {
+            if (panel[y][x] != expect[y][x]) {
+                CHECK(false, "%s: panel differs first at %d,%d", what, x / 2, y);
+                return;
+            }
+        }
+    }
+}
+
+// one flush sent out completely, returns what flushFrame reported
+static unsigned long flushAll(void) {
+    unsigned long before = bytesSent, sent = flushFrame();
+    runDma(DMA_QUEUE_SIZE);
+    CHECK(bytesSent - before == sent, "flush reported %lu bytes, %lu went out", sent, bytesSent - before);
+    return sent;
+}
+
+static void checkBytes(void) {
+    unsigned long sent;
+
+    setFrameBuffer(true);
+    CHECK(flushAll() == 0 && windows == 0, "an empty frame sent something");
+
+    fill(5, 7, 10, 10, 0xF800);
+    sent = flushAll();
+    CHECK(sent == 10 * 10 * 2 && windows == 1, "10x10 rect sent %lu bytes in %lu windows", sent, windows);
+    checkPanel("one rect");
+
+    fill(0, 0, WIDTH, HEIGHT, 0x001F);
+    CHECK(flushAll() == WIDTH * HEIGHT * 2, "full screen byte count");
+    checkPanel("full screen");
+
+    // overlapping rects go out once as their bounding box
+    windows = 0;
+    fill(20, 20, 10, 10, 0x07E0);
+    fill(25, 20, 10, 10, 0xFFE0);
+    sent = flushAll();
+    CHECK(sent == 15 * 10 * 2 && windows == 1, "overlap sent %lu bytes in %lu windows", sent, windows);
+
+    // far apart ones separately
+    windows = 0;
+    fill(0, 0, 4, 4, 0x1234);
+    fill(100, 100, 4, 4, 0x4321);
+    sent = flushAll();
+    CHECK(sent == 2 * 4 * 4 * 2 && windows == 2, "two rects sent %lu bytes in %lu windows", sent, windows);
+    checkPanel("two rects");
+
+    // clipped at the edges
+    fill(-3, HEIGHT - 2, 6, 6, 0xABCD);
+    CHECK(flushAll() == 3 * 2 * 2, "clipped rect byte count");
+    checkPanel("clipped rect");
+
+    // more rects than can be tracked still all reach the panel
+    fill(0, 40, 2, 2, 1);
+    fill(10, 50, 2, 2, 2);
+    fill(20, 60, 2, 2, 3);
+    fill(30, 70, 2, 2, 4);
+    fill(40, 80, 2, 2, 5);
+    fill(50, 90, 2, 2, 6);
+    fill(60, 100, 2, 2, 7);
+    fill(70, 110, 2, 2, 8);
+    fill(80, 120, 2, 2, 9);
+    fill(90, 30, 2, 2, 10);
+    flushAll();
+    checkPanel("spilled rects");
+}
+
+// a full queue leaves the rects dirty for the next frame
+static void checkStarved(void) {
+    static const unsigned char none[1] = { 0 };
+    int i;
+
+    for (i = 0; i < DMA_QUEUE_SIZE - FB_RECT_DESCS + 1; i++) {
+        spiDmaQueue(DMA_DATA, none, 0, NULL, NULL);
+    }
+    fill(64, 64, 8, 8, 0x5555);
+    CHECK(flushFrame() == 0, "flushed without room for a rect");
+    runDma(DMA_QUEUE_SIZE);
+    CHECK(flushAll() == 8 * 8 * 2, "the held back rect was not sent later");
+    checkPanel("held back rect");
+}
+
+// drawing goes on while earlier flushes are only partly out
+static void checkRandom(void) {
+    static unsigned char sprite[16 * 16 * 2];
+    unsigned long sent = 0, before = bytesSent;
+    Rng rng;
+    int frame, i, n;
+
+    rngSeed(&rng, 2020);
+    for (i = 0; i < (int) sizeof(sprite); i++) {
+        sprite[i] = rngNext(&rng);
+    }
+    waits = 0;
+    for (frame = 0; frame < RANDOM_FRAMES; frame++) {
+        n = rngRange(&rng, 6);
+        for (i = 0; i < n; i++) {
+            if (rngRange(&rng, 2)) {
+                fill((int) rngRange(&rng, WIDTH + 16) - 8, (int) rngRange(&rng, HEIGHT + 16) - 8,
+                     1 + rngRange(&rng, rngRange(&rng, 8) == 0 ? WIDTH : 12), 1 + rngRange(&rng, 12),
+                     rngNext(&rng) & 0xFFFF);
+            } else {
+                blit((int) rngRange(&rng, WIDTH + 16) - 16, (int) rngRange(&rng, HEIGHT + 16) - 16,
+                     16, 16, sprite);
+            }
+        }
+        sent += flushFrame();
+        runDma(rngRange(&rng, 2 * FB_RECT_DESCS)); // the transfer is rarely done by the next frame
+    }
+    sent += flushFrame();
+    runDma(DMA_QUEUE_SIZE);
+    sent += flushAll();
+    CHECK(bytesSent - before == sent, "flushes reported %lu bytes, %lu went out", sent, bytesSent - before);
+    checkPanel("random frames");
+    printf("%d frames: %lu bytes sent, %lu waits for the DMA\n", RANDOM_FRAMES, sent, waits);
+}
+
+static void writePpm(const char *path) {
+    FILE *f = fopen(path, "wb");
+    int x, y;
+    unsigned int c;
+    if (f == NULL) {
+        CHECK(false, "cannot write %s", path);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            c = panel[y][x * 2] << 8 | panel[y][x * 2 + 1]; // RGB565
+            fputc((c >> 11) * 255 / 31, f);
+            fputc(((c >> 5) & 0x3F) * 255 / 63, f);
+            fputc((c & 0x1F) * 255 / 31, f);
+        }
+    }
+    fclose(f);
+}
+
+int main(int argc, char **argv) {
+    checkBytes();
+    checkStarved();
+    checkRandom();
+    if (argc > 2 && strcmp(argv[1], "-p") == 0) {
+        writePpm(argv[2]);
+    }
+    return checkResult("fbtest");
+}
@@ -0,0 +1,137 @@
+/*
+ * flowtest.c
+ *
+ *  Checks the sliced flow field against a plain breadth first search for
+ *  every open target tile, and times the slices the game runs per tick.
+ *
+ *    flowtest       field checks, exits 1 on a mismatch
+ *    flowtest -d    also prints the field toward the pac spawn
+ *    flowtest -b    also times a slice and a whole rebuild
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "map.h"
+#include "flow.h"
+#include "check.h"
+
+#define BENCH_BUILDS 20000
+// a rebuild has to finish in a handful of ticks for the baddies to keep up
+#define MAX_SLICES   ((MAP_SIZE * MAP_SIZE + FLOW_CELLS_PER_TICK - 1) / FLOW_CELLS_PER_TICK)
+
+static FlowField flow;
+
+// the whole search in one go, the reference for the sliced one
+static void referenceField(int targetX, int targetY, unsigned char dist[MAP_SIZE][MAP_SIZE]) {
+    static unsigned short queue[MAP_SIZE * MAP_SIZE];
+    static const int stepX[4] = { 0, -1, 1, 0 }, stepY[4] = { -1, 0, 0, 1 };
+    int head = 0, tail = 0, tx, ty, nx, ny, dir;
+
+    memset(dist, FLOW_UNREACHABLE, MAP_SIZE * MAP_SIZE);
+    dist[targetY][targetX] = 0;
+    queue[tail++] = targetY * MAP_SIZE + targetX;
+    while (head < tail) {
+        tx = queue[head] % MAP_SIZE;
+        ty = queue[head] / MAP_SIZE;
+        head++;
+        for (dir = 0; dir < 4; dir++) {
+            nx = tx + stepX[dir];
+            ny = ty + stepY[dir];
+            if (nx >= 0 && ny >= 0 && nx < MAP_SIZE && ny < MAP_SIZE && !IS_WALL(nx, ny) &&
+                    dist[ny][nx] == FLOW_UNREACHABLE) {
+                dist[ny][nx] = dist[ty][tx] + 1;
+                queue[tail++] = ny * MAP_SIZE + nx;
+            }
+        }
+    }
+}
+
+// runs slices until the field toward the target is swapped in, returns the slices used
+static int buildField(int tx, int ty) {
+    int slices = 0;
+    flowTarget(&flow, tx, ty);
+    do {
+        flowUpdate(&flow);
+        slices++;
+    } while (flow.building);
+    return slices;
+}
+
+static void checkFields(void) {
+    static unsigned char expect[MAP_SIZE][MAP_SIZE];
+    int targetX, targetY, tx, ty, slices, mismatches;
+
+    flowReset(&flow);
+    CHECK(flowDistance(&flow, pacSpawn.x, pacSpawn.y) == FLOW_UNREACHABLE, "a reset field has distances");
+    for (targetY = 0; targetY < MAP_SIZE; targetY++) {
+        for (targetX = 0; targetX < MAP_SIZE; targetX++) {
+            if (IS_WALL(targetX, targetY)) {
+                continue;
+            }
+            // builds follow each other, so the back buffer is always a stale field
+            slices = buildField(targetX, targetY);
+            CHECK(slices <= MAX_SLICES, "field toward %d,%d took %d slices", targetX, targetY, slices);
+            referenceField(targetX, targetY, expect);
+            mismatches = 0;
+            for (ty = 0; ty < MAP_SIZE; ty++) {
+                for (tx = 0; tx < MAP_SIZE; tx++) {
+                    mismatches += flowDistance(&flow, tx, ty) != expect[ty][tx];
+                }
+            }
+            CHECK(mismatches == 0, "field toward %d,%d differs on %d tiles", targetX, targetY, mismatches);
+        }
+    }
+
+    // an unchanged target costs nothing, the finished field stays up
+    flowUpdate(&flow);
+    CHECK(!flow.building, "a rebuild started without the target moving");
+}
+
+static void dump(void) {
+    int tx, ty;
+    unsigned char d;
+    buildField(pacSpawn.x, pacSpawn.y);
+    printf("steps to the pac spawn at %d,%d, ## is a wall\n", pacSpawn.x, pacSpawn.y);
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            d = flowDistance(&flow, tx, ty);
+            if (IS_WALL(tx, ty)) {
+                printf(" ##");
+            } else if (d == FLOW_UNREACHABLE) {
+                printf("  .");
+            } else {
+                printf("%3d", d);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void bench(void) {
+    clock_t start;
+    double seconds;
+    long slices = 0;
+    int i;
+
+    start = clock();
+    for (i = 0; i < BENCH_BUILDS; i++) { // bounce between two far apart targets
+        slices += buildField(i & 1 ? enemySpawns[0].x : pacSpawn.x, i & 1 ? enemySpawns[0].y : pacSpawn.y);
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%d rebuilds in %ld slices: %.2f us per slice, %.2f us per rebuild\n", BENCH_BUILDS, slices,
+           seconds * 1e6 / slices, seconds * 1e6 / BENCH_BUILDS);
+}
+
+int main(int argc, char **argv) {
+    resetPellets();
+    checkFields();
+    if (argc > 1 && strcmp(argv[1], "-d") == 0) {
+        dump();
+    } else if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        bench();
+    }
+    return checkResult("flowtest");
+}
@@ -0,0 +1,263 @@
+/*
+ * httptest.c
+ *
+ *  Runs the pipelined HTTP session against a scripted server: Content-Length
+ *  and chunked responses back to back, split at every possible point, plus
+ *  a full pipeline, failed sends, dropped connections and responses too big
+ *  for the buffer. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "simplelink.h"
+#include "http.h"
+#include "rng.h"
+#include "check.h"
+
+#define SOCKET     7
+#define STREAM_MAX (2 * HTTP_BUFFER_SIZE)
+#define RANDOM_RUNS 500
+
+// the server side: what arrives on the next sl_Recv calls
+static char stream[STREAM_MAX];
+static int streamLength, streamPos;
+static int chunk;              // bytes handed out per sl_Recv, 0 for all there is
+static bool closed;            // the server hangs up once the stream is read
+static bool sendFails;
+static int sent;
+
+int sl_Send(int sd, const void *buf, int len, int flags) {
+    (void) buf;
+    (void) flags;
+    CHECK(sd == SOCKET, "sent on socket %d", sd);
+    if (sendFails) {
+        return -1;
+    }
+    sent += len;
+    return len;
+}
+
+int sl_Recv(int sd, void *buf, int len, int flags) {
+    int n = streamLength - streamPos;
+    CHECK(sd == SOCKET && flags == SL_MSG_DONTWAIT, "blocking read on socket %d", sd);
+    if (n == 0) {
+        return closed ? 0 : SL_EAGAIN;
+    }
+    if (chunk > 0 && n > chunk) {
+        n = chunk;
+    }
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, &stream[streamPos], n);
+    streamPos += n;
+    return n;
+}
+
+// what the callbacks saw for one request
+typedef struct Seen {
+    char body[HTTP_BUFFER_SIZE];
+    int length;
+    const char *start;  // body start of the first call
+    bool moved;         // a later call started somewhere else
+    bool shrank;
+    int status;
+    int done;           // onDone calls
+    int order;          // position among completed requests
+} Seen;
+
+static int completed;
+
+static void onBody(const char *body, int length, void *arg) {
+    Seen *seen = arg;
+    if (seen->start == NULL) {
+        seen->start = body;
+    }
+    seen->moved |= body != seen->start;
+    seen->shrank |= length < seen->length;
+    memcpy(seen->body, body, length);
+    seen->length = length;
+}
+
+static void onDone(int status, void *arg) {
+    Seen *seen = arg;
+    seen->status = status;
+    seen->done++;
+    seen->order = completed++;
+}
+
+static void start(const char *responses, int responsesLength, int recvChunk) {
+    memcpy(stream, responses, responsesLength);
+    streamLength = responsesLength;
+    streamPos = 0;
+    chunk = recvChunk;
+    closed = false;
+    sendFails = false;
+    sent = 0;
+    completed = 0;
+    httpOpen(SOCKET);
+}
+
+// polls until the stream is used up and a few more times after
+static void drain(void) {
+    int i;
+    for (i = 0; i < STREAM_MAX + 4 && (streamPos < streamLength || i < 4 || closed); i++) {
+        httpPoll();
+        if (httpPending() == 0) {
+            break;
+        }
+    }
+}
+
+static const char lengthResponse[] =
+    "HTTP/1.1 200 OK\r\n"
+    "content-LENGTH: 27\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "{\"state\":{\"reported\":{}}}\r\n";
+
+static const char chunkedResponse[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "5;ext=1\r\n"
+    "{\"mes\r\n"
+    "19\r\n"
+    "sage\":\"No shadow exists\"}\r\n"
+    "0\r\n"
+    "X-Trailer: ignored\r\n"
+    "\r\n";
+
+#define CHUNKED_BODY "{\"message\":\"No shadow exists\"}"
+#define LENGTH_BODY  "{\"state\":{\"reported\":{}}}\r\n"
+
+static void checkSeen(const Seen *seen, int status, const char *body, int order, const char *what) {
+    CHECK(seen->done == 1 && seen->status == status, "%s: %d completions, status %d", what, seen->done, seen->status);
+    CHECK(seen->order == order, "%s finished as number %d", what, seen->order);
+    CHECK(seen->length == (int) strlen(body) && memcmp(seen->body, body, seen->length) == 0,
+          "%s body is %.*s", what, seen->length, seen->body);
+    CHECK(!seen->moved && !seen->shrank, "%s body moved or shrank between calls", what);
+}
+
+// a POST and a GET in flight, the answers arrive back to back in pieces
+static void checkPipelined(int recvChunk) {
+    char responses[sizeof(lengthResponse) + sizeof(chunkedResponse)];
+    int n = sizeof(lengthResponse) - 1;
+    Seen post, get;
+    char what[48];
+
+    memset(&post, 0, sizeof(post));
+    memset(&get, 0, sizeof(get));
+    memcpy(responses, lengthResponse, n);
+    memcpy(&responses[n], chunkedResponse, sizeof(chunkedResponse) - 1);
+    n += sizeof(chunkedResponse) - 1;
+
+    start(responses, n, recvChunk);
+    CHECK(httpSend("POST", 4, onBody, onDone, &post), "POST not sent");
+    CHECK(httpSend("GET", 3, onBody, onDone, &get), "GET not sent");
+    CHECK(sent == 7 && httpPending() == 2, "%d bytes sent, %d pending", sent, httpPending());
+    drain();
+    sprintf(what, "POST in %d byte reads", recvChunk);
+    checkSeen(&post, 200, LENGTH_BODY, 0, what);
+    sprintf(what, "GET in %d byte reads", recvChunk);
+    checkSeen(&get, 404, CHUNKED_BODY, 1, what);
+    CHECK(httpPending() == 0, "%d still pending", httpPending());
+}
+
+// reads of random size, the responses in random order of framing
+static void checkRandom(void) {
+    static char responses[STREAM_MAX];
+    static Seen seen[HTTP_PIPELINE];
+    static const char *bodies[2] = { LENGTH_BODY, CHUNKED_BODY };
+    static const int statuses[2] = { 200, 404 };
+    int kinds[HTTP_PIPELINE], i, run, n;
+    Rng rng;
+
+    rngSeed(&rng, 2020);
+    for (run = 0; run < RANDOM_RUNS; run++) {
+        n = 0;
+        for (i = 0; i < HTTP_PIPELINE; i++) {
+            kinds[i] = rngRange(&rng, 2);
+            if (kinds[i] == 0) {
+                memcpy(&responses[n], lengthResponse, sizeof(lengthResponse) - 1);
+                n += sizeof(lengthResponse) - 1;
+            } else {
+                memcpy(&responses[n], chunkedResponse, sizeof(chunkedResponse) - 1);
+                n += sizeof(chunkedResponse) - 1;
+            }
+        }
+        start(responses, n, 1 + rngRange(&rng, 40));
+        for (i = 0; i < HTTP_PIPELINE; i++) {
+            memset(&seen[i], 0, sizeof(seen[i]));
+            httpSend("GET", 3, onBody, onDone, &seen[i]);
+        }
+        drain();
+        for (i = 0; i < HTTP_PIPELINE; i++) {
+            checkSeen(&seen[i], statuses[kinds[i]], bodies[kinds[i]], i, "random run");
+        }
+    }
+}
+
+static void checkFailures(void) {
+    static char big[STREAM_MAX];
+    Seen a, b, c;
+    int n;
+
+    // the pipeline only takes HTTP_PIPELINE requests
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&c, 0, sizeof(c));
+    start("", 0, 0);
+    CHECK(httpSend("A", 1, NULL, onDone, &a) && httpSend("B", 1, NULL, onDone, &b), "pipeline refused");
+    CHECK(!httpSend("C", 1, NULL, onDone, &c) && sent == 2, "a third request was sent");
+
+    // the server hangs up, everything in flight is failed in order
+    closed = true;
+    drain();
+    CHECK(a.done == 1 && a.status == -1 && a.order == 0 && b.done == 1 && b.status == -1 && b.order == 1,
+          "hang up gave %d/%d and %d/%d", a.done, a.status, b.done, b.status);
+    CHECK(c.done == 0 && httpPending() == 0, "the refused request completed");
+
+    // a failed send is not queued
+    memset(&a, 0, sizeof(a));
+    start("", 0, 0);
+    sendFails = true;
+    CHECK(!httpSend("A", 1, NULL, onDone, &a) && httpPending() == 0, "failed send was queued");
+
+    // the rest of a lost response in front of the next one is skipped
+    memset(&a, 0, sizeof(a));
+    n = sprintf(big, "ost response tail\r\n\r\n%s", lengthResponse);
+    start(big, n, 3);
+    httpSend("A", 1, onBody, onDone, &a);
+    drain();
+    checkSeen(&a, 200, LENGTH_BODY, 0, "response after junk");
+
+    // nothing can frame a response bigger than the buffer
+    memset(&a, 0, sizeof(a));
+    n = sprintf(big, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n", HTTP_BUFFER_SIZE);
+    memset(&big[n], 'x', HTTP_BUFFER_SIZE);
+    start(big, n + HTTP_BUFFER_SIZE, 0);
+    httpSend("A", 1, NULL, onDone, &a);
+    drain();
+    CHECK(a.done == 1 && a.status == -1, "oversized response gave %d/%d", a.done, a.status);
+
+    // an empty body completes on the headers alone
+    memset(&a, 0, sizeof(a));
+    n = sprintf(big, "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+    start(big, n, 0);
+    httpSend("A", 1, onBody, onDone, &a);
+    drain();
+    CHECK(a.done == 1 && a.status == 204 && a.length == 0, "empty body gave %d/%d", a.done, a.status);
+}
+
+int main(void) {
+    int recvChunk;
+    for (recvChunk = 0; recvChunk <= (int) sizeof(lengthResponse) + 8; recvChunk++) {
+        checkPipelined(recvChunk);
+    }
+    checkRandom();
+    checkFailures();
+    return checkResult("httptest");
+}
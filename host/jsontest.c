@@ -0,0 +1,234 @@
+/*
+ * jsontest.c
+ *
+ *  Feeds the tokenizer generated shadow documents in random chunks, the way
+ *  they come off the socket, and checks that every member of the scope
+ *  object is reported once and unchanged no matter where the chunks split.
+ *  Bytes past the fed length are poisoned to catch reads ahead. Exits 1
+ *  on a mismatch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "json.h"
+#include "rng.h"
+#include "check.h"
+
+#define DOCS       3000
+#define SPLITS     8    // chunkings tried per document
+#define MAX_NEST   5
+#define DOC_SIZE   8192
+#define LOG_SIZE   4096
+
+static Rng rng;
+
+static char doc[DOC_SIZE];
+static int docLength;
+static int docEnd;              // one past the closing brace of the document
+static char expect[LOG_SIZE];   // members the generator put in the scope object
+static int expectLength;
+
+typedef struct Log {
+    char text[LOG_SIZE];
+    int length;
+    bool overflow;
+} Log;
+
+// key and value as written, one member per line
+static void logMember(char *log, int *length, const char *key, int keyLength,
+                      const char *value, int valueLength) {
+    if (*length + keyLength + valueLength + 2 < LOG_SIZE) {
+        memcpy(&log[*length], key, keyLength);
+        *length += keyLength;
+        log[(*length)++] = '=';
+        memcpy(&log[*length], value, valueLength);
+        *length += valueLength;
+        log[(*length)++] = '\n';
+    }
+}
+
+static void record(const char *key, int keyLength, const char *value, int valueLength, void *arg) {
+    Log *log = arg;
+    logMember(log->text, &log->length, key, keyLength, value, valueLength);
+}
+
+static void put(const char *text) {
+    int n = strlen(text);
+    if (docLength + n < DOC_SIZE) {
+        memcpy(&doc[docLength], text, n);
+        docLength += n;
+    }
+}
+
+static void space(void) {
+    static const char *blanks[] = { "", "", " ", "\r\n", "\t", "  " };
+    put(blanks[rngRange(&rng, 6)]);
+}
+
+static void putString(void) {
+    static const char *pieces[] = { "a", "ready", "12,7", "\\\"", "\\\\", "{", "}", "[", ",", ":", " " };
+    int i, n = rngRange(&rng, 6);
+    put("\"");
+    for (i = 0; i < n; i++) {
+        put(pieces[rngRange(&rng, 11)]);
+    }
+    put("\"");
+}
+
+static void putPrimitive(void) {
+    static const char *primitives[] = { "0", "42", "-3.5e2", "true", "false", "null" };
+    put(primitives[rngRange(&rng, 6)]);
+}
+
+static void putValue(int depth);
+
+// random members, a member of the scope object is logged unless its value is a container
+static void putObject(int depth, bool scope) {
+    static const char *keys[] = { "pac_loc", "b1_loc", "b2_q", "version", "x", "desired", "", "a\\\"b" };
+    int i, n = rngRange(&rng, 5), start;
+    const char *key;
+    put("{");
+    for (i = 0; i < n; i++) {
+        if (i > 0) {
+            put(",");
+        }
+        space();
+        key = keys[rngRange(&rng, 8)];
+        put("\"");
+        put(key);
+        put("\"");
+        space();
+        put(":");
+        space();
+        start = docLength;
+        if (depth < MAX_NEST && rngRange(&rng, 4) == 0) {
+            putValue(depth + 1);
+        } else if (rngRange(&rng, 2)) {
+            putString();
+        } else {
+            putPrimitive();
+        }
+        if (scope && doc[start] == '"') { // strings without their quotes
+            logMember(expect, &expectLength, key, strlen(key), &doc[start + 1], docLength - start - 2);
+        } else if (scope && doc[start] != '{' && doc[start] != '[') {
+            logMember(expect, &expectLength, key, strlen(key), &doc[start], docLength - start);
+        }
+        space();
+    }
+    put("}");
+}
+
+static void putArray(int depth) {
+    int i, n = rngRange(&rng, 4);
+    put("[");
+    for (i = 0; i < n; i++) {
+        if (i > 0) {
+            put(",");
+        }
+        space();
+        putValue(depth + 1);
+        space();
+    }
+    put("]");
+}
+
+// anything outside the scope object, nothing in here gets reported
+static void putValue(int depth) {
+    switch (depth < MAX_NEST ? rngRange(&rng, 4) : 2 + rngRange(&rng, 2)) {
+        case 0: putObject(depth, false); break;
+        case 1: putArray(depth); break;
+        case 2: putString(); break;
+        default: putPrimitive(); break;
+    }
+}
+
+// a shadow response with noise around the reported object
+static void generate(void) {
+    docLength = 0;
+    expectLength = 0;
+    if (rngRange(&rng, 2)) {
+        put("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n");
+    }
+    put("{");
+    space();
+    if (rngRange(&rng, 2)) {
+        put("\"metadata\": ");
+        putArray(1);
+        put(",");
+    }
+    put("\"state\":");
+    space();
+    put("{\"desired\": ");
+    putObject(2, false);
+    put(",");
+    space();
+    put("\"reported\":");
+    space();
+    putObject(2, true);
+    space();
+    put("}, \"version\": 17");
+    space();
+    put("}");
+    docEnd = docLength;
+    if (rngRange(&rng, 2)) {
+        put("\r\n{\"next\": 1}"); // trailing bytes are never looked at
+    }
+}
+
+// feeds doc in chunks of up to maxChunk bytes, the buffer grows in place
+static void feed(int maxChunk, int doneAt) {
+    static char buf[DOC_SIZE];
+    JsonParser parser;
+    Log log;
+    int length = 0, step;
+    bool done = false;
+
+    log.length = 0;
+    jsonInit(&parser, "reported", record, &log);
+    memset(buf, '"', sizeof(buf)); // poison, a read past length would show up in the log
+    while (length < docLength && !done) {
+        step = 1 + rngRange(&rng, maxChunk);
+        if (length + step > docLength) {
+            step = docLength - length;
+        }
+        memcpy(&buf[length], &doc[length], step);
+        length += step;
+        done = jsonFeed(&parser, buf, length);
+        CHECK(done == (length >= doneAt), "done is %d after %d of %d bytes", done, length, doneAt);
+        CHECK(done == jsonDone(&parser), "jsonDone disagrees with jsonFeed");
+    }
+    CHECK(done, "document never finished");
+    CHECK(log.length == expectLength && memcmp(log.text, expect, expectLength) == 0,
+          "chunks of %d of %.*s gave\n%.*swanted\n%.*s", maxChunk, docLength, doc, log.length, log.text, expectLength, expect);
+}
+
+// the shadow update the board actually receives
+static void checkShadow(void) {
+    static const char response[] =
+        "{\"state\":{\"desired\":{\"pac_loc\":\"1,1\"},\"reported\":{\"pac_loc\":\"15,25\","
+        "\"b1_q\":\"0123\",\"b2_q\":\"ready\",\"nested\":{\"b3_q\":\"3\"},\"list\":[\"x\"],\"n\":5}},"
+        "\"version\":2}";
+    strcpy(doc, response);
+    docLength = docEnd = sizeof(response) - 1;
+    strcpy(expect, "pac_loc=15,25\nb1_q=0123\nb2_q=ready\nn=5\n");
+    expectLength = strlen(expect);
+    feed(docLength, docEnd);
+    feed(1, docEnd);
+}
+
+int main(void) {
+    int i, split;
+
+    rngSeed(&rng, 2020);
+    checkShadow();
+    for (i = 0; i < DOCS && failures < 10; i++) {
+        generate();
+        for (split = 0; split < SPLITS; split++) {
+            // one byte at a time, small socket reads and the whole thing at once
+            feed(split == 0 ? 1 : split == SPLITS - 1 ? docLength : 1 << split, docEnd);
+        }
+    }
+    return checkResult("jsontest");
+}
@@ -0,0 +1,220 @@
+/*
+ * maptest.c
+ *
+ *  Checks the bitboards and packed maze tables against the byte per tile
+ *  map they replaced. Runs the x/yCollision probes against the ones that
+ *  read that map, at every position clear of walls and every velocity,
+ *  and times both.
+ *
+ *    maptest       equivalence checks, exits 1 on a mismatch
+ *    maptest -b    also runs the probe benchmark
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "map.h"
+#include "maze.h"
+#include "check.h"
+
+#define OLD_WALL   1
+#define OLD_PELLET 2
+#define OLD_PAC    3
+#define OLD_BADDIE 4
+#define PIXELS        (MAP_SIZE * TILE_PIXELS)
+#define ENTITY_PIXELS 4 // PAC_SIZE, the pac and the baddies
+#define MAX_VEL       1 // the game clamps every velocity to this
+#define BENCH_LAPS    2000
+
+// the level as it was kept before the bitboards, 1 wall, 2 pellet,
+// 3 pac spawn, 4 baddie spawn
+static const unsigned char oldMap[MAP_SIZE][MAP_SIZE] = {
+{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+{1, 0, 1, 0, 0, 0, 0, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 0, 0, 0, 0, 0, 1, 0, 1},
+{1, 0, 1, 0, 0, 0, 0, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 0, 0, 0, 0, 1, 0, 1},
+{1, 0, 1, 0, 0, 0, 0, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 0, 0, 0, 0, 1, 0, 1},
+{1, 0, 1, 0, 0, 0, 0, 0, 1, 2, 1, 1, 2, 2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 0, 0, 0, 0, 0, 1, 0, 1},
+{1, 0, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 0, 1},
+{1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 1, 0, 1},
+{1, 0, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 2, 1, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 2, 2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 2, 2, 2, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 2, 2, 2, 2, 1, 0, 1},
+{1, 0, 1, 1, 1, 1, 2, 1, 1, 2, 2, 2, 2, 2, 4, 4, 4, 4, 2, 2, 2, 2, 2, 1, 1, 2, 1, 1, 1, 1, 0, 1},
+{1, 0, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 2, 2, 2, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 2, 2, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 0, 1},
+{1, 0, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 0, 1},
+{1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 0, 1},
+{1, 0, 1, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 1, 0, 1},
+{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
+};
+
+// the collision probes as they were, one byte map read per probe
+static bool oldYCollision(int x, int y, int yVel) {
+    int blockX, blockY;
+    blockX = (x + 2) / TILE_PIXELS;
+    if (yVel < 0) {
+        blockY = (y + yVel) / TILE_PIXELS;
+    } else {
+        blockY = (y + yVel + ENTITY_PIXELS - 1) / TILE_PIXELS;
+    }
+    return oldMap[blockY][blockX] == OLD_WALL;
+}
+
+static bool oldXCollision(int x, int y, int xVel) {
+    int blockX, blockY;
+    blockY = (y + 2) / TILE_PIXELS;
+    if (xVel < 0) {
+        blockX = (x + xVel) / TILE_PIXELS;
+    } else {
+        blockX = (x + xVel + ENTITY_PIXELS - 1) / TILE_PIXELS;
+    }
+    return oldMap[blockY][blockX] == OLD_WALL;
+}
+
+static bool oldOpen(int tx, int ty) {
+    return tx >= 0 && ty >= 0 && tx < MAP_SIZE && ty < MAP_SIZE && oldMap[ty][tx] != OLD_WALL;
+}
+
+static unsigned char oldMask(int tx, int ty) {
+    return (oldOpen(tx, ty - 1) ? OPEN_UP : 0) | (oldOpen(tx - 1, ty) ? OPEN_LEFT : 0) |
+           (oldOpen(tx + 1, ty) ? OPEN_RIGHT : 0) | (oldOpen(tx, ty + 1) ? OPEN_DOWN : 0);
+}
+
+// the game never moves an entity into a wall, so those are the only
+// positions a probe is asked about
+static bool clearOfWalls(int x, int y) {
+    return oldMap[y / TILE_PIXELS][x / TILE_PIXELS] != OLD_WALL &&
+           oldMap[y / TILE_PIXELS][(x + ENTITY_PIXELS - 1) / TILE_PIXELS] != OLD_WALL &&
+           oldMap[(y + ENTITY_PIXELS - 1) / TILE_PIXELS][x / TILE_PIXELS] != OLD_WALL &&
+           oldMap[(y + ENTITY_PIXELS - 1) / TILE_PIXELS][(x + ENTITY_PIXELS - 1) / TILE_PIXELS] != OLD_WALL;
+}
+
+static void checkBoards(void) {
+    int tx, ty, pellets = 0, baddies = 0;
+
+    resetPellets();
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            unsigned char old = oldMap[ty][tx];
+            CHECK(!IS_WALL(tx, ty) == (old != OLD_WALL), "wall bit of %d,%d is %d, the map has %d",
+                  tx, ty, (int) IS_WALL(tx, ty), old);
+            CHECK(!HAS_PELLET(tx, ty) == (old != OLD_PELLET), "pellet bit of %d,%d is %d, the map has %d",
+                  tx, ty, (int) HAS_PELLET(tx, ty), old);
+            if (old == OLD_PELLET) {
+                pellets++;
+            } else if (old == OLD_PAC) {
+                CHECK(pacSpawn.x == tx && pacSpawn.y == ty, "pac spawns at %d,%d, the map has %d,%d",
+                      pacSpawn.x, pacSpawn.y, tx, ty);
+            } else if (old == OLD_BADDIE) {
+                // the spawns were taken in scan order
+                CHECK(baddies < NUM_ENEMY_SPAWNS && enemySpawns[baddies].x == tx &&
+                      enemySpawns[baddies].y == ty, "baddie spawn %d is not at %d,%d", baddies, tx, ty);
+                baddies++;
+            }
+        }
+    }
+    CHECK(baddies == NUM_ENEMY_SPAWNS, "the map has %d baddie spawns", baddies);
+    CHECK(countPellets() == pellets, "%d pellets counted, the map has %d", countPellets(), pellets);
+
+    // eating clears exactly one bit and a reset restores the level
+    EAT_PELLET(3, 6);
+    CHECK(!HAS_PELLET(3, 6) && countPellets() == pellets - 1, "eating 3,6 left %d pellets", countPellets());
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            EAT_PELLET(tx, ty);
+        }
+    }
+    CHECK(countPellets() == 0, "%d pellets left after eating every tile", countPellets());
+    resetPellets();
+    CHECK(countPellets() == pellets, "%d pellets after a reset, the map has %d", countPellets(), pellets);
+}
+
+static void checkMasks(void) {
+    int tx, ty;
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            CHECK(tileMask(tx, ty) == oldMask(tx, ty), "open mask of %d,%d is %x, the map gives %x",
+                  tx, ty, tileMask(tx, ty), oldMask(tx, ty));
+        }
+    }
+}
+
+typedef bool (*Probe)(int x, int y, int vel);
+
+static int numPositions = 0;
+static unsigned char posX[PIXELS * PIXELS], posY[PIXELS * PIXELS];
+
+// every position clear of walls with every velocity the game clamps to
+static void checkProbes(void) {
+    int x, y, vel, closed = 0;
+    for (y = 0; y <= PIXELS - ENTITY_PIXELS; y++) {
+        for (x = 0; x <= PIXELS - ENTITY_PIXELS; x++) {
+            if (!clearOfWalls(x, y)) continue;
+            posX[numPositions] = x;
+            posY[numPositions++] = y;
+            for (vel = -MAX_VEL; vel <= MAX_VEL; vel++) {
+                CHECK(yCollision(x, y, vel) == oldYCollision(x, y, vel), "yCollision(%d, %d, %d) is %d, it was %d",
+                      x, y, vel, (int) yCollision(x, y, vel), (int) oldYCollision(x, y, vel));
+                CHECK(xCollision(x, y, vel) == oldXCollision(x, y, vel), "xCollision(%d, %d, %d) is %d, it was %d",
+                      x, y, vel, (int) xCollision(x, y, vel), (int) oldXCollision(x, y, vel));
+                closed += oldYCollision(x, y, vel) + oldXCollision(x, y, vel);
+            }
+        }
+    }
+    CHECK(closed > 0, "no probe hit a wall");
+    printf("%d positions probed against the old x/yCollision, %d probes hit a wall\n", numPositions, closed);
+}
+
+// both pairs are called through pointers, so neither gets inlined here
+static double timeProbes(Probe probeY, Probe probeX, unsigned long *acc) {
+    clock_t start = clock();
+    int lap, i, vel;
+    for (lap = 0; lap < BENCH_LAPS; lap++) {
+        for (i = 0; i < numPositions; i++) {
+            for (vel = -MAX_VEL; vel <= MAX_VEL; vel++) {
+                *acc += probeY(posX[i], posY[i], vel) + probeX(posX[i], posY[i], vel);
+            }
+        }
+    }
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+// the checkProbes sweep, timed both ways
+static void bench(void) {
+    Probe volatile oldY = oldYCollision, oldX = oldXCollision, newY = yCollision, newX = xCollision;
+    unsigned long acc = 0, probes = (unsigned long) BENCH_LAPS * numPositions * (2 * MAX_VEL + 1) * 2;
+    double oldTime, newTime;
+
+    oldTime = timeProbes(oldY, oldX, &acc);
+    newTime = timeProbes(newY, newX, &acc);
+    printf("%lu collision probes: byte map %.1f ns, open mask %.1f ns (%lu)\n", probes,
+           oldTime * 1e9 / probes, newTime * 1e9 / probes, acc);
+}
+
+int main(int argc, char **argv) {
+    buildMaze();
+    checkBoards();
+    checkMasks();
+    checkProbes();
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        bench();
+    }
+    return checkResult("maptest");
+}
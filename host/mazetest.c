@@ -0,0 +1,219 @@
+/*
+ * mazetest.c
+ *
+ *  Checks the junction graph against a tile by tile walk of the walls,
+ *  that it fits the junction table and that a corridor walk from any open
+ *  tile ends where the walls say. Compares the per frame work of the old
+ *  per step probing with the countdown between junctions.
+ *
+ *    mazetest       graph checks, exits 1 on a mismatch
+ *    mazetest -d    also prints the junctions and their corridors
+ *    mazetest -b    also times a lap over every corridor both ways
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "map.h"
+#include "maze.h"
+#include "check.h"
+
+#define MAZE_JUNCTIONS 112
+#define BENCH_LAPS     20000
+
+static const char dirName[4] = { 'U', 'L', 'R', 'D' };
+
+static bool isOpen(int tx, int ty) {
+    return tx >= 0 && ty >= 0 && tx < MAP_SIZE && ty < MAP_SIZE && !IS_WALL(tx, ty);
+}
+
+// the old probe, four wall reads, done on every pixel a baddie moved
+static int validMoves(int tx, int ty) {
+    int dir, moves = 0;
+    for (dir = 0; dir < 4; dir++) {
+        moves |= isOpen(tx + dirX[dir], ty + dirY[dir]) << dir;
+    }
+    return moves;
+}
+
+static bool straight(int moves) {
+    return moves == (OPEN_UP | OPEN_DOWN) || moves == (OPEN_LEFT | OPEN_RIGHT);
+}
+
+static int findJunction(int tx, int ty) {
+    int i;
+    for (i = 0; i < junctionCount(); i++) {
+        if (getJunction(i)->x == tx && getJunction(i)->y == ty) return i;
+    }
+    return NO_JUNCTION;
+}
+
+static void checkGraph(void) {
+    const Junction *j;
+    int i, dir, tx, ty, length, found = 0;
+
+    CHECK(junctionCount() == MAZE_JUNCTIONS, "%d junctions, the maze has %d", junctionCount(), MAZE_JUNCTIONS);
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            bool expect = isOpen(tx, ty) && !straight(validMoves(tx, ty));
+            CHECK(isJunction(tx, ty) == expect, "%d,%d is%s a junction", tx, ty, expect ? " not" : "");
+            found += expect;
+        }
+    }
+    CHECK(found == junctionCount(), "%d junction tiles, %d in the graph", found, junctionCount());
+
+    for (i = 0; i < junctionCount(); i++) {
+        j = getJunction(i);
+        CHECK(findJunction(j->x, j->y) == i, "junction %d at %d,%d is listed twice", i, j->x, j->y);
+        for (dir = 0; dir < 4; dir++) {
+            if (!isOpen(j->x + dirX[dir], j->y + dirY[dir])) {
+                CHECK(j->next[dir] == NO_JUNCTION, "junction %d leads %c into a wall", i, dirName[dir]);
+                continue;
+            }
+            // step tile by tile until the walls stop looking like a corridor
+            tx = j->x;
+            ty = j->y;
+            length = 0;
+            do {
+                tx += dirX[dir];
+                ty += dirY[dir];
+                length++;
+            } while (straight(validMoves(tx, ty)));
+            CHECK(j->next[dir] == findJunction(tx, ty) && j->length[dir] == length,
+                  "junction %d going %c ends at %d after %d, the walls say %d,%d after %d",
+                  i, dirName[dir], j->next[dir], j->length[dir], tx, ty, length);
+            // corridors are two way
+            if (j->next[dir] != NO_JUNCTION) {
+                const Junction *back = getJunction(j->next[dir]);
+                CHECK(back->next[3 - dir] == i && back->length[3 - dir] == j->length[dir],
+                      "corridor %d %c does not lead back", i, dirName[dir]);
+            }
+        }
+    }
+}
+
+// walks from every open tile in every direction end on the next junction,
+// or right away on a wall
+static void checkWalks(void) {
+    unsigned char next, length;
+    int tx, ty, dir, ex, ey;
+
+    CHECK(junctionCount() < MAX_JUNCTIONS, "%d junctions fill the table of %d", junctionCount(), MAX_JUNCTIONS);
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            for (dir = 0; dir < 4; dir++) {
+                if (IS_WALL(tx, ty)) continue;
+                next = walkCorridor(tx, ty, dir, &length);
+                if (!isOpen(tx + dirX[dir], ty + dirY[dir])) {
+                    CHECK(next == NO_JUNCTION && length == 0, "%d,%d going %c into a wall reached %d",
+                          tx, ty, dirName[dir], next);
+                    continue;
+                }
+                CHECK(next != NO_JUNCTION, "%d,%d going %c reached no junction", tx, ty, dirName[dir]);
+                if (next == NO_JUNCTION) continue;
+                ex = getJunction(next)->x;
+                ey = getJunction(next)->y;
+                CHECK(ex == tx + dirX[dir] * length && ey == ty + dirY[dir] * length,
+                      "%d,%d going %c reached %d,%d, not %d tiles on", tx, ty, dirName[dir], ex, ey, length);
+            }
+        }
+    }
+}
+
+static void dump(void) {
+    const Junction *j;
+    int i, dir;
+    printf("%d junctions, corridors as direction, next junction and length\n", junctionCount());
+    for (i = 0; i < junctionCount(); i++) {
+        j = getJunction(i);
+        printf("%3d %2d,%2d", i, j->x, j->y);
+        for (dir = 0; dir < 4; dir++) {
+            if (j->next[dir] == NO_JUNCTION) {
+                printf("   %c  -    ", dirName[dir]);
+            } else {
+                printf("   %c %3d %2d", dirName[dir], j->next[dir], j->length[dir]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+// every corridor of the maze walked pixel by pixel, probing the walls each step
+static unsigned long probeLap(void) {
+    const Junction *j;
+    unsigned long work = 0;
+    int i, dir, pixel, length;
+    for (i = 0; i < junctionCount(); i++) {
+        j = getJunction(i);
+        for (dir = 0; dir < 4; dir++) {
+            length = j->length[dir] * TILE_PIXELS;
+            for (pixel = 1; pixel <= length; pixel++) {
+                work += validMoves(j->x + dirX[dir] * pixel / TILE_PIXELS, j->y + dirY[dir] * pixel / TILE_PIXELS);
+            }
+        }
+    }
+    return work;
+}
+
+// the same lap counting pixels down and only reading the graph at the far end
+static unsigned long countdownLap(void) {
+    const Junction *j;
+    unsigned long work = 0;
+    int i, dir, steps;
+    for (i = 0; i < junctionCount(); i++) {
+        j = getJunction(i);
+        for (dir = 0; dir < 4; dir++) {
+            steps = j->length[dir] * TILE_PIXELS;
+            while (steps > 0) {
+                steps--;
+            }
+            if (j->next[dir] != NO_JUNCTION) {
+                work += tileMask(getJunction(j->next[dir])->x, getJunction(j->next[dir])->y);
+            }
+        }
+    }
+    return work;
+}
+
+static void bench(void) {
+    volatile unsigned long sink = 0;
+    clock_t start;
+    double probeTime, countdownTime;
+    long steps = 0;
+    int i, dir;
+
+    for (i = 0; i < junctionCount(); i++) {
+        for (dir = 0; dir < 4; dir++) {
+            steps += getJunction(i)->length[dir] * TILE_PIXELS;
+        }
+    }
+
+    start = clock();
+    for (i = 0; i < BENCH_LAPS; i++) {
+        sink += probeLap();
+    }
+    probeTime = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (i = 0; i < BENCH_LAPS; i++) {
+        sink += countdownLap();
+    }
+    countdownTime = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%ld pixel steps per lap: probing %.2f ns, countdown %.2f ns per step (%lu)\n", steps,
+           probeTime * 1e9 / BENCH_LAPS / steps, countdownTime * 1e9 / BENCH_LAPS / steps, (unsigned long) sink);
+}
+
+int main(int argc, char **argv) {
+    buildMaze();
+    checkGraph();
+    checkWalks();
+    if (argc > 1 && strcmp(argv[1], "-d") == 0) {
+        dump();
+    } else if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        bench();
+    }
+    return checkResult("mazetest");
+}
@@ -0,0 +1,254 @@
+/*
+ * mqtttest.c
+ *
+ *  Runs the MQTT client against a broker stand-in behind sl_Send and
+ *  sl_Recv. Checks the packets the board sends byte for byte, the framing
+ *  of what the broker sends back at every split, QoS 1 acks, skipped
+ *  oversized packets, keepalive pings, dropped sessions, and that a
+ *  command is delivered on the poll it arrives. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "simplelink.h"
+#include "mqtt.h"
+#include "check.h"
+
+#define SOCKET     9
+#define STREAM_MAX (3 * MQTT_BUFFER_SIZE)
+#define COMMAND_TOPIC "$aws/things/CC3200_Thing/shadow/update/accepted"
+
+// broker side: what the board sent and what the broker has queued for it
+static unsigned char fromBoard[STREAM_MAX];
+static int fromBoardLength;
+static unsigned char toBoard[STREAM_MAX];
+static int toBoardLength, toBoardPos;
+static int chunk;      // bytes per sl_Recv, 0 for all there is
+static bool hangUp;
+
+int sl_Send(int sd, const void *buf, int len, int flags) {
+    (void) flags;
+    CHECK(sd == SOCKET, "sent on socket %d", sd);
+    if (hangUp) {
+        return -1;
+    }
+    if (fromBoardLength + len <= STREAM_MAX) {
+        memcpy(&fromBoard[fromBoardLength], buf, len);
+        fromBoardLength += len;
+    }
+    return len;
+}
+
+int sl_Recv(int sd, void *buf, int len, int flags) {
+    int n = toBoardLength - toBoardPos;
+    CHECK(sd == SOCKET && flags == SL_MSG_DONTWAIT, "blocking read on socket %d", sd);
+    if (n == 0) {
+        return hangUp ? 0 : SL_EAGAIN;
+    }
+    if (chunk > 0 && n > chunk) {
+        n = chunk;
+    }
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, &toBoard[toBoardPos], n);
+    toBoardPos += n;
+    return n;
+}
+
+static void brokerSend(const unsigned char *bytes, int length) {
+    memcpy(&toBoard[toBoardLength], bytes, length);
+    toBoardLength += length;
+}
+
+// a PUBLISH from the broker, QoS 1 when id is not 0
+static void brokerPublish(const char *topic, const char *payload, int payloadLength, int id) {
+    unsigned char head[8];
+    int topicLength = strlen(topic), size = 2 + topicLength + (id ? 2 : 0) + payloadLength, n = 1;
+    head[0] = id ? 0x32 : 0x30;
+    do {
+        head[n] = size & 0x7F;
+        size >>= 7;
+        head[n++] |= size > 0 ? 0x80 : 0;
+    } while (size > 0);
+    head[n++] = topicLength >> 8;
+    head[n++] = topicLength & 0xFF;
+    brokerSend(head, n);
+    brokerSend((const unsigned char *) topic, topicLength);
+    if (id) {
+        head[0] = id >> 8;
+        head[1] = id & 0xFF;
+        brokerSend(head, 2);
+    }
+    brokerSend((const unsigned char *) payload, payloadLength);
+}
+
+// messages the board handed to the callback
+static char lastTopic[128], lastPayload[MQTT_BUFFER_SIZE];
+static int lastPayloadLength, messages;
+
+static void onMessage(const char *topic, int topicLength, const char *payload, int payloadLength, void *arg) {
+    (void) arg;
+    memcpy(lastTopic, topic, topicLength);
+    lastTopic[topicLength] = '\0';
+    memcpy(lastPayload, payload, payloadLength);
+    lastPayloadLength = payloadLength;
+    messages++;
+}
+
+static void reset(int recvChunk) {
+    fromBoardLength = toBoardLength = toBoardPos = 0;
+    chunk = recvChunk;
+    hangUp = false;
+    messages = 0;
+}
+
+static const unsigned char connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+// connects and lets the broker accept, the CONNECT is left in fromBoard
+static void session(int recvChunk) {
+    reset(recvChunk);
+    CHECK(mqttConnect(SOCKET, "CC3200_Thing", onMessage, NULL), "CONNECT not sent");
+    brokerSend(connack, sizeof(connack));
+    while (toBoardPos < toBoardLength) {
+        mqttPoll();
+    }
+    CHECK(mqttConnected() && mqttAlive(), "CONNACK not taken");
+}
+
+static void checkSent(void) {
+    static const unsigned char connect[] = {
+        0x10, 24, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, MQTT_KEEPALIVE, 0, 12,
+        'C', 'C', '3', '2', '0', '0', '_', 'T', 'h', 'i', 'n', 'g'
+    };
+    static const unsigned char subscribe[] = { 0x82, 10, 0, 0, 0, 5, 't', 'o', 'p', 'i', 'c', 0 };
+    static const unsigned char publish[] = { 0x30, 10, 0, 3, 'g', 'e', 't', '{', '"', 'a', '"', '}' };
+    static char payload[300];
+    int i;
+
+    session(0);
+    CHECK(fromBoardLength == sizeof(connect) && memcmp(fromBoard, connect, sizeof(connect)) == 0,
+          "CONNECT bytes differ");
+
+    fromBoardLength = 0;
+    CHECK(mqttSubscribe("topic"), "SUBSCRIBE not sent");
+    CHECK(fromBoardLength == sizeof(subscribe), "SUBSCRIBE is %d bytes", fromBoardLength);
+    CHECK(memcmp(fromBoard, subscribe, 2) == 0 && memcmp(&fromBoard[4], &subscribe[4], sizeof(subscribe) - 4) == 0,
+          "SUBSCRIBE bytes differ");
+    CHECK(fromBoard[2] << 8 | fromBoard[3], "packet id 0 on a SUBSCRIBE");
+
+    fromBoardLength = 0;
+    CHECK(mqttPublish("get", "{\"a\"}", 5), "PUBLISH not sent");
+    CHECK(fromBoardLength == sizeof(publish) && memcmp(fromBoard, publish, sizeof(publish)) == 0,
+          "PUBLISH bytes differ");
+
+    // past 127 bytes the remaining length takes two bytes
+    memset(payload, 'x', sizeof(payload));
+    fromBoardLength = 0;
+    mqttPublish("t", payload, sizeof(payload));
+    i = 2 + 1 + sizeof(payload);
+    CHECK(fromBoardLength == 3 + i && fromBoard[1] == (0x80 | (i & 0x7F)) && fromBoard[2] == i >> 7,
+          "long PUBLISH header %02x %02x", fromBoard[1], fromBoard[2]);
+
+    // topics that do not fit the head buffer are refused
+    memset(payload, 't', sizeof(payload));
+    payload[sizeof(payload) - 1] = '\0';
+    CHECK(!mqttPublish(payload, "", 0) && !mqttSubscribe(payload), "an oversized topic was sent");
+}
+
+// one command at every split of the stream, delivered the poll it completes
+static void checkReceived(void) {
+    static const char command[] = "{\"state\":{\"reported\":{\"b1_q\":\"0123\"}}}";
+    static const unsigned char puback[] = { 0x40, 0x02, 0x12, 0x34 };
+    int recvChunk, before, polls;
+
+    for (recvChunk = 0; recvChunk <= 64; recvChunk++) {
+        session(recvChunk);
+        brokerPublish(COMMAND_TOPIC, command, sizeof(command) - 1, 0);
+        for (polls = 0; messages == 0 && polls < 200; polls++) {
+            before = toBoardPos;
+            mqttPoll();
+            // latency: nothing may wait for a later poll once the bytes are in
+            CHECK(messages == 1 || toBoardPos < toBoardLength || before == toBoardPos,
+                  "complete message held back with %d byte reads", recvChunk);
+        }
+        CHECK(messages == 1 && strcmp(lastTopic, COMMAND_TOPIC) == 0 && lastPayloadLength == sizeof(command) - 1 &&
+              memcmp(lastPayload, command, lastPayloadLength) == 0, "command lost with %d byte reads", recvChunk);
+        CHECK(polls == (recvChunk == 0 ? 1 : (toBoardLength - (int) sizeof(connack) + recvChunk - 1) / recvChunk),
+              "command took %d polls with %d byte reads", polls, recvChunk);
+    }
+
+    // QoS 1 is acked with its packet id
+    session(0);
+    fromBoardLength = 0;
+    brokerPublish(COMMAND_TOPIC, command, sizeof(command) - 1, 0x1234);
+    mqttPoll();
+    CHECK(messages == 1 && lastPayloadLength == sizeof(command) - 1, "QoS 1 message lost");
+    CHECK(fromBoardLength == sizeof(puback) && memcmp(fromBoard, puback, sizeof(puback)) == 0, "PUBACK differs");
+
+    // a document too big for the buffer is skipped, the next one still arrives
+    {
+        static char big[MQTT_BUFFER_SIZE + 100];
+        memset(big, ' ', sizeof(big));
+        session(200);
+        brokerPublish(COMMAND_TOPIC, big, sizeof(big), 0);
+        brokerPublish(COMMAND_TOPIC, command, sizeof(command) - 1, 0);
+        for (polls = 0; polls < 100 && toBoardPos < toBoardLength; polls++) {
+            mqttPoll();
+        }
+        CHECK(messages == 1 && lastPayloadLength == sizeof(command) - 1 && mqttAlive(),
+              "%d messages after an oversized one", messages);
+    }
+}
+
+static void checkSession(void) {
+    static const unsigned char refused[] = { 0x20, 0x02, 0x00, 0x05 };
+    static const unsigned char badLength[] = { 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+    int polls;
+
+    // an idle session pings before the broker's keepalive runs out
+    session(0);
+    fromBoardLength = 0;
+    for (polls = 0; polls < MQTT_PING_POLLS; polls++) {
+        mqttPoll();
+    }
+    CHECK(fromBoardLength == 2 && fromBoard[0] == 0xC0 && fromBoard[1] == 0, "no PINGREQ after %d idle polls", polls);
+    CHECK(MQTT_PING_POLLS / 30 < MQTT_KEEPALIVE, "pings come after the keepalive");
+
+    // refused, never answered, hung up or garbled sessions are dropped
+    reset(0);
+    mqttConnect(SOCKET, "CC3200_Thing", onMessage, NULL);
+    brokerSend(refused, sizeof(refused));
+    mqttPoll();
+    CHECK(!mqttConnected() && !mqttAlive(), "refused session kept");
+
+    reset(0);
+    mqttConnect(SOCKET, "CC3200_Thing", onMessage, NULL);
+    for (polls = 0; polls <= MQTT_CONNECT_POLLS && mqttAlive(); polls++) {
+        mqttPoll();
+    }
+    CHECK(!mqttAlive() && polls == MQTT_CONNECT_POLLS + 1, "unanswered session dropped after %d polls", polls);
+
+    session(0);
+    hangUp = true;
+    mqttPoll();
+    CHECK(!mqttAlive(), "session kept after the broker hung up");
+
+    session(0);
+    brokerSend(badLength, sizeof(badLength));
+    mqttPoll();
+    CHECK(!mqttAlive(), "session kept after a malformed length");
+
+    session(0);
+    hangUp = true;
+    CHECK(!mqttPublish("t", "x", 1) && !mqttAlive(), "failed send kept the session");
+}
+
+int main(void) {
+    checkSent();
+    checkReceived();
+    checkSession();
+    return checkResult("mqtttest");
+}
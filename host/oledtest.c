@@ -0,0 +1,235 @@
+/*
+ * oledtest.c
+ *
+ *  Runs the SSD1351 driver against the panel stand-in. Checks that the
+ *  streaming window writes hold the select for the whole payload, the bus
+ *  transactions and bytes each primitive costs, and that random draws,
+ *  direct and through the framebuffer, leave the panel showing what was
+ *  drawn. Also checks that fillScreen clears the panel with one window
+ *  and a repeated pattern, whatever the color was before and with the
+ *  framebuffer on or off. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "framebuffer.h"
+#include "panel.h"
+#include "rng.h"
+#include "check.h"
+
+#define RANDOM_DRAWS 4000
+
+static unsigned int expect[HEIGHT][WIDTH];
+static unsigned char image[32 * 32 * 2];
+
+static void expectRect(int x, int y, int w, int h, unsigned int color) {
+    int i, j;
+    for (j = y; j < y + h; j++) {
+        for (i = x; i < x + w; i++) {
+            if (i >= 0 && j >= 0 && i < WIDTH && j < HEIGHT) {
+                expect[j][i] = color;
+            }
+        }
+    }
+}
+
+static void expectImage(int x, int y, int w, int h, const unsigned char *pixels) {
+    int i, j;
+    for (j = 0; j < h; j++) {
+        for (i = 0; i < w; i++) {
+            if (x + i >= 0 && y + j >= 0 && x + i < WIDTH && y + j < HEIGHT) {
+                expect[y + j][x + i] = pixels[(j * w + i) * 2] << 8 | pixels[(j * w + i) * 2 + 1];
+            }
+        }
+    }
+}
+
+static int mismatches(void) {
+    int x, y, n = 0;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            n += panelPixel(x, y) != expect[y][x];
+        }
+    }
+    return n;
+}
+
+// one random primitive drawn on the panel and into expect, fillRect and the
+// lines keep to the screen, their clipping cuts a pixel short at the far edge
+static void randomDraw(Rng *rng) {
+    unsigned int color = rngNext(rng) & 0xFFFF;
+    int x = rngRange(rng, WIDTH), y = rngRange(rng, HEIGHT), w, h, i;
+
+    switch (rngRange(rng, 6)) {
+        case 0:
+            w = 1 + rngRange(rng, WIDTH - x);
+            h = 1 + rngRange(rng, HEIGHT - y);
+            fillRect(x, y, w, h, color);
+            expectRect(x, y, w, h, color);
+            break;
+        case 1:
+            x -= 16;
+            y -= 16;
+            w = 1 + rngRange(rng, 48);
+            h = 1 + rngRange(rng, 48);
+            fillRectFast(x, y, w, h, color);
+            expectRect(x, y, w, h, color);
+            break;
+        case 2:
+            w = 1 + rngRange(rng, WIDTH - x);
+            drawFastHLine(x, y, w, color);
+            expectRect(x, y, w, 1, color);
+            break;
+        case 3:
+            h = 1 + rngRange(rng, HEIGHT - y);
+            drawFastVLine(x, y, h, color);
+            expectRect(x, y, 1, h, color);
+            break;
+        case 4:
+            x -= 8;
+            y -= 8;
+            drawPixel(x, y, color);
+            expectRect(x, y, 1, 1, color);
+            break;
+        default:
+            x -= 16;
+            y -= 16;
+            w = 1 + rngRange(rng, 32);
+            h = 1 + rngRange(rng, 32);
+            for (i = 0; i < w * h * 2; i++) {
+                image[i] = rngNext(rng);
+            }
+            drawImage(x, y, w, h, image);
+            expectImage(x, y, w, h, image);
+            break;
+    }
+}
+
+// the bus cost of the primitives with the framebuffer off
+static void checkCosts(void) {
+    PanelStats before;
+    unsigned long perByte;
+
+    panelReset();
+    Adafruit_Init();
+    CHECK(panelStats.unselected == 0, "%lu init bytes went out unselected", panelStats.unselected);
+
+    // SETCOLUMN and SETROW are a command and a parameter burst each, then
+    // WRITERAM and one burst for all of the pixels
+    before = panelStats;
+    fillRect(0, 0, WIDTH, HEIGHT, 0x1234);
+    expectRect(0, 0, WIDTH, HEIGHT, 0x1234);
+    CHECK(panelStats.selects - before.selects == 6 && panelStats.windows - before.windows == 1,
+          "full screen fillRect took %lu selects", panelStats.selects - before.selects);
+    CHECK(panelStats.bytes - before.bytes == 3 + 4 + WIDTH * HEIGHT * 2,
+          "full screen fillRect sent %lu bytes", panelStats.bytes - before.bytes);
+    perByte = panelStats.bytes - before.bytes; // what one select per byte used to cost
+
+    before = panelStats;
+    drawPixel(5, 7, 0xF800);
+    expectRect(5, 7, 1, 1, 0xF800);
+    CHECK(panelStats.selects - before.selects == 6 && panelStats.bytes - before.bytes == 9,
+          "drawPixel took %lu selects and %lu bytes", panelStats.selects - before.selects,
+          panelStats.bytes - before.bytes);
+
+    before = panelStats;
+    drawImage(120, 124, 32, 32, image); // clipped to 8x4
+    expectImage(120, 124, 32, 32, image);
+    CHECK(panelStats.selects - before.selects == 6 && panelStats.bytes - before.bytes == 7 + 8 * 4 * 2,
+          "clipped drawImage took %lu selects and %lu bytes", panelStats.selects - before.selects,
+          panelStats.bytes - before.bytes);
+
+    // the fill pattern goes out on the DMA, a window setup and one repeat
+    before = panelStats;
+    fillRectFast(-10, 100, 40, 40, 0x07E0);
+    expectRect(-10, 100, 40, 40, 0x07E0);
+    CHECK(panelStats.selects == before.selects && panelStats.descriptors - before.descriptors == 6,
+          "fillRectFast took %lu selects and %lu transfers", panelStats.selects - before.selects,
+          panelStats.descriptors - before.descriptors);
+    CHECK(panelStats.bytes - before.bytes == 7 + 30 * 28 * 2, "fillRectFast sent %lu bytes",
+          panelStats.bytes - before.bytes);
+
+    CHECK(mismatches() == 0, "%d pixels differ after the cost checks", mismatches());
+    printf("full screen fillRect: 6 transactions, %lu with a select per byte\n", perByte);
+}
+
+// fillScreen used to send a writeData pair, each its own select, per pixel
+static void checkFillScreen(void) {
+    static const unsigned int colors[] = { 0x0000, 0x0000, 0xFFFF, 0x07E0, 0x0000, 0xF81F };
+    PanelStats before;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+        before = panelStats;
+        fillScreen(colors[i]);
+        expectRect(0, 0, WIDTH, HEIGHT, colors[i]);
+        CHECK(panelStats.selects == before.selects && panelStats.descriptors - before.descriptors == 6 &&
+              panelStats.windows - before.windows == 1,
+              "fillScreen(0x%04X) took %lu selects and %lu transfers", colors[i],
+              panelStats.selects - before.selects, panelStats.descriptors - before.descriptors);
+        CHECK(panelStats.bytes - before.bytes == 3 + 4 + WIDTH * HEIGHT * 2, "fillScreen(0x%04X) sent %lu bytes",
+              colors[i], panelStats.bytes - before.bytes);
+    }
+    CHECK(mismatches() == 0, "%d pixels differ after fillScreen", mismatches());
+
+    // with the framebuffer on the clear still goes out as the pattern, the
+    // rects drawn before it are dropped and the copy is filled as well
+    setFrameBuffer(true);
+    fillRect(20, 20, 16, 16, 0x001F);
+    before = panelStats;
+    fillScreen(0x7BEF);
+    expectRect(0, 0, WIDTH, HEIGHT, 0x7BEF);
+    CHECK(panelStats.selects == before.selects && panelStats.descriptors - before.descriptors == 6 &&
+              panelStats.bytes - before.bytes == 3 + 4 + WIDTH * HEIGHT * 2,
+          "fillScreen through the framebuffer took %lu transfers and %lu bytes",
+          panelStats.descriptors - before.descriptors, panelStats.bytes - before.bytes);
+    CHECK(flushFrame() == 0, "a rect drawn before the clear was flushed after it");
+    fillRect(40, 50, 8, 4, 0xF800);
+    expectRect(40, 50, 8, 4, 0xF800);
+    CHECK(flushFrame() == 8 * 4 * 2, "the rect drawn after the clear was not flushed alone");
+    fbMarkDirty(0, 0, WIDTH, HEIGHT);
+    flushFrame();
+    setFrameBuffer(false);
+    CHECK(mismatches() == 0, "%d pixels differ after fillScreen through the framebuffer", mismatches());
+    printf("fillScreen: 6 transactions and %d bytes, %d selects a writeData pair per pixel\n",
+           3 + 4 + WIDTH * HEIGHT * 2, 7 + WIDTH * HEIGHT * 2);
+}
+
+static void checkRandom(bool frameBuffer) {
+    PanelStats before = panelStats;
+    int i;
+    Rng rng;
+
+    rngSeed(&rng, frameBuffer ? 1351 : 1331);
+    setFrameBuffer(frameBuffer);
+    for (i = 0; i < RANDOM_DRAWS; i++) {
+        randomDraw(&rng);
+        if (frameBuffer && i % 7 == 6) {
+            flushFrame();
+        }
+    }
+    if (frameBuffer) {
+        flushFrame();
+        CHECK(panelStats.selects == before.selects, "the framebuffer used the polled path");
+    }
+    setFrameBuffer(false);
+    CHECK(panelStats.unselected == 0, "%lu bytes went out unselected", panelStats.unselected);
+    CHECK(mismatches() == 0, "%d pixels differ after %d random draws%s", mismatches(), RANDOM_DRAWS,
+          frameBuffer ? " through the framebuffer" : "");
+    printf("%d random draws%s: %lu transactions, %lu bytes\n", RANDOM_DRAWS,
+           frameBuffer ? " through the framebuffer" : "", panelTransactions() - (before.selects + before.descriptors),
+           panelStats.bytes - before.bytes);
+}
+
+int main(void) {
+    // the framebuffer starts out black like the panel, so it goes first
+    panelReset();
+    checkRandom(true);
+    checkCosts();
+    checkFillScreen();
+    checkRandom(false);
+    return checkResult("oledtest");
+}
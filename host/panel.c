@@ -0,0 +1,187 @@
+/*
+ * panel.c
+ *
+ *  SSD1351 stand-in, see panel.h. The DMA queue runs each descriptor as it
+ *  is queued, so it is never busy.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "hw_memmap.h"
+#include "gpio.h"
+#include "spi.h"
+#include "Adafruit_SSD1351.h"
+#include "spi_dma.h"
+#include "panel.h"
+
+PanelStats panelStats;
+
+static unsigned char ram[SSD1351HEIGHT][SSD1351WIDTH * 2];
+static unsigned char dcLevel;  // DMA_COMMAND or DMA_DATA
+static bool selected, csEnabled;
+static unsigned char command;
+static int params;             // data bytes since the command
+static int colStart, colEnd, rowStart, rowEnd;
+static long cursor;            // byte in the WRITERAM window
+
+void panelReset(void) {
+    memset(ram, 0, sizeof(ram));
+    memset(&panelStats, 0, sizeof(panelStats));
+    dcLevel = DMA_DATA;
+    selected = csEnabled = false;
+    command = 0;
+    params = 0;
+    colStart = rowStart = 0;
+    colEnd = SSD1351WIDTH - 1;
+    rowEnd = SSD1351HEIGHT - 1;
+}
+
+unsigned int panelPixel(int x, int y) {
+    return ram[y][x * 2] << 8 | ram[y][x * 2 + 1];
+}
+
+unsigned long panelTransactions(void) {
+    return panelStats.selects + panelStats.descriptors;
+}
+
+// one byte into the controller, data bytes are the parameters of the last command
+static void clockByte(unsigned char dc, unsigned char byte) {
+    int w, h;
+
+    panelStats.bytes++;
+    if (dc == DMA_COMMAND) {
+        panelStats.commands++;
+        command = byte;
+        params = 0;
+        cursor = 0;
+        if (byte == SSD1351_CMD_WRITERAM) {
+            panelStats.windows++;
+        }
+        return;
+    }
+    switch (command) {
+        case SSD1351_CMD_SETCOLUMN:
+            if (params == 0) colStart = byte;
+            else if (params == 1) colEnd = byte;
+            break;
+        case SSD1351_CMD_SETROW:
+            if (params == 0) rowStart = byte;
+            else if (params == 1) rowEnd = byte;
+            break;
+        case SSD1351_CMD_WRITERAM: // the address wraps inside the window
+            w = colEnd - colStart + 1;
+            h = rowEnd - rowStart + 1;
+            if (w > 0 && h > 0 && colEnd < SSD1351WIDTH && rowEnd < SSD1351HEIGHT) {
+                ram[rowStart + (cursor / 2 / w) % h][(colStart + cursor / 2 % w) * 2 + cursor % 2] = byte;
+            }
+            cursor++;
+            break;
+    }
+    params++;
+}
+
+// the polled path, DC on GPIOA3 pin 4 and the panel select (OC) on GPIOA1 pin 7
+void GPIOPinWrite(unsigned long ulPort, unsigned char ucPins, unsigned char ucVal) {
+    if (ulPort == GPIOA3_BASE && (ucPins & 0x10)) {
+        dcLevel = (ucVal & 0x10) ? DMA_DATA : DMA_COMMAND;
+    }
+    if (ulPort == GPIOA1_BASE && (ucPins & 0x80)) {
+        if (!(ucVal & 0x80) && !selected) {
+            panelStats.selects++;
+        }
+        selected = !(ucVal & 0x80);
+    }
+}
+
+void SPICSEnable(unsigned long ulBase) {
+    (void) ulBase;
+    csEnabled = true;
+}
+
+void SPICSDisable(unsigned long ulBase) {
+    (void) ulBase;
+    csEnabled = false;
+}
+
+void SPIDataPut(unsigned long ulBase, unsigned long ulData) {
+    (void) ulBase;
+    if (!selected || !csEnabled) {
+        panelStats.unselected++;
+        return;
+    }
+    clockByte(dcLevel, ulData);
+}
+
+void SPIDataGet(unsigned long ulBase, unsigned long *pulData) {
+    (void) ulBase;
+    *pulData = 0;
+}
+
+void InitSpiDma(void) {
+}
+
+void spiDmaQueue(unsigned char dc, const unsigned char *src, unsigned long count,
+                 DmaDoneCallback done, void *arg) {
+    unsigned long i;
+    if (count > 0) {
+        panelStats.descriptors++;
+    }
+    for (i = 0; i < count; i++) {
+        clockByte(dc, src[i]);
+    }
+    if (done) {
+        done(arg);
+    }
+}
+
+void spiDmaQueueRepeat(unsigned char dc, const unsigned char *pattern, unsigned long period,
+                       unsigned long count) {
+    unsigned long i;
+    if (count == 0 || period == 0 || period > DMA_MAX_TRANSFER) {
+        return;
+    }
+    panelStats.descriptors++;
+    for (i = 0; i < count; i++) {
+        clockByte(dc, pattern[i % period]);
+    }
+}
+
+void spiDmaQueueInline(unsigned char dc, const unsigned char *bytes, unsigned char count) {
+    if (count > 0 && count <= DMA_INLINE_SIZE) {
+        spiDmaQueue(dc, bytes, count, NULL, NULL);
+    }
+}
+
+void spiDmaQueueWindow(int x, int y, int w, int h) {
+    unsigned char cmd, range[2];
+
+    cmd = SSD1351_CMD_SETCOLUMN;
+    range[0] = x;
+    range[1] = x + w - 1;
+    spiDmaQueueInline(DMA_COMMAND, &cmd, 1);
+    spiDmaQueueInline(DMA_DATA, range, 2);
+
+    cmd = SSD1351_CMD_SETROW;
+    range[0] = y;
+    range[1] = y + h - 1;
+    spiDmaQueueInline(DMA_COMMAND, &cmd, 1);
+    spiDmaQueueInline(DMA_DATA, range, 2);
+
+    cmd = SSD1351_CMD_WRITERAM;
+    spiDmaQueueInline(DMA_COMMAND, &cmd, 1);
+}
+
+bool spiDmaBusy(void) {
+    return false;
+}
+
+int spiDmaFree(void) {
+    return DMA_QUEUE_SIZE;
+}
+
+void spiDmaWait(void) {
+}
+
+void SpiDmaIntHandler(void) {
+}
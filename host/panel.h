@@ -0,0 +1,28 @@
+/*
+ * panel.h
+ *
+ *  SSD1351 stand-in for the host tests of the display code. Adafruit_OLED.c
+ *  reaches it through the polled GPIO/GSPI calls and the spi_dma queue,
+ *  both defined in panel.c. It decodes the window commands into a copy of
+ *  the panel RAM and counts what went over the bus.
+ */
+
+#ifndef PANEL_H_
+#define PANEL_H_
+
+typedef struct PanelStats {
+    unsigned long selects;     // polled transfers, one per chip select
+    unsigned long descriptors; // queued DMA transfers
+    unsigned long bytes;       // everything clocked out, commands included
+    unsigned long commands;
+    unsigned long windows;     // WRITERAM commands
+    unsigned long unselected;  // bytes put while the panel was not selected
+} PanelStats;
+
+extern PanelStats panelStats;
+
+void panelReset(void); // clears the RAM, the counters and the bus state
+unsigned int panelPixel(int x, int y);
+unsigned long panelTransactions(void); // selects and DMA transfers
+
+#endif /* PANEL_H_ */
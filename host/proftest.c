@@ -0,0 +1,160 @@
+/*
+ * proftest.c
+ *
+ *  Runs the frame profiler on a simulated 24 bit SysTick and a captured
+ *  console. Checks the durations across counter wraps, the statistics and
+ *  the p99 bound in the dump, and the console keys. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "rom_map.h"
+#include "systick.h"
+#include "uart.h"
+#include "uart_if.h"
+#include "profiler.h"
+#include "rng.h"
+#include "check.h"
+
+#define CYCLES_PER_US 80
+#define SYSTICK_MASK  0x00FFFFFF
+
+static unsigned long long cycles; // since power up, SysTick counts down from it
+static bool enabled;
+static char console[4096];
+static int consoleLength;
+static long key = -1;             // next console key, -1 for none
+
+void SysTickPeriodSet(unsigned long ulPeriod) {
+    CHECK(ulPeriod == SYSTICK_MASK + 1, "SysTick period %lu", ulPeriod);
+}
+
+void SysTickEnable(void) {
+    enabled = true;
+}
+
+unsigned long SysTickValueGet(void) {
+    return SYSTICK_MASK - (unsigned long) (cycles & SYSTICK_MASK);
+}
+
+int UARTCharsAvail(unsigned long ulBase) {
+    (void) ulBase;
+    return key >= 0;
+}
+
+long UARTCharGetNonBlocking(unsigned long ulBase) {
+    long k = key;
+    (void) ulBase;
+    key = -1;
+    return k;
+}
+
+int Report(const char *format, ...) {
+    va_list args;
+    int n;
+    va_start(args, format);
+    n = vsnprintf(&console[consoleLength], sizeof(console) - consoleLength, format, args);
+    va_end(args);
+    if (n > 0 && consoleLength + n < (int) sizeof(console)) {
+        consoleLength += n;
+    }
+    return n;
+}
+
+static void sample(ProfPhase phase, unsigned long us) {
+    unsigned long start = profBegin();
+    cycles += (unsigned long long) us * CYCLES_PER_US + CYCLES_PER_US / 2; // the partial us is dropped
+    profEnd(phase, start);
+}
+
+// the numbers on a phase's dump line, false when it is not there
+static bool dumpLine(const char *name, unsigned long *count, unsigned long *min, unsigned long *avg,
+                     unsigned long *p99, unsigned long *max) {
+    char pattern[32];
+    const char *line;
+    sprintf(pattern, "\n\r%s ", name); // lines end in \n\r
+    console[consoleLength] = '\0';
+    line = strstr(console, pattern);
+    return line != NULL && sscanf(line + strlen(pattern), "%lu %lu %lu %lu %lu", count, min, avg, p99, max) == 5;
+}
+
+static void checkStats(void) {
+    unsigned long count, min, avg, p99, max;
+    int i;
+
+    InitProfiler();
+    CHECK(enabled, "SysTick not started");
+    cycles = SYSTICK_MASK - 1000; // the first samples straddle a wrap
+    for (i = 0; i < 990; i++) {
+        sample(PROF_LOGIC, 100);
+    }
+    for (i = 0; i < 10; i++) {
+        sample(PROF_LOGIC, 3000);
+    }
+    sample(PROF_FLUSH, 0);
+    sample(PROF_FLUSH, 200000); // close to the ~209 ms the counter covers
+
+    consoleLength = 0;
+    profDump();
+    CHECK(dumpLine("logic", &count, &min, &avg, &p99, &max), "no logic line in\n%s", console);
+    // 100 us falls in the 96-111 bucket, 99% of the samples are in it
+    CHECK(count == 1000 && min == 100 && avg == 129 && p99 == 111 && max == 3000,
+          "logic %lu %lu %lu %lu %lu", count, min, avg, p99, max);
+    CHECK(dumpLine("flush", &count, &min, &avg, &p99, &max) && count == 2 && min == 0 && max == 200000,
+          "flush %lu %lu %lu", count, min, max);
+    CHECK(!dumpLine("frame", &count, &min, &avg, &p99, &max), "a phase without samples was dumped");
+}
+
+// the p99 bound holds and is within a quarter octave of the real one
+static void checkPercentile(void) {
+    static unsigned long values[5000];
+    unsigned long count, min, avg, p99, max, real, v;
+    int i, j, n = 5000;
+    Rng rng;
+
+    rngSeed(&rng, 2020);
+    profReset();
+    for (i = 0; i < n; i++) {
+        v = rngRange(&rng, 4) == 0 ? rngRange(&rng, 50000) : rngRange(&rng, 2000);
+        sample(PROF_RENDER, v);
+        // keep them sorted for the real percentile
+        for (j = i; j > 0 && values[j - 1] > v; j--) {
+            values[j] = values[j - 1];
+        }
+        values[j] = v;
+    }
+    real = values[n - n / 100 - 1];
+    consoleLength = 0;
+    profDump();
+    CHECK(dumpLine("render", &count, &min, &avg, &p99, &max), "no render line");
+    CHECK(p99 >= real && p99 <= real + real / 4 + 1, "p99 bound %lu for a real %lu", p99, real);
+    CHECK(min == values[0] && max == values[n - 1], "min %lu max %lu", min, max);
+}
+
+static void checkKeys(void) {
+    unsigned long count, min, avg, p99, max;
+
+    key = -1;
+    CHECK(profPoll() == -1, "a key without input");
+    key = 'x';
+    CHECK(profPoll() == 'x', "other keys are not handed back");
+    consoleLength = 0;
+    key = 'p';
+    CHECK(profPoll() == -1 && dumpLine("render", &count, &min, &avg, &p99, &max), "'p' did not dump");
+    consoleLength = 0;
+    key = 'r';
+    CHECK(profPoll() == -1 && strstr(console, "reset") != NULL, "'r' did not reset");
+    consoleLength = 0;
+    profDump();
+    CHECK(!dumpLine("render", &count, &min, &avg, &p99, &max), "samples left after a reset");
+}
+
+int main(void) {
+    checkStats();
+    checkPercentile();
+    checkKeys();
+    return checkResult("proftest");
+}
@@ -0,0 +1,116 @@
+/*
+ * requesttest.c
+ *
+ *  Checks the shadow update serializer: the header block, the fields, the
+ *  patched Content-Length and what happens when the buffer runs out.
+ *  Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "request.h"
+#include "check.h"
+
+// a finished POST has to frame itself: the header block, then exactly
+// Content-Length bytes of body
+static void checkFraming(const char *request, int length, const char *expectBody) {
+    const char *field, *body;
+    int contentLength;
+
+    CHECK(length <= REQUEST_SIZE, "request is %d bytes", length);
+    CHECK(strncmp(request, POSTHEADER HOSTHEADER CHEADER CTHEADER CLHEADER1,
+                  sizeof(POSTHEADER HOSTHEADER CHEADER CTHEADER CLHEADER1) - 1) == 0, "headers differ");
+    field = strstr(request, CLHEADER1);
+    body = strstr(request, CLHEADER2);
+    if (field == NULL || body == NULL || body - request + 4 > length) {
+        CHECK(false, "no header block end");
+        return;
+    }
+    body += strlen(CLHEADER2);
+    contentLength = atoi(field + strlen(CLHEADER1));
+    CHECK(contentLength == length - (body - request), "Content-Length %d, the body is %d bytes",
+          contentLength, (int) (length - (body - request)));
+    if (expectBody != NULL) {
+        CHECK((int) strlen(expectBody) == length - (body - request) &&
+              memcmp(body, expectBody, strlen(expectBody)) == 0, "body is %.*s",
+              (int) (length - (body - request)), body);
+    }
+}
+
+static void checkFields(void) {
+    const char *out;
+    int length;
+
+    CHECK(!requestStarted(), "a request is open before any field");
+
+    // nothing built still gives a well formed empty update
+    length = finishRequest(&out);
+    checkFraming(out, length, DATA_PREF DATA_SUFF);
+
+    CHECK(buildRequest("pac_loc", "15,25"), "first field dropped");
+    CHECK(requestStarted(), "no request open after a field");
+    CHECK(buildRequest("bad1_queue", "ready"), "second field dropped");
+    length = finishRequest(&out);
+    checkFraming(out, length, DATA_PREF "\"pac_loc\": \"15,25\",\r\n\"bad1_queue\": \"ready\"" DATA_SUFF);
+    CHECK(!requestStarted(), "the request stays open after it was finished");
+
+    // the next one starts over, the comma belongs to the old request
+    buildRequest("pac_loc", "1,1");
+    length = finishRequest(&out);
+    checkFraming(out, length, DATA_PREF "\"pac_loc\": \"1,1\"" DATA_SUFF);
+
+    // MQTT takes the body alone
+    buildRequest("bad2_loc", "3,4");
+    length = finishBody(&out);
+    CHECK(length == (int) strlen(DATA_PREF "\"bad2_loc\": \"3,4\"" DATA_SUFF) &&
+          memcmp(out, DATA_PREF "\"bad2_loc\": \"3,4\"" DATA_SUFF, length) == 0, "MQTT body is %.*s", length, out);
+}
+
+// every body length the buffer allows gets its digits patched right
+static void checkLengths(void) {
+    char text[REQUEST_SIZE];
+    const char *out;
+    int n, length, built = 0;
+
+    for (n = 0; n < REQUEST_SIZE; n++) {
+        memset(text, 'x', n);
+        text[n] = '\0';
+        if (buildRequest("k", text)) {
+            built++;
+        }
+        length = finishRequest(&out);
+        checkFraming(out, length, NULL);
+    }
+    // "k": "" takes 7 bytes, every text length up to the rest of the buffer fits
+    CHECK(built == REQUEST_SIZE - (int) (sizeof(POST_HEAD DATA_PREF DATA_SUFF) - 1) - 7 + 1,
+          "%d single fields fit", built);
+}
+
+// fields past the end are dropped whole and the rest still frames
+static void checkOverflow(void) {
+    char key[16];
+    const char *out;
+    int i, length, kept = 0;
+
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "bad%d_loc", i);
+        if (buildRequest(key, "31,31")) {
+            CHECK(kept == i, "field %d fit after one was dropped", i);
+            kept++;
+        }
+    }
+    CHECK(kept > 0 && kept < 100, "%d of 100 fields kept", kept);
+    length = finishRequest(&out);
+    checkFraming(out, length, NULL);
+    CHECK(length > REQUEST_SIZE - 32, "only %d of %d bytes used", length, REQUEST_SIZE);
+}
+
+int main(void) {
+    checkFields();
+    checkLengths();
+    checkOverflow();
+    return checkResult("requesttest");
+}
@@ -0,0 +1,129 @@
+/*
+ * rngtest.c
+ *
+ *  Pins the generator to known sequences, so the board, a 64 bit host and
+ *  a replay all agree, and checks that draws and streams look uniform.
+ *  Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+
+#include "rng.h"
+#include "check.h"
+
+#define DRAWS 400000L
+#define SEEDS 10000
+
+// chi square limits at p = 0.001, the draws are seeded so the result never changes
+#define CHI2_DF3  16.27
+#define CHI2_DF15 37.70
+
+// first outputs of xorshift32 13/17/5, worked out independently of rng.c
+static const struct {
+    unsigned long seed;
+    unsigned long out[4];
+} vectors[] = {
+    { 1,          { 0x00042021, 0x04080601, 0x9DCCA8C5, 0x1255994F } },
+    { 0x12345678, { 0x87985AA5, 0x155B24A3, 0x4820F4C4, 0x81B3AC98 } },
+};
+
+// stream seeds and first outputs for the level seed 2020
+static const unsigned long streams[4][2] = {
+    { 0x8F8C1E5D, 0x84B0B7BE },
+    { 0x5888FAA7, 0xBC5B1069 },
+    { 0x2EEF73FE, 0xD28AA576 },
+    { 0x507BA38A, 0xA554C06F },
+};
+
+static void checkSequences(void) {
+    Rng a, b;
+    unsigned int i, j;
+    unsigned long x;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        rngSeed(&a, vectors[i].seed);
+        for (j = 0; j < 4; j++) {
+            x = rngNext(&a);
+            CHECK(x == vectors[i].out[j], "seed %lx draw %u is %lx, expected %lx",
+                  vectors[i].seed, j, x, vectors[i].out[j]);
+        }
+    }
+    for (i = 0; i < 4; i++) {
+        rngSeedStream(&a, 2020, i);
+        CHECK(a.state == streams[i][0], "stream %u seeds %lx, expected %lx", i, a.state, streams[i][0]);
+        x = rngNext(&a);
+        CHECK(x == streams[i][1], "stream %u draws %lx, expected %lx", i, x, streams[i][1]);
+    }
+
+    // a zero seed must not stick
+    rngSeed(&a, 0);
+    CHECK(rngNext(&a) != 0, "seed 0 is stuck");
+
+    // the same seed replays the same draws
+    rngSeedStream(&a, 77, 2);
+    rngSeedStream(&b, 77, 2);
+    for (i = 0; i < 1000; i++) {
+        if (rngRange(&a, 4) != rngRange(&b, 4)) {
+            break;
+        }
+    }
+    CHECK(i == 1000, "two generators with one seed split at draw %u", i);
+}
+
+static double chiSquare(const long *counts, int bins, long total) {
+    double expect = (double) total / bins, sum = 0;
+    int i;
+    for (i = 0; i < bins; i++) {
+        sum += (counts[i] - expect) * (counts[i] - expect) / expect;
+    }
+    return sum;
+}
+
+static void checkDistribution(void) {
+    Rng rng;
+    long dirs[4] = { 0 }, nibbles[16] = { 0 }, bits[32] = { 0 }, agree = 0;
+    double chi;
+    unsigned long x;
+    long i;
+    int b;
+
+    // baddies pick directions with rngRange(4)
+    rngSeed(&rng, 2020);
+    for (i = 0; i < DRAWS; i++) {
+        dirs[rngRange(&rng, 4)]++;
+    }
+    chi = chiSquare(dirs, 4, DRAWS);
+    CHECK(chi < CHI2_DF3, "directions chi square %.2f", chi);
+
+    rngSeed(&rng, 2020);
+    for (i = 0; i < DRAWS; i++) {
+        x = rngNext(&rng);
+        nibbles[x >> 28]++;
+        for (b = 0; b < 32; b++) {
+            bits[b] += (x >> b) & 1;
+        }
+    }
+    chi = chiSquare(nibbles, 16, DRAWS);
+    CHECK(chi < CHI2_DF15, "top nibble chi square %.2f", chi);
+    for (b = 0; b < 32; b++) {
+        // 5 sigma around half
+        CHECK(bits[b] > DRAWS / 2 - 1600 && bits[b] < DRAWS / 2 + 1600, "bit %d set %ld times", b, bits[b]);
+    }
+
+    // baddies deciding on the same tick must not copy each other: the first
+    // direction of two streams should match a quarter of the time
+    for (i = 0; i < SEEDS; i++) {
+        Rng first, second;
+        rngSeedStream(&first, i, 0);
+        rngSeedStream(&second, i, 1);
+        agree += rngRange(&first, 4) == rngRange(&second, 4);
+    }
+    CHECK(agree > SEEDS / 4 - 220 && agree < SEEDS / 4 + 220, "streams 0 and 1 agree on %ld of %d seeds",
+          agree, SEEDS);
+}
+
+int main(void) {
+    checkSequences();
+    checkDistribution();
+    return checkResult("rngtest");
+}
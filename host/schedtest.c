@@ -0,0 +1,126 @@
+/*
+ * schedtest.c
+ *
+ *  Runs the frame scheduler against a simulated slow clock and delay loop.
+ *  Checks that frames start on their deadlines without oversleeping, that
+ *  30 frames take exactly one second with no drift over an hour, and how
+ *  late frames are caught up, dropped and resynced. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "prcm.h"
+#include "utils.h"
+#include "scheduler.h"
+#include "rng.h"
+#include "check.h"
+
+#define CPU_HZ         80000000.0
+#define CYCLES_PER_LOOP 3
+#define POLL_COST      0.002 // ticks one counter read takes
+#define HOUR_FRAMES    (3600L * SCHED_FPS)
+
+static double clockTicks;            // simulated slow clock, in ticks
+static unsigned long long startTick; // clock when the scheduler was set up
+static bool overslept;
+
+unsigned long long PRCMSlowClkCtrGet(void) {
+    clockTicks += POLL_COST;
+    return (unsigned long long) clockTicks;
+}
+
+// the real loop runs a little slower than LOOPS_PER_TICK assumes
+void UtilsDelay(unsigned long ulCount) {
+    clockTicks += ulCount * CYCLES_PER_LOOP / CPU_HZ * SCHED_CLOCK_HZ;
+}
+
+// slow clock tick frame k is due at, the exact rational schedule
+static unsigned long long due(long k) {
+    return startTick + (unsigned long long) k * SCHED_CLOCK_HZ / SCHED_FPS;
+}
+
+// deadlines passed by now since init, what steps and drops have to add up to
+static long periodsUntil(unsigned long long now) {
+    long k = 0;
+    while (due(k) <= now) {
+        k++;
+    }
+    return k;
+}
+
+static void init(double at) {
+    clockTicks = at;
+    InitScheduler();
+    startTick = (unsigned long long) at;
+}
+
+// one frame: wait, then count the logic steps it runs
+static int frame(void) {
+    int steps = 0;
+    schedBeginFrame();
+    while (schedStep()) {
+        steps++;
+    }
+    return steps;
+}
+
+static void checkOnTime(void) {
+    Rng rng;
+    long k, steps = 0;
+    unsigned long long start;
+
+    rngSeed(&rng, 2020);
+    init(1000.5);
+    for (k = 0; k < HOUR_FRAMES; k++) {
+        steps += frame();
+        start = (unsigned long long) clockTicks;
+        if (start != due(k) && !overslept) { // the poll may run into the next tick, never further
+            CHECK(start == due(k), "frame %ld started at %llu, due at %llu", k, start, due(k));
+            overslept = true;
+        }
+        clockTicks += rngRange(&rng, SCHED_CLOCK_HZ / SCHED_FPS - 2); // logic and render
+    }
+    CHECK(steps == HOUR_FRAMES && schedDropped() == 0, "%ld steps, %lu dropped in an hour", steps, schedDropped());
+    CHECK(due(SCHED_FPS) - due(0) == SCHED_CLOCK_HZ, "30 frames are not one second");
+    CHECK(due(HOUR_FRAMES) - due(0) == 3600ULL * SCHED_CLOCK_HZ, "an hour drifts");
+}
+
+static void checkLate(void) {
+    long steps;
+    int n;
+
+    init(0);
+    steps = frame();
+    clockTicks += 2.5 * SCHED_CLOCK_HZ / SCHED_FPS; // one slow frame
+    n = frame();
+    steps += n;
+    CHECK(n == 2, "a frame 2.5 periods long is caught up in %d steps", n);
+    CHECK(steps + (long) schedDropped() == periodsUntil((unsigned long long) clockTicks),
+          "%ld steps after a slow frame", steps);
+    n = frame(); // and then it is back on schedule
+    CHECK(n == 1 && (unsigned long long) clockTicks == due(3), "no step on the next deadline");
+
+    // too far behind, the rest of the lag is given up on
+    clockTicks += 10.0 * SCHED_CLOCK_HZ / SCHED_FPS;
+    n = frame();
+    CHECK(n == SCHED_MAX_STEPS, "%d steps after a stall", n);
+    CHECK(4 + SCHED_MAX_STEPS + (long) schedDropped() == periodsUntil((unsigned long long) clockTicks),
+          "%lu dropped after a stall", schedDropped());
+
+    // a resync starts the schedule over from now
+    clockTicks += 100.0 * SCHED_CLOCK_HZ / SCHED_FPS;
+    schedResync();
+    CHECK(!schedStep(), "steps left over after a resync");
+    n = frame();
+    startTick = (unsigned long long) clockTicks;
+    CHECK(n == 1, "%d steps right after a resync", n);
+    n = frame();
+    CHECK(n == 1 && (unsigned long long) clockTicks == due(1), "resynced schedule is off");
+}
+
+int main(void) {
+    checkOnTime();
+    checkLate();
+    return checkResult("schedtest");
+}
@@ -0,0 +1,122 @@
+/*
+ * scoretest.c
+ *
+ *  Runs the score readout on the panel stand-in. Every change has to
+ *  repaint exactly the digit cells that differ, one window each, plus one
+ *  clear when the number gets shorter, and leave the readout showing the
+ *  score. Prints the cost of counting up against clearing and redrawing
+ *  the whole number each time. Exits 1 on a mismatch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "glcdfont.h"
+#include "score.h"
+#include "panel.h"
+#include "rng.h"
+#include "check.h"
+
+#define COUNT_TO 2000
+
+static char shown[SCORE_DIGITS + 1] = "";
+
+// the readout region shows digits and background behind them
+static bool showing(const char *digits) {
+    int x, y, cell;
+    unsigned int want;
+    for (y = SCORE_Y; y < SCORE_Y + 8; y++) {
+        for (x = SCORE_X; x < SCORE_X + SCORE_DIGITS * 6; x++) {
+            cell = (x - SCORE_X) / 6;
+            want = SCORE_BG_COLOR;
+            if (cell < (int) strlen(digits) && (x - SCORE_X) % 6 < 5 &&
+                (font[digits[cell] * 5 + (x - SCORE_X) % 6] >> (y - SCORE_Y) & 1)) {
+                want = SCORE_COLOR;
+            }
+            if (panelPixel(x, y) != want) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// draws the score and checks the windows it took
+static void step(int score) {
+    char digits[SCORE_DIGITS + 1];
+    unsigned long windows = panelStats.windows;
+    int i, changed = 0;
+
+    sprintf(digits, "%d", score);
+    for (i = 0; digits[i] != '\0'; i++) {
+        changed += digits[i] != shown[i] || i >= (int) strlen(shown);
+    }
+    changed += strlen(shown) > strlen(digits); // the cells left over are cleared at once
+
+    drawScore(score);
+    CHECK(panelStats.windows - windows == (unsigned long) changed, "%s after %s took %lu windows, %d cells changed",
+          digits, shown, panelStats.windows - windows, changed);
+    CHECK(showing(digits), "readout does not show %s after %s", digits, shown);
+    strcpy(shown, digits);
+}
+
+int main(void) {
+    unsigned long bytes, transactions, oldBytes, oldTransactions;
+    char digits[SCORE_DIGITS + 1];
+    int score, i;
+    Rng rng;
+
+    panelReset();
+    forgetScore();
+    step(0);
+
+    // a pellet at a time, most steps repaint the last digit only
+    transactions = panelTransactions();
+    bytes = panelStats.bytes;
+    for (score = 1; score <= COUNT_TO; score++) {
+        step(score);
+    }
+    transactions = panelTransactions() - transactions;
+    bytes = panelStats.bytes - bytes;
+    CHECK(transactions <= (COUNT_TO + COUNT_TO / 10 + COUNT_TO / 100 + COUNT_TO / 1000 + 1) * 6,
+          "counting to %d took %lu transactions", COUNT_TO, transactions);
+
+    // a new game and random jumps, shorter numbers clear what is left over
+    step(0);
+    step(-5);
+    rngSeed(&rng, 10);
+    for (i = 0; i < 500; i++) {
+        step((int) rngRange(&rng, rngRange(&rng, 4) == 0 ? 1000000 : 200) - 20);
+    }
+    step(-2147483647 - 1);
+    step(7);
+
+    // the screen was redrawn behind the readout's back
+    panelReset();
+    forgetScore();
+    shown[0] = '\0';
+    step(1234);
+
+    // what counting up cost with a clear and a whole redraw every time
+    panelReset();
+    oldTransactions = panelTransactions();
+    oldBytes = panelStats.bytes;
+    setTextSize(1);
+    setTextColor(SCORE_COLOR, SCORE_BG_COLOR);
+    for (score = 1; score <= COUNT_TO; score++) {
+        fillRect(SCORE_X, SCORE_Y, 17, 8, SCORE_BG_COLOR);
+        setCursor(SCORE_X, SCORE_Y);
+        sprintf(digits, "%d", score);
+        Outstr(digits);
+    }
+    oldTransactions = panelTransactions() - oldTransactions;
+    oldBytes = panelStats.bytes - oldBytes;
+
+    CHECK(panelStats.unselected == 0, "bytes went out unselected");
+    printf("score 1 to %d: %lu transactions and %lu bytes, %lu and %lu redrawing it whole\n", COUNT_TO,
+           transactions, bytes, oldTransactions, oldBytes);
+    return checkResult("scoretest");
+}
@@ -0,0 +1,184 @@
+/*
+ * shadowtest.c
+ *
+ *  Checks the shadow key hash against every known key and a sweep of near
+ *  misses, and the values it stores. The benchmark parses recorded shadow
+ *  responses through the hash and through the strcmp scan it replaced.
+ *
+ *    shadowtest       key and value checks, exits 1 on a mismatch
+ *    shadowtest -b    also runs the benchmark
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "json.h"
+#include "shadow.h"
+#include "check.h"
+
+#define BENCH_PARSES 200000L
+
+static const char *keys[SHADOW_FIELDS] = {
+    "pac_loc", "b1_loc", "b2_loc", "b3_loc", "b4_loc", "b1_q", "b2_q", "b3_q", "b4_q"
+};
+
+// GET responses as the board received them
+static const char *responses[] = {
+    "{\"state\":{\"desired\":{\"pac_loc\":\"15 25\"},\"reported\":{\"pac_loc\":\"60 100\",\"b1_loc\":\"56 52\","
+    "\"b2_loc\":\"60 52\",\"b3_loc\":\"64 52\",\"b4_loc\":\"68 52\",\"b1_q\":\"ready\",\"b2_q\":\"ready\","
+    "\"b3_q\":\"ready\",\"b4_q\":\"ready\"}},\"metadata\":{\"desired\":{\"pac_loc\":{\"timestamp\":1584140000}},"
+    "\"reported\":{\"pac_loc\":{\"timestamp\":1584140012},\"b1_loc\":{\"timestamp\":1584140012}}},"
+    "\"version\":4182,\"timestamp\":1584140013}",
+    "{\"state\":{\"reported\":{\"pac_loc\":\"44 12\",\"b1_loc\":\"8 4\",\"b2_loc\":\"120 4\",\"b3_loc\":\"8 120\","
+    "\"b4_loc\":\"120 120\",\"b1_q\":\"0312\",\"b2_q\":\"ready\",\"b3_q\":\"33\",\"b4_q\":\"1\","
+    "\"welcome\":\"aws-iot\"}},\"version\":4183,\"timestamp\":1584140020}",
+};
+
+static void feed(const char *doc, ShadowState *state) {
+    JsonParser parser;
+    shadowClear(state);
+    jsonInit(&parser, "reported", shadowStore, state);
+    jsonFeed(&parser, doc, strlen(doc));
+}
+
+static void store(const char *key, const char *value, ShadowState *state) {
+    shadowClear(state);
+    shadowStore(key, strlen(key), value, strlen(value), state);
+}
+
+static bool known(const char *key) {
+    int field;
+    for (field = 0; field < SHADOW_FIELDS; field++) {
+        if (strcmp(keys[field], key) == 0) return true;
+    }
+    return false;
+}
+
+static void checkKeys(void) {
+    ShadowState state;
+    char key[12];
+    int field, length, i, c;
+
+    // every key lands in its own field
+    for (field = 0; field < SHADOW_FIELDS; field++) {
+        store(keys[field], field >= SHADOW_B1_Q ? "0" : "1 2", &state);
+        CHECK(state.present == 1 << field, "%s sets fields %x", keys[field], state.present);
+    }
+
+    // a key one character off anywhere is nothing, unless it is another key
+    for (field = 0; field < SHADOW_FIELDS; field++) {
+        length = strlen(keys[field]);
+        for (i = 0; i < length; i++) {
+            for (c = 1; c < 128; c++) {
+                strcpy(key, keys[field]);
+                if (key[i] == c) {
+                    continue;
+                }
+                key[i] = c;
+                if (known(key)) {
+                    continue;
+                }
+                store(key, "1 2", &state);
+                CHECK(state.present == 0, "%s is taken for a key", key);
+            }
+        }
+        // and so is a prefix or a longer key
+        memcpy(key, keys[field], length - 1);
+        key[length - 1] = '\0';
+        store(key, "1 2", &state);
+        CHECK(state.present == 0, "%s is taken for a key", key);
+        sprintf(key, "%sx", keys[field]);
+        store(key, "1 2", &state);
+        CHECK(state.present == 0, "%s is taken for a key", key);
+    }
+}
+
+static void checkValues(void) {
+    ShadowState state;
+
+    store("pac_loc", "-3 127", &state);
+    CHECK(state.present == 1 << SHADOW_PAC_LOC && state.pacLoc.x == -3 && state.pacLoc.y == 127,
+          "pac_loc read as %d %d", state.pacLoc.x, state.pacLoc.y);
+    store("b3_loc", "12", &state);
+    CHECK(state.present == 0, "a location without y was taken");
+    store("b3_loc", "x 1", &state);
+    CHECK(state.present == 0, "a location without x was taken");
+
+    store("b2_q", "ready", &state);
+    CHECK(state.present == 1 << SHADOW_B2_Q && state.badQueue[1][0] == '\0', "ready queued %s", state.badQueue[1]);
+    store("b2_q", "0123", &state);
+    CHECK(state.present == 1 << SHADOW_B2_Q && strcmp(state.badQueue[1], "0123") == 0, "queue is %s",
+          state.badQueue[1]);
+    store("b2_q", "0124", &state);
+    CHECK(state.present == 0, "direction 4 was queued");
+    store("b2_q", "01230123", &state);
+    CHECK(state.present == 0, "a queue longer than a dirQueue was taken");
+    store("b2_q", "0123012", &state);
+    CHECK(state.present == 1 << SHADOW_B2_Q, "the longest queue was dropped");
+
+    // whole responses, only the reported members count
+    feed(responses[1], &state);
+    CHECK(state.present == (1 << SHADOW_FIELDS) - 1, "response fields %x", state.present);
+    CHECK(state.pacLoc.x == 44 && state.pacLoc.y == 12 && state.badLoc[3].x == 120 && state.badLoc[3].y == 120,
+          "response locations differ");
+    CHECK(strcmp(state.badQueue[0], "0312") == 0 && state.badQueue[1][0] == '\0' &&
+          strcmp(state.badQueue[2], "33") == 0 && strcmp(state.badQueue[3], "1") == 0, "response queues differ");
+}
+
+// the lookup before the hash: compare against every known key in turn
+static void scanStore(const char *key, int keyLength, const char *value, int valueLength, void *arg) {
+    int *found = arg, field;
+    (void) value;
+    (void) valueLength;
+    for (field = 0; field < SHADOW_FIELDS; field++) {
+        if ((int) strlen(keys[field]) == keyLength && strncmp(keys[field], key, keyLength) == 0) {
+            *found |= 1 << field;
+            return;
+        }
+    }
+}
+
+static void bench(void) {
+    static ShadowState state;
+    volatile int sink = 0;
+    JsonParser parser;
+    clock_t start;
+    double hashTime, scanTime;
+    int found;
+    long i;
+    const char *doc;
+
+    start = clock();
+    for (i = 0; i < BENCH_PARSES; i++) {
+        doc = responses[i & 1];
+        shadowClear(&state);
+        jsonInit(&parser, "reported", shadowStore, &state);
+        jsonFeed(&parser, doc, strlen(doc));
+        sink += state.present;
+    }
+    hashTime = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (i = 0; i < BENCH_PARSES; i++) {
+        doc = responses[i & 1];
+        found = 0;
+        jsonInit(&parser, "reported", scanStore, &found);
+        jsonFeed(&parser, doc, strlen(doc));
+        sink += found;
+    }
+    scanTime = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%ld responses: hash and store %.0f ns, strcmp scan without storing %.0f ns per response (%d)\n",
+           BENCH_PARSES, hashTime * 1e9 / BENCH_PARSES, scanTime * 1e9 / BENCH_PARSES, sink);
+}
+
+int main(int argc, char **argv) {
+    checkKeys();
+    checkValues();
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        bench();
+    }
+    return checkResult("shadowtest");
+}
@@ -0,0 +1,437 @@
+/*
+ * shapetest.c
+ *
+ *  Checks the span rasterizer against the shape code it replaced, on the
+ *  panel stand-in. The old circles, round rects, triangles and lines are
+ *  kept here, drawn either pixel exact into a reference or through the
+ *  driver the way they used to be. Every shape has to leave the reference
+ *  pixels, and the test.c routines have to take fewer bus transactions.
+ *
+ *    shapetest      checks, exits 1 on a mismatch, and prints the
+ *                   transactions per shape of the test.c routines
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "test.h"
+#include "panel.h"
+#include "rng.h"
+#include "check.h"
+
+#define RANDOM_SHAPES 3000
+
+// how the old shapes put pixels down
+typedef struct Ops {
+    void (*pixel)(int x, int y, unsigned int color);
+    void (*vline)(int x, int y, int h, unsigned int color);
+    void (*hline)(int x, int y, int w, unsigned int color);
+    void (*rect)(int x, int y, int w, int h, unsigned int color);
+} Ops;
+
+static unsigned int ref[HEIGHT][WIDTH];
+
+static void refPixel(int x, int y, unsigned int color) {
+    if (x >= 0 && y >= 0 && x < WIDTH && y < HEIGHT) {
+        ref[y][x] = color;
+    }
+}
+
+static void refRect(int x, int y, int w, int h, unsigned int color) {
+    int i, j;
+    for (j = y; j < y + h; j++) {
+        for (i = x; i < x + w; i++) {
+            refPixel(i, j, color);
+        }
+    }
+}
+
+static void refVLine(int x, int y, int h, unsigned int color) {
+    refRect(x, y, 1, h, color);
+}
+
+static void refHLine(int x, int y, int w, unsigned int color) {
+    refRect(x, y, w, 1, color);
+}
+
+static void driverRect(int x, int y, int w, int h, unsigned int color) {
+    fillRect(x, y, w, h, color);
+}
+
+static const Ops exact = { refPixel, refVLine, refHLine, refRect };
+static const Ops driver = { drawPixel, drawFastVLine, drawFastHLine, driverRect };
+
+static void oldDrawCircle(const Ops *ops, int x0, int y0, int r, unsigned int color) {
+    int f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+
+    ops->pixel(x0, y0 + r, color);
+    ops->pixel(x0, y0 - r, color);
+    ops->pixel(x0 + r, y0, color);
+    ops->pixel(x0 - r, y0, color);
+    while (x < y) {
+        if (f >= 0) {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        ops->pixel(x0 + x, y0 + y, color);
+        ops->pixel(x0 - x, y0 + y, color);
+        ops->pixel(x0 + x, y0 - y, color);
+        ops->pixel(x0 - x, y0 - y, color);
+        ops->pixel(x0 + y, y0 + x, color);
+        ops->pixel(x0 - y, y0 + x, color);
+        ops->pixel(x0 + y, y0 - x, color);
+        ops->pixel(x0 - y, y0 - x, color);
+    }
+}
+
+static void oldDrawCircleHelper(const Ops *ops, int x0, int y0, int r, unsigned char corners, unsigned int color) {
+    int f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+
+    while (x < y) {
+        if (f >= 0) {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (corners & 0x4) {
+            ops->pixel(x0 + x, y0 + y, color);
+            ops->pixel(x0 + y, y0 + x, color);
+        }
+        if (corners & 0x2) {
+            ops->pixel(x0 + x, y0 - y, color);
+            ops->pixel(x0 + y, y0 - x, color);
+        }
+        if (corners & 0x8) {
+            ops->pixel(x0 - y, y0 + x, color);
+            ops->pixel(x0 - x, y0 + y, color);
+        }
+        if (corners & 0x1) {
+            ops->pixel(x0 - y, y0 - x, color);
+            ops->pixel(x0 - x, y0 - y, color);
+        }
+    }
+}
+
+static void oldFillCircleHelper(const Ops *ops, int x0, int y0, int r, unsigned char corners, int delta,
+                                unsigned int color) {
+    int f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+
+    while (x < y) {
+        if (f >= 0) {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (corners & 0x1) {
+            ops->vline(x0 + x, y0 - y, 2 * y + 1 + delta, color);
+            ops->vline(x0 + y, y0 - x, 2 * x + 1 + delta, color);
+        }
+        if (corners & 0x2) {
+            ops->vline(x0 - x, y0 - y, 2 * y + 1 + delta, color);
+            ops->vline(x0 - y, y0 - x, 2 * x + 1 + delta, color);
+        }
+    }
+}
+
+static void oldFillCircle(const Ops *ops, int x0, int y0, int r, unsigned int color) {
+    ops->vline(x0, y0 - r, 2 * r + 1, color);
+    oldFillCircleHelper(ops, x0, y0, r, 3, 0, color);
+}
+
+static void oldDrawLine(const Ops *ops, int x0, int y0, int x1, int y1, unsigned int color) {
+    int steep = abs(y1 - y0) > abs(x1 - x0), dx, dy, err, ystep;
+
+    if (steep) {
+        swap(x0, y0);
+        swap(x1, y1);
+    }
+    if (x0 > x1) {
+        swap(x0, x1);
+        swap(y0, y1);
+    }
+    dx = x1 - x0;
+    dy = abs(y1 - y0);
+    err = dx / 2;
+    ystep = y0 < y1 ? 1 : -1;
+    for (; x0 <= x1; x0++) {
+        if (steep) {
+            ops->pixel(y0, x0, color);
+        } else {
+            ops->pixel(x0, y0, color);
+        }
+        err -= dy;
+        if (err < 0) {
+            y0 += ystep;
+            err += dx;
+        }
+    }
+}
+
+static void oldDrawRoundRect(const Ops *ops, int x, int y, int w, int h, int r, unsigned int color) {
+    ops->hline(x + r, y, w - 2 * r, color);
+    ops->hline(x + r, y + h - 1, w - 2 * r, color);
+    ops->vline(x, y + r, h - 2 * r, color);
+    ops->vline(x + w - 1, y + r, h - 2 * r, color);
+    oldDrawCircleHelper(ops, x + r, y + r, r, 1, color);
+    oldDrawCircleHelper(ops, x + w - r - 1, y + r, r, 2, color);
+    oldDrawCircleHelper(ops, x + w - r - 1, y + h - r - 1, r, 4, color);
+    oldDrawCircleHelper(ops, x + r, y + h - r - 1, r, 8, color);
+}
+
+static void oldFillRoundRect(const Ops *ops, int x, int y, int w, int h, int r, unsigned int color) {
+    ops->rect(x + r, y, w - 2 * r, h, color);
+    oldFillCircleHelper(ops, x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
+    oldFillCircleHelper(ops, x + r, y + r, r, 2, h - 2 * r - 1, color);
+}
+
+static void oldDrawTriangle(const Ops *ops, int x0, int y0, int x1, int y1, int x2, int y2, unsigned int color) {
+    oldDrawLine(ops, x0, y0, x1, y1, color);
+    oldDrawLine(ops, x1, y1, x2, y2, color);
+    oldDrawLine(ops, x2, y2, x0, y0, color);
+}
+
+static void oldFillTriangle(const Ops *ops, int x0, int y0, int x1, int y1, int x2, int y2, unsigned int color) {
+    int a, b, y, last, dx01, dy01, dx02, dy02, dx12, dy12, sa = 0, sb = 0;
+
+    if (y0 > y1) {
+        swap(y0, y1);
+        swap(x0, x1);
+    }
+    if (y1 > y2) {
+        swap(y2, y1);
+        swap(x2, x1);
+    }
+    if (y0 > y1) {
+        swap(y0, y1);
+        swap(x0, x1);
+    }
+    if (y0 == y2) {
+        a = b = x0;
+        if (x1 < a) a = x1;
+        else if (x1 > b) b = x1;
+        if (x2 < a) a = x2;
+        else if (x2 > b) b = x2;
+        ops->hline(a, y0, b - a + 1, color);
+        return;
+    }
+    dx01 = x1 - x0;
+    dy01 = y1 - y0;
+    dx02 = x2 - x0;
+    dy02 = y2 - y0;
+    dx12 = x2 - x1;
+    dy12 = y2 - y1;
+    last = y1 == y2 ? y1 : y1 - 1;
+    for (y = y0; y <= last; y++) {
+        a = x0 + sa / dy01;
+        b = x0 + sb / dy02;
+        sa += dx01;
+        sb += dx02;
+        if (a > b) swap(a, b);
+        ops->hline(a, y, b - a + 1, color);
+    }
+    sa = dx12 * (y - y1);
+    sb = dx02 * (y - y0);
+    for (; y <= y2; y++) {
+        a = x1 + sa / dy12;
+        b = x0 + sb / dy02;
+        sa += dx12;
+        sb += dx02;
+        if (a > b) swap(a, b);
+        ops->hline(a, y, b - a + 1, color);
+    }
+}
+
+// the test.c routines with the old shapes, only the shapes are drawn
+static int oldFillCircles(const Ops *ops, int radius, unsigned int color) {
+    int x, y, n = 0;
+    for (x = radius; x < WIDTH - 1; x += radius * 2) {
+        for (y = radius; y < HEIGHT - 1; y += radius * 2, n++) {
+            oldFillCircle(ops, x, y, radius, color);
+        }
+    }
+    return n;
+}
+
+static int oldDrawCircles(const Ops *ops, int radius, unsigned int color) {
+    int x, y, n = 0;
+    for (x = 0; x < WIDTH - 1 + radius; x += radius * 2) {
+        for (y = 0; y < HEIGHT - 1 + radius; y += radius * 2, n++) {
+            oldDrawCircle(ops, x, y, radius, color);
+        }
+    }
+    return n;
+}
+
+static int oldTriangles(const Ops *ops) {
+    int color = 0xF800, t, w = WIDTH / 2, x = HEIGHT - 1, y = 0, z = WIDTH - 1;
+    for (t = 0; t <= 15; t++) {
+        oldDrawTriangle(ops, w, y, y, x, z, x, color);
+        x -= 4;
+        y += 4;
+        z -= 4;
+        color += 100;
+    }
+    return t;
+}
+
+static int oldRoundRects(const Ops *ops) {
+    int color = 100, i, x = 0, y = 0, w = WIDTH, h = HEIGHT;
+    for (i = 0; i <= 24; i++) {
+        oldDrawRoundRect(ops, x, y, w, h, 5, color);
+        x += 2;
+        y += 3;
+        w -= 4;
+        h -= 6;
+        color += 1100;
+    }
+    return i;
+}
+
+static int differences(void) {
+    int x, y, n = 0;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            n += panelPixel(x, y) != ref[y][x];
+        }
+    }
+    return n;
+}
+
+static void clearBoth(void) {
+    int x, y;
+    panelReset();
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            ref[y][x] = 0;
+        }
+    }
+}
+
+// random shapes, some of them hanging off the screen
+static void checkRandom(void) {
+    static const char *names[] = { "drawCircle", "fillCircle", "drawLine", "drawTriangle", "fillTriangle",
+                                   "fillRoundRect", "drawCircleHelper" };
+    int i, kind, x0, y0, x1, y1, x2, y2, r, w, h, k;
+    unsigned int color;
+    Rng rng;
+
+    rngSeed(&rng, 1351);
+    for (i = 0; i < RANDOM_SHAPES; i++) {
+        kind = rngRange(&rng, 7);
+        color = 1 + rngRange(&rng, 0xFFFF);
+        x0 = (int) rngRange(&rng, WIDTH + 40) - 20;
+        y0 = (int) rngRange(&rng, HEIGHT + 40) - 20;
+        x1 = (int) rngRange(&rng, WIDTH + 40) - 20;
+        y1 = (int) rngRange(&rng, HEIGHT + 40) - 20;
+        x2 = (int) rngRange(&rng, WIDTH + 40) - 20;
+        y2 = (int) rngRange(&rng, HEIGHT + 40) - 20;
+        r = rngRange(&rng, 30);
+        w = 2 * r + 1 + rngRange(&rng, 40);
+        h = 2 * r + 1 + rngRange(&rng, 40);
+        k = 1 + rngRange(&rng, 15);
+
+        clearBoth();
+        switch (kind) {
+            case 0:
+                oldDrawCircle(&exact, x0, y0, r, color);
+                drawCircle(x0, y0, r, color);
+                break;
+            case 1:
+                oldFillCircle(&exact, x0, y0, r, color);
+                fillCircle(x0, y0, r, color);
+                break;
+            case 2:
+                oldDrawLine(&exact, x0, y0, x1, y1, color);
+                drawLine(x0, y0, x1, y1, color);
+                break;
+            case 3:
+                oldDrawTriangle(&exact, x0, y0, x1, y1, x2, y2, color);
+                drawTriangle(x0, y0, x1, y1, x2, y2, color);
+                break;
+            case 4:
+                if (rngRange(&rng, 4) == 0) { // flat tops, bottoms and lines
+                    y1 = rngRange(&rng, 2) ? y0 : y2;
+                }
+                oldFillTriangle(&exact, x0, y0, x1, y1, x2, y2, color);
+                fillTriangle(x0, y0, x1, y1, x2, y2, color);
+                break;
+            case 5:
+                oldFillRoundRect(&exact, x0, y0, w, h, r, color);
+                fillRoundRect(x0, y0, w, h, r, color);
+                break;
+            default:
+                oldDrawCircleHelper(&exact, x0, y0, r, k, color);
+                drawCircleHelper(x0, y0, r, k, color);
+                break;
+        }
+        CHECK(differences() == 0, "%s #%d at %d,%d r %d: %d pixels differ", names[kind], i, x0, y0, r,
+              differences());
+        CHECK(panelStats.unselected == 0, "bytes went out unselected");
+    }
+}
+
+// runs a test.c routine and the old shapes behind it, same pixels, fewer
+// transactions. Shapes go out polled, the selects leave out the DMA screen
+// clears some of the routines start with.
+static void bench(const char *name, void (*run)(void), int (*old)(const Ops *ops)) {
+    unsigned long newCount, oldCount;
+    int shapes;
+
+    clearBoth();
+    run();
+    newCount = panelStats.selects;
+    shapes = old(&exact);
+    CHECK(differences() == 0, "%s: %d pixels differ", name, differences());
+
+    panelReset();
+    old(&driver);
+    oldCount = panelStats.selects;
+    CHECK(newCount < oldCount, "%s took %lu transactions, %lu before", name, newCount, oldCount);
+    printf("%-20s %3d shapes %6lu transactions, %6.1f per shape, %6.1f before\n", name, shapes, newCount,
+           (double) newCount / shapes, (double) oldCount / shapes);
+}
+
+static void fillCircles(void) {
+    testfillcircles(10, BLUE);
+}
+
+static int oldFillCircles10(const Ops *ops) {
+    return oldFillCircles(ops, 10, BLUE);
+}
+
+static void drawCircles(void) {
+    testdrawcircles(10, WHITE);
+}
+
+static int oldDrawCircles10(const Ops *ops) {
+    return oldDrawCircles(ops, 10, WHITE);
+}
+
+static void triangles(void) {
+    testtriangles();
+}
+
+static void roundRects(void) {
+    testroundrects();
+}
+
+int main(void) {
+    checkRandom();
+    bench("testfillcircles(10)", fillCircles, oldFillCircles10);
+    bench("testdrawcircles(10)", drawCircles, oldDrawCircles10);
+    bench("testtriangles", triangles, oldTriangles);
+    bench("testroundrects", roundRects, oldRoundRects);
+    return checkResult("shapetest");
+}
@@ -0,0 +1,354 @@
+/*
+ * sim.c
+ *
+ *  Headless driver for the game core. Runs scripted games as fast as the
+ *  host allows and reports ticks per second, the state hash printed at the
+ *  end changes whenever gameplay does.
+ *
+ *    sim [-g games] [-t ticks] [-s seed]  scripted games
+ *    sim -w log [-s seed] [-t ticks]      one scripted game, log in the UART dump format
+ *    sim -r log                           replays a log dumped by the board or by -w
+ *    sim -a [-g games] [-t ticks] [-s seed]  AI tournament, every strategy on all
+ *                                         baddies and then the board's mix
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "game.h"
+#include "rng.h"
+#include "replay.h"
+
+#define TILT_RANGE 15 // same as the board's velFactor
+
+static Rng script;          // drives the scripted tilt and remote commands
+static int tiltX, tiltY;
+static bool recording = false;
+static ReplayReader reader;
+static bool underrun = false; // the log ran out of input for this level
+static unsigned long hash;
+
+static const char *aiNames[AI_MODES + 1] = { "chase", "ambush", "scatter", "random", "mixed" };
+
+// tilt that wanders like a hand holding the board
+static void scriptInput(Game *game, int *xVel, int *yVel) {
+    (void) game;
+    if (rngRange(&script, 8) == 0) {
+        tiltX = (int) rngRange(&script, 2 * TILT_RANGE + 1) - TILT_RANGE;
+        tiltY = (int) rngRange(&script, 2 * TILT_RANGE + 1) - TILT_RANGE;
+    }
+    *xVel = tiltX;
+    *yVel = tiltY;
+    if (recording) {
+        replayAccel(*xVel, *yVel);
+    }
+}
+
+// a remote player sending short queues to baddies that wait for commands
+static void scriptNetwork(Game *game) {
+    struct Baddie *bad = &game->bads[rngRange(&script, NUM_BADDIES)];
+    int i, n;
+    bad->ready = false; // the board acks on its next update
+    if (rngRange(&script, 16) != 0 || bad->dirQueue[0] != '\0') {
+        return;
+    }
+    n = 1 + rngRange(&script, 4);
+    for (i = 0; i < n; i++) {
+        bad->dirQueue[i] = '0' + rngRange(&script, 4);
+    }
+    bad->dirQueue[n] = '\0';
+    game->selectedBaddie = bad->id;
+    if (recording) {
+        replayQueue(game->inputTimer, bad->id, bad->dirQueue);
+    }
+}
+
+static void replayInput(Game *game, int *xVel, int *yVel) {
+    (void) game;
+    if (!replayNextAccel(&reader, xVel, yVel)) {
+        underrun = true;
+    }
+}
+
+static void replayNetwork(Game *game) {
+    struct Baddie *bad;
+    char dirs[16];
+    int id, n;
+    while (replayNextQueue(&reader, game->inputTimer, &id, dirs)) {
+        if (id >= NUM_BADDIES) {
+            continue;
+        }
+        bad = &game->bads[id];
+        n = strlen(dirs);
+        if (n > (int) sizeof(bad->dirQueue) - 1) {
+            n = sizeof(bad->dirQueue) - 1; // the board never logs longer ones
+        }
+        memcpy(bad->dirQueue, dirs, n);
+        bad->dirQueue[n] = '\0';
+        game->selectedBaddie = id;
+    }
+}
+
+// nothing is drawn or played, only the game state counts
+static void drawSprite(int id, int x, int y, unsigned int color) {
+    (void) id; (void) x; (void) y; (void) color;
+}
+
+static void clearTile(int tx, int ty) {
+    (void) tx; (void) ty;
+}
+
+static void drawScore(int score) {
+    (void) score;
+}
+
+static void present(void) {}
+
+static void playSound(char *song) {
+    (void) song;
+}
+
+static const GameIO scriptIO = {
+    scriptInput, scriptNetwork,
+    drawSprite, clearTile, drawScore, present,
+    playSound,
+    NULL
+};
+
+static const GameIO replayIO = {
+    replayInput, replayNetwork,
+    drawSprite, clearTile, drawScore, present,
+    playSound,
+    NULL
+};
+
+static unsigned long nanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+// the tournament times every strategy call
+static const GameIO timedIO = {
+    scriptInput, scriptNetwork,
+    drawSprite, clearTile, drawScore, present,
+    playSound,
+    nanoseconds
+};
+
+// folds everything that moves into the running hash
+static void hashState(const Game *game) {
+    int i;
+    hash = hash * 31 + game->pac.x * 7 + game->pac.y * 13 + game->pac.score;
+    for (i = 0; i < NUM_BADDIES; i++) {
+        hash = hash * 17 + game->bads[i].x * 5 + game->bads[i].y;
+    }
+}
+
+typedef struct {
+    long games, ticks, lost, cleared, score;
+} Totals;
+
+// steps until the level ends or the log has no more input for it
+static void play(Game *game, unsigned long seed, long maxTicks, Totals *totals) {
+    GameResult result = GAME_RUNNING;
+    long t;
+    game->pac.score = 0; // every game starts from the title screen
+    gameReset(game, seed);
+    for (t = 0; t < maxTicks && result == GAME_RUNNING && !underrun; t++) {
+        result = gameStep(game);
+        hashState(game);
+    }
+    totals->games++;
+    totals->ticks += t;
+    totals->lost += result == GAME_LOST;
+    totals->cleared += result == GAME_CLEARED;
+    totals->score += game->pac.score;
+}
+
+static void report(const Totals *totals, clock_t start) {
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%ld games, %ld ticks in %.3f s, %.0f ticks/s\n", totals->games, totals->ticks,
+           seconds, seconds > 0 ? totals->ticks / seconds : 0.0);
+    printf("lost %ld, cleared %ld, avg score %.1f, hash %08lx\n", totals->lost, totals->cleared,
+           totals->games ? (double) totals->score / totals->games : 0.0, hash & 0xFFFFFFFFUL);
+}
+
+// what a back to back pair of clock reads costs, taken off every decision
+static double clockOverhead(void) {
+    unsigned long start, best = ~0UL;
+    int i;
+    for (i = 0; i < 100000; i++) {
+        start = nanoseconds();
+        start = nanoseconds() - start;
+        if (start < best) {
+            best = start;
+        }
+    }
+    return best;
+}
+
+// the same scripted games for every lineup, only the baddie strategies
+// change. Only the strategy calls are timed, not the rest of the tick
+static void tournament(Game *game, unsigned long seed, long games, long maxTicks) {
+    Totals totals;
+    double overhead = clockOverhead();
+    int lineup, i;
+    long g;
+
+    printf("lineup   lost  cleared  avg score  avg ticks  decisions  ns/decision\n");
+    for (lineup = 0; lineup <= AI_MODES; lineup++) {
+        memset(&totals, 0, sizeof(totals));
+        gameInit(game, &timedIO);
+        if (lineup < AI_MODES) {
+            for (i = 0; i < NUM_BADDIES; i++) {
+                game->bads[i].ai = lineup;
+            }
+        }
+        rngSeed(&script, seed);
+        for (g = 0; g < games; g++) {
+            play(game, seed + g, maxTicks, &totals);
+        }
+        printf("%-8s %5ld  %7ld  %9.1f  %9.0f  %9lu  %11.1f\n", aiNames[lineup], totals.lost, totals.cleared,
+               (double) totals.score / games, (double) totals.ticks / games, game->decisions,
+               game->decisions ? (double) game->decisionTime / game->decisions - overhead : 0.0);
+    }
+    printf("clock overhead of %.0f ns taken off every decision\n", overhead);
+}
+
+static int hexDigit(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// hex bytes as dumped over the UART, the "replay N bytes" header and the
+// line breaks around the rows are skipped
+static int readLog(const char *path, unsigned char *out, int max) {
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int n = 0, high = -1, digit, i;
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strstr(line, "replay") != NULL) {
+            continue;
+        }
+        for (i = 0; line[i] != '\0' && n < max; i++) {
+            if ((digit = hexDigit(line[i])) < 0) {
+                continue;
+            }
+            if (high < 0) {
+                high = digit;
+            } else {
+                out[n++] = high << 4 | digit;
+                high = -1;
+            }
+        }
+    }
+    fclose(file);
+    return n;
+}
+
+static void writeLog(const char *path) {
+    FILE *file = fopen(path, "w");
+    unsigned char chunk[32];
+    int offset = 0, n, i;
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(file, "replay %d bytes\n", replaySize());
+    while ((n = replayCopy(chunk, offset, sizeof(chunk))) > 0) {
+        for (i = 0; i < n; i++) {
+            fprintf(file, "%02x", chunk[i]);
+        }
+        fprintf(file, "\n");
+        offset += n;
+    }
+    fclose(file);
+}
+
+int main(int argc, char **argv) {
+    static Game game;
+    static unsigned char log[REPLAY_BUFFER_SIZE];
+    const char *logPath = NULL;
+    unsigned long seed = 1, levelSeed;
+    long games = 1000, maxTicks = 10000, g;
+    bool replaying = false, tourney = false;
+    Totals totals = { 0 };
+    clock_t start;
+    int i, length;
+
+    for (i = 1; i < argc; i += 2) {
+        if (strcmp(argv[i], "-a") == 0) {
+            tourney = true;
+            i--; // takes no value
+        } else if (i + 1 == argc) {
+            break;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            games = atol(argv[i + 1]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            maxTicks = atol(argv[i + 1]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            seed = strtoul(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            logPath = argv[i + 1];
+            recording = true;
+            games = 1; // the ring only holds a few thousand ticks
+        } else if (strcmp(argv[i], "-r") == 0) {
+            logPath = argv[i + 1];
+            replaying = true;
+        } else {
+            break;
+        }
+    }
+    if (i < argc) {
+        fprintf(stderr, "usage: %s [-g games] [-t ticks] [-s seed] [-w log | -r log | -a]\n", argv[0]);
+        return 2;
+    }
+
+    if (replaying) {
+        length = readLog(logPath, log, sizeof(log));
+        gameInit(&game, &replayIO);
+        replayOpen(&reader, log, length);
+        start = clock();
+        while (replayNextLevel(&reader, &levelSeed)) {
+            underrun = false;
+            play(&game, levelSeed, maxTicks, &totals);
+        }
+        printf("replayed %d log bytes\n", length);
+        report(&totals, start);
+        return 0;
+    }
+
+    if (tourney) {
+        tournament(&game, seed, games, maxTicks);
+        return 0;
+    }
+
+    gameInit(&game, &scriptIO);
+    rngSeed(&script, seed);
+    if (recording) {
+        replayReset();
+    }
+    start = clock();
+    for (g = 0; g < games; g++) {
+        levelSeed = seed + g;
+        if (recording) {
+            replayLevel(levelSeed);
+        }
+        play(&game, levelSeed, maxTicks, &totals);
+    }
+    report(&totals, start);
+    if (recording) {
+        writeLog(logPath);
+    }
+    return 0;
+}
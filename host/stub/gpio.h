@@ -0,0 +1,12 @@
+/*
+ * gpio.h
+ *
+ *  Host stand-in, tests define the pins they watch.
+ */
+
+#ifndef GPIO_H_
+#define GPIO_H_
+
+void GPIOPinWrite(unsigned long ulPort, unsigned char ucPins, unsigned char ucVal);
+
+#endif /* GPIO_H_ */
@@ -0,0 +1,10 @@
+/*
+ * hw_common_reg.h
+ *
+ *  Host stand-in for the driverlib headers, only what the host tests use.
+ */
+
+#ifndef HW_COMMON_REG_H_
+#define HW_COMMON_REG_H_
+
+#endif /* HW_COMMON_REG_H_ */
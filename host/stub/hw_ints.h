@@ -0,0 +1,12 @@
+/*
+ * hw_ints.h
+ *
+ *  Host stand-in for the driverlib headers, only what the host tests use.
+ */
+
+#ifndef HW_INTS_H_
+#define HW_INTS_H_
+
+#define INT_TIMERA1A 37
+
+#endif /* HW_INTS_H_ */
@@ -0,0 +1,16 @@
+/*
+ * hw_memmap.h
+ *
+ *  Host stand-in for the driverlib headers, only what the host tests use.
+ */
+
+#ifndef HW_MEMMAP_H_
+#define HW_MEMMAP_H_
+
+#define TIMERA1_BASE 0x40031000
+#define GPIOA1_BASE  0x40005000
+#define GPIOA2_BASE  0x40006000
+#define GPIOA3_BASE  0x40007000
+#define GSPI_BASE    0x44021000
+
+#endif /* HW_MEMMAP_H_ */
@@ -0,0 +1,10 @@
+/*
+ * hw_types.h
+ *
+ *  Host stand-in for the driverlib headers, only what the host tests use.
+ */
+
+#ifndef HW_TYPES_H_
+#define HW_TYPES_H_
+
+#endif /* HW_TYPES_H_ */
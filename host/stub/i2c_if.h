@@ -0,0 +1,13 @@
+/*
+ * i2c_if.h
+ *
+ *  Host stand-in, tests define the bus and the device behind it.
+ */
+
+#ifndef I2C_IF_H_
+#define I2C_IF_H_
+
+int I2C_IF_ReadFrom(unsigned char ucDevAddr, unsigned char *pucWrDataBuf, unsigned char ucWrLen,
+                    unsigned char *pucRdDataBuf, unsigned char ucRdLen);
+
+#endif /* I2C_IF_H_ */
@@ -0,0 +1,17 @@
+/*
+ * interrupt.h
+ *
+ *  Host stand-in for the driverlib headers, only what the host tests use.
+ */
+
+#ifndef INTERRUPT_H_
+#define INTERRUPT_H_
+
+// lower levels preempt higher ones, as on the Cortex-M4
+#define INT_PRIORITY_LVL_0 0x00
+#define INT_PRIORITY_LVL_1 0x20
+#define INT_PRIORITY_LVL_2 0x40
+
+void IntPrioritySet(unsigned long ulInterrupt, unsigned char ucPriority);
+
+#endif /* INTERRUPT_H_ */
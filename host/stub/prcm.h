@@ -0,0 +1,14 @@
+/*
+ * prcm.h
+ *
+ *  Host stand-in, tests define the slow clock counter.
+ */
+
+#ifndef PRCM_H_
+#define PRCM_H_
+
+#define PRCM_TIMERA1 0x00000005
+
+unsigned long long PRCMSlowClkCtrGet(void);
+
+#endif /* PRCM_H_ */
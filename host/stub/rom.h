@@ -0,0 +1,10 @@
+/*
+ * rom.h
+ *
+ *  Host stand-in, the ROM copies of driverlib are never used off the board.
+ */
+
+#ifndef ROM_H_
+#define ROM_H_
+
+#endif /* ROM_H_ */
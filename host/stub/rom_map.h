@@ -0,0 +1,22 @@
+/*
+ * rom_map.h
+ *
+ *  Host stand-in, every MAP_ call goes to the function the test defines.
+ */
+
+#ifndef ROM_MAP_H_
+#define ROM_MAP_H_
+
+#define MAP_UtilsDelay             UtilsDelay
+#define MAP_SysTickPeriodSet       SysTickPeriodSet
+#define MAP_SysTickEnable          SysTickEnable
+#define MAP_SysTickValueGet        SysTickValueGet
+#define MAP_UARTCharsAvail         UARTCharsAvail
+#define MAP_UARTCharGetNonBlocking UARTCharGetNonBlocking
+#define MAP_SPICSEnable            SPICSEnable
+#define MAP_SPICSDisable           SPICSDisable
+#define MAP_SPIDataPut             SPIDataPut
+#define MAP_SPIDataGet             SPIDataGet
+#define MAP_IntPrioritySet         IntPrioritySet
+
+#endif /* ROM_MAP_H_ */
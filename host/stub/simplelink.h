@@ -0,0 +1,17 @@
+/*
+ * simplelink.h
+ *
+ *  Host stand-in for the SimpleLink socket calls the session code uses.
+ *  Tests define sl_Send and sl_Recv to script the server side.
+ */
+
+#ifndef SIMPLELINK_H_
+#define SIMPLELINK_H_
+
+#define SL_EAGAIN       (-11)
+#define SL_MSG_DONTWAIT 0x00000008
+
+int sl_Send(int sd, const void *buf, int len, int flags);
+int sl_Recv(int sd, void *buf, int len, int flags);
+
+#endif /* SIMPLELINK_H_ */
@@ -0,0 +1,15 @@
+/*
+ * spi.h
+ *
+ *  Host stand-in, tests define the polled GSPI calls.
+ */
+
+#ifndef SPI_H_
+#define SPI_H_
+
+void SPICSEnable(unsigned long ulBase);
+void SPICSDisable(unsigned long ulBase);
+void SPIDataPut(unsigned long ulBase, unsigned long ulData);
+void SPIDataGet(unsigned long ulBase, unsigned long *pulData);
+
+#endif /* SPI_H_ */
@@ -0,0 +1,14 @@
+/*
+ * systick.h
+ *
+ *  Host stand-in, tests define the SysTick counter.
+ */
+
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+void SysTickPeriodSet(unsigned long ulPeriod);
+void SysTickEnable(void);
+unsigned long SysTickValueGet(void);
+
+#endif /* SYSTICK_H_ */
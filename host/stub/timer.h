@@ -0,0 +1,13 @@
+/*
+ * timer.h
+ *
+ *  Host stand-in, only the values the timer interface is called with.
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#define TIMER_CFG_PERIODIC 0x00000022
+#define TIMER_A            0x000000FF
+
+#endif /* TIMER_H_ */
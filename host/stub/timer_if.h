@@ -0,0 +1,16 @@
+/*
+ * timer_if.h
+ *
+ *  Host stand-in, tests define the timer and fire its handler themselves.
+ */
+
+#ifndef TIMER_IF_H_
+#define TIMER_IF_H_
+
+void Timer_IF_Init(unsigned long ePeripheral, unsigned long ulBase, unsigned long ulConfig,
+                   unsigned long ulTimer, unsigned long ulValue);
+void Timer_IF_IntSetup(unsigned long ulBase, unsigned long ulTimer, void (*TimerBaseIntHandler)(void));
+void Timer_IF_InterruptClear(unsigned long ulBase);
+void Timer_IF_Start(unsigned long ulBase, unsigned long ulTimer, unsigned long ulValue);
+
+#endif /* TIMER_IF_H_ */
@@ -0,0 +1,13 @@
+/*
+ * uart.h
+ *
+ *  Host stand-in, tests define the console input.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+int UARTCharsAvail(unsigned long ulBase);
+long UARTCharGetNonBlocking(unsigned long ulBase);
+
+#endif /* UART_H_ */
@@ -0,0 +1,14 @@
+/*
+ * uart_if.h
+ *
+ *  Host stand-in, tests define Report to capture the console output.
+ */
+
+#ifndef UART_IF_H_
+#define UART_IF_H_
+
+#define CONSOLE 0
+
+int Report(const char *format, ...);
+
+#endif /* UART_IF_H_ */
@@ -0,0 +1,12 @@
+/*
+ * utils.h
+ *
+ *  Host stand-in, tests define the delay loop against their own clock.
+ */
+
+#ifndef UTILS_H_
+#define UTILS_H_
+
+void UtilsDelay(unsigned long ulCount);
+
+#endif /* UTILS_H_ */
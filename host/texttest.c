@@ -0,0 +1,153 @@
+/*
+ * texttest.c
+ *
+ *  Checks the glyph cache text path against the pixel by pixel drawChar
+ *  it replaced, on the panel stand-in. Every size, color and clip case has
+ *  to leave the same pixels, and opaque text has to go out as one window
+ *  per character. Prints the bus cost of a line of text both ways.
+ *
+ *    texttest      checks, exits 1 on a mismatch
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "glcdfont.h"
+#include "panel.h"
+#include "rng.h"
+#include "check.h"
+
+#define RANDOM_CHARS 3000
+#define BENCH_TEXT   "SCREEN CLEARED"
+
+extern int cursor_x, cursor_y;
+
+static unsigned int before[HEIGHT][WIDTH];
+
+// drawChar as it was, pixel by pixel, with size x size blocks of pixels for
+// big text where it used rects that went missing when they crossed an edge
+static void oldDrawChar(int x, int y, unsigned char c, unsigned int color, unsigned int bg, unsigned char size) {
+    unsigned char line;
+    int i, j, k;
+
+    if (x >= WIDTH || y >= HEIGHT || x + 6 * size - 1 < 0 || y + 8 * size - 1 < 0) {
+        return;
+    }
+    for (i = 0; i < 6; i++) {
+        line = i == 5 ? 0 : font[c * 5 + i];
+        for (j = 0; j < 8; j++) {
+            if ((line & 0x1) || bg != color) {
+                for (k = 0; k < size * size; k++) {
+                    drawPixel(x + i * size + k % size, y + j * size + k / size, (line & 0x1) ? color : bg);
+                }
+            }
+            line >>= 1;
+        }
+    }
+}
+
+static void snapshot(void) {
+    int x, y;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            before[y][x] = panelPixel(x, y);
+        }
+    }
+}
+
+static int differences(void) {
+    int x, y, n = 0;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            n += panelPixel(x, y) != before[y][x];
+        }
+    }
+    return n;
+}
+
+// random characters both ways, some of them clipped by an edge
+static void checkPixels(void) {
+    unsigned int color, bg;
+    unsigned char c, size;
+    int i, x, y;
+    Rng rng;
+
+    rngSeed(&rng, 6 * 8);
+    for (i = 0; i < RANDOM_CHARS; i++) {
+        c = rngRange(&rng, sizeof(font) / 5); // the font stops at 254
+        size = 1 + (rngRange(&rng, 4) == 0);
+        color = rngNext(&rng) & 0xFFFF;
+        // a few colors so the cache sees hits, misses and evictions
+        bg = rngRange(&rng, 4) == 0 ? color : (rngRange(&rng, 3) * 0x5555) & 0xFFFF;
+        x = (int) rngRange(&rng, WIDTH + 12) - 12;
+        y = (int) rngRange(&rng, HEIGHT + 16) - 16;
+
+        panelReset();
+        oldDrawChar(x, y, c, color, bg, size);
+        snapshot();
+        panelReset();
+        drawChar(x, y, c, color, bg, size);
+        CHECK(differences() == 0, "char %d size %d at %d,%d %s: %d pixels differ", c, size, x, y,
+              bg == color ? "transparent" : "opaque", differences());
+        CHECK(panelStats.unselected == 0, "bytes went out unselected");
+        if (size == 1 && bg != color && x >= 0 && y >= 0 && x + 6 <= WIDTH && y + 8 <= HEIGHT) {
+            CHECK(panelStats.windows == 1 && panelStats.bytes == 7 + 6 * 8 * 2,
+                  "opaque char took %lu windows and %lu bytes", panelStats.windows, panelStats.bytes);
+        }
+    }
+}
+
+// each draw changes one thing of the cached glyph before it, 'a' shares a
+// cache slot with 'A'
+static void checkCache(void) {
+    static const struct { unsigned char c; unsigned int color, bg; } draws[] = {
+        { 'A', 0xFFFF, 0x0000 }, { 'A', 0xFFFF, 0xF800 }, { 'A', 0xF800, 0xF81F },
+        { 'a', 0xF800, 0xF81F }, { 'A', 0xF800, 0xF81F }, { 'A', 0xFFFF, 0x0000 },
+    };
+    int i;
+
+    for (i = 0; i < (int) (sizeof(draws) / sizeof(draws[0])); i++) {
+        panelReset();
+        oldDrawChar(20, 20, draws[i].c, draws[i].color, draws[i].bg, 1);
+        snapshot();
+        panelReset();
+        drawChar(20, 20, draws[i].c, draws[i].color, draws[i].bg, 1);
+        CHECK(differences() == 0, "char %c in %04x on %04x after the cache saw others: %d pixels differ",
+              draws[i].c, draws[i].color, draws[i].bg, differences());
+    }
+}
+
+static void checkBench(void) {
+    unsigned long oldTransactions, oldBytes;
+    const char *p;
+
+    setTextSize(1);
+    setTextColor(0xFFFF, 0x0000);
+
+    panelReset();
+    for (p = BENCH_TEXT; *p; p++) {
+        oldDrawChar(10 + (p - BENCH_TEXT) * 6, 60, *p, 0xFFFF, 0x0000, 1);
+    }
+    snapshot();
+    oldTransactions = panelTransactions();
+    oldBytes = panelStats.bytes;
+
+    panelReset();
+    setCursor(10, 60);
+    Outstr(BENCH_TEXT);
+    CHECK(differences() == 0, "Outstr(\"%s\") differs in %d pixels", BENCH_TEXT, differences());
+    CHECK(panelTransactions() == 6 * strlen(BENCH_TEXT) && panelStats.bytes == (7 + 96) * strlen(BENCH_TEXT),
+          "Outstr(\"%s\") took %lu transactions and %lu bytes", BENCH_TEXT, panelTransactions(), panelStats.bytes);
+    CHECK(cursor_x == 10 + 6 * (int) strlen(BENCH_TEXT) && cursor_y == 60, "cursor left at %d,%d", cursor_x, cursor_y);
+    printf("Outstr(\"%s\"): %lu transactions and %lu bytes, %lu and %lu pixel by pixel\n", BENCH_TEXT,
+           panelTransactions(), panelStats.bytes, oldTransactions, oldBytes);
+}
+
+int main(void) {
+    checkPixels();
+    checkCache();
+    checkBench();
+    return checkResult("texttest");
+}
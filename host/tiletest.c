@@ -0,0 +1,154 @@
+/*
+ * tiletest.c
+ *
+ *  Checks the one pass maze against the per tile rendering it replaced,
+ *  on the panel stand-in: a wall rect per wall tile and a pellet rect per
+ *  pellet over a cleared screen. Compares a fresh level and levels with
+ *  pellets eaten, drawn directly and through the framebuffer, and prints
+ *  what each way costs on the bus.
+ *
+ *    tiletest           checks, exits 1 on a mismatch
+ *    tiletest -p file   also writes the level start maze as a PPM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "framebuffer.h"
+#include "map.h"
+#include "tiles.h"
+#include "panel.h"
+#include "rng.h"
+#include "check.h"
+
+static unsigned int perTile[HEIGHT][WIDTH];
+
+// the start screen as it was drawn before, one window per wall and pellet
+static void drawPerTile(void) {
+    int i, j, k = TILE_SIZE / 2;
+
+    fillScreen(0x0000);
+    for (j = 0; j < MAP_SIZE; j++) {
+        for (i = 0; i < MAP_SIZE; i++) {
+            if (IS_WALL(i, j)) {
+                fillRect(i * TILE_SIZE, j * TILE_SIZE, TILE_SIZE, TILE_SIZE, WALL_COLOR);
+            } else if (HAS_PELLET(i, j)) {
+                fillRect(i * TILE_SIZE + TILE_SIZE / 2 - k / 2, j * TILE_SIZE + TILE_SIZE / 2 - k / 2, k, k, POINT_COLOR);
+            }
+        }
+    }
+}
+
+static void snapshot(void) {
+    int x, y;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            perTile[y][x] = panelPixel(x, y);
+        }
+    }
+}
+
+static int differences(void) {
+    int x, y, n = 0;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            n += panelPixel(x, y) != perTile[y][x];
+        }
+    }
+    return n;
+}
+
+// the panel starts out with noise so nothing is left to the clear
+static void scramble(Rng *rng) {
+    int i;
+    panelReset();
+    for (i = 0; i < 40; i++) {
+        fillRect(rngRange(rng, WIDTH - 8), rngRange(rng, HEIGHT - 8), 8, 8, rngNext(rng) & 0xFFFF);
+    }
+}
+
+static void checkLevel(const char *what, Rng *rng, bool verbose) {
+    unsigned long oldTransactions, oldBytes;
+
+    scramble(rng);
+    drawPerTile();
+    snapshot();
+    oldTransactions = panelTransactions();
+    oldBytes = panelStats.bytes;
+
+    scramble(rng);
+    panelStats = (PanelStats) { 0 };
+    drawMaze();
+    CHECK(differences() == 0, "%s: %d pixels differ", what, differences());
+    CHECK(panelTransactions() == 6 && panelStats.windows == 1, "%s took %lu transactions in %lu windows", what,
+          panelTransactions(), panelStats.windows);
+    if (verbose) {
+        printf("%s: %lu transactions and %lu bytes, %lu and %lu a window per tile\n", what, panelTransactions(),
+               panelStats.bytes, oldTransactions, oldBytes);
+    }
+
+    // the framebuffer copy goes out on the next flush
+    scramble(rng);
+    setFrameBuffer(true);
+    drawMaze();
+    flushFrame();
+    setFrameBuffer(false);
+    CHECK(differences() == 0, "%s through the framebuffer: %d pixels differ", what, differences());
+}
+
+static void writePpm(const char *path) {
+    FILE *f = fopen(path, "wb");
+    int x, y;
+    unsigned int c;
+    if (f == NULL) {
+        CHECK(false, "cannot write %s", path);
+        return;
+    }
+    panelReset();
+    drawMaze();
+    fprintf(f, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            c = panelPixel(x, y); // RGB565
+            fputc((c >> 11) * 255 / 31, f);
+            fputc(((c >> 5) & 0x3F) * 255 / 63, f);
+            fputc((c & 0x1F) * 255 / 31, f);
+        }
+    }
+    fclose(f);
+}
+
+int main(int argc, char **argv) {
+    char what[32];
+    int level, eaten, tx, ty;
+    Rng rng;
+
+    rngSeed(&rng, MAP_SIZE);
+    resetPellets();
+    checkLevel("level start", &rng, true);
+
+    // pellets eaten a few at a time, down to an empty maze
+    for (level = 1; countPellets() > 0; level++) {
+        for (eaten = 0; eaten < 25; eaten++) {
+            tx = rngRange(&rng, MAP_SIZE);
+            ty = rngRange(&rng, MAP_SIZE);
+            EAT_PELLET(tx, ty);
+        }
+        if (level % 8 == 0) {
+            for (ty = 0; ty < MAP_SIZE; ty++) {
+                pelletBoard[ty] &= rngNext(&rng);
+            }
+        }
+        sprintf(what, "%d pellets left", countPellets());
+        checkLevel(what, &rng, false);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "-p") == 0) {
+        resetPellets();
+        writePpm(argv[2]);
+    }
+    return checkResult("tiletest");
+}
@@ -0,0 +1,260 @@
+/*
+ * http.c
+ *
+ *  Pipelined response framing over a non-blocking socket
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "simplelink.h"
+
+#include "http.h"
+
+enum {
+    H_HEADERS = 0,
+    H_LENGTH,     // Content-Length body
+    H_CHUNK_SIZE,
+    H_CHUNK_DATA,
+    H_CHUNK_END,  // CRLF after the chunk data
+    H_TRAILER
+};
+
+typedef struct {
+    HttpBodyCallback onBody;
+    HttpDoneCallback onDone;
+    void *arg;
+} HttpRequest;
+
+static int httpSocket = -1;
+static HttpRequest pipeline[HTTP_PIPELINE];
+static int first = 0, pending = 0;
+
+static char buffer[HTTP_BUFFER_SIZE];
+static int length = 0;    // bytes in the buffer
+static int state = H_HEADERS;
+static int status;
+static int bodyStart;     // first body byte of the current response
+static int pos;           // end of the framed body so far
+static int remaining;     // body or chunk bytes still to come
+
+void httpOpen(int sock) {
+    httpSocket = sock;
+    first = pending = 0;
+    length = 0;
+    state = H_HEADERS;
+}
+
+int httpPending(void) {
+    return pending;
+}
+
+bool httpSend(const char *request, int requestLength, HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg) {
+    HttpRequest *req;
+    if (pending == HTTP_PIPELINE || sl_Send(httpSocket, request, requestLength, 0) < 0) {
+        return false;
+    }
+    req = &pipeline[(first + pending) % HTTP_PIPELINE];
+    req->onBody = onBody;
+    req->onDone = onDone;
+    req->arg = arg;
+    pending++;
+    return true;
+}
+
+static int lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+// case insensitive match of a header name at the start of a line
+static bool isHeader(const char *line, const char *name) {
+    while (*name) {
+        if (lower(*line++) != *name++) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// index of the next CRLF from i, -1 when it has not arrived yet
+static int findLine(int i) {
+    for (; i + 1 < length; i++) {
+        if (buffer[i] == '\r' && buffer[i + 1] == '\n') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// drops n bytes at i, everything after moves down
+static void cut(int i, int n) {
+    memmove(&buffer[i], &buffer[i + n], length - i - n);
+    length -= n;
+}
+
+static void finish(int result) {
+    HttpRequest *req = &pipeline[first];
+    first = (first + 1) % HTTP_PIPELINE;
+    pending--;
+    if (req->onDone) {
+        req->onDone(result, req->arg);
+    }
+}
+
+// fails everything in flight, the buffer is dropped with it
+static void failAll(void) {
+    length = 0;
+    state = H_HEADERS;
+    while (pending > 0) {
+        finish(-1);
+    }
+}
+
+// status line and headers, false until the blank line is in
+static bool readHeaders(void) {
+    int line, end, value;
+    bool chunked = false;
+
+    // whatever precedes a status line is left over from a failed response
+    while (length >= 5 && memcmp(buffer, "HTTP/", 5) != 0) {
+        line = findLine(0);
+        cut(0, line < 0 ? length : line + 2);
+    }
+    if (length < 5) {
+        return false;
+    }
+    for (end = 0; (end = findLine(end)) >= 0; end += 2) {
+        if (end + 3 < length && buffer[end + 2] == '\r' && buffer[end + 3] == '\n') {
+            break;
+        }
+    }
+    if (end < 0) {
+        if (length == HTTP_BUFFER_SIZE) {
+            failAll();
+        }
+        return false;
+    }
+
+    status = 0;
+    for (line = 9; line < end && buffer[line] >= '0' && buffer[line] <= '9'; line++) { // "HTTP/1.1 200"
+        status = status * 10 + (buffer[line] - '0');
+    }
+    remaining = 0;
+    for (line = findLine(0) + 2; line <= end; line = findLine(line) + 2) {
+        if (isHeader(&buffer[line], "content-length:")) {
+            value = 0;
+            for (line += 15; buffer[line] == ' '; line++);
+            while (buffer[line] >= '0' && buffer[line] <= '9') {
+                value = value * 10 + (buffer[line++] - '0');
+            }
+            remaining = value;
+        } else if (isHeader(&buffer[line], "transfer-encoding:")) {
+            chunked = true; // only chunked is used on this endpoint
+        }
+    }
+    bodyStart = pos = end + 4;
+    state = chunked ? H_CHUNK_SIZE : H_LENGTH;
+    return true;
+}
+
+// frames as much of the body as has arrived, true once it is complete
+static bool readBody(void) {
+    int line, size;
+    char c;
+    while (1) {
+        switch (state) {
+            case H_LENGTH:
+                size = length - pos < remaining ? length - pos : remaining;
+                pos += size;
+                remaining -= size;
+                return remaining == 0;
+            case H_CHUNK_SIZE:
+            case H_TRAILER:
+                if ((line = findLine(pos)) < 0) {
+                    return false;
+                }
+                if (state == H_TRAILER) {
+                    cut(pos, line - pos + 2);
+                    if (line == pos) { // blank line ends the trailer
+                        return true;
+                    }
+                    break;
+                }
+                remaining = 0;
+                for (size = pos; size < line; size++) { // hex size, extensions ignored
+                    c = lower(buffer[size]);
+                    if (c >= '0' && c <= '9') {
+                        remaining = remaining * 16 + (c - '0');
+                    } else if (c >= 'a' && c <= 'f') {
+                        remaining = remaining * 16 + (c - 'a' + 10);
+                    } else {
+                        break;
+                    }
+                }
+                cut(pos, line - pos + 2);
+                state = remaining == 0 ? H_TRAILER : H_CHUNK_DATA;
+                break;
+            case H_CHUNK_DATA:
+                size = length - pos < remaining ? length - pos : remaining;
+                pos += size;
+                remaining -= size;
+                if (remaining > 0) {
+                    return false;
+                }
+                state = H_CHUNK_END;
+                break;
+            case H_CHUNK_END:
+                if (length - pos < 2) {
+                    return false;
+                }
+                cut(pos, 2);
+                state = H_CHUNK_SIZE;
+                break;
+        }
+    }
+}
+
+// frames every complete response in the buffer
+static void dispatch(void) {
+    HttpRequest *req;
+    bool done;
+    int oldPos;
+    while (pending > 0) {
+        if (state == H_HEADERS && !readHeaders()) {
+            return;
+        }
+        req = &pipeline[first];
+        oldPos = pos;
+        done = readBody();
+        if (req->onBody && pos > oldPos) {
+            req->onBody(&buffer[bodyStart], pos - bodyStart, req->arg);
+        }
+        if (!done) {
+            if (length == HTTP_BUFFER_SIZE) {
+                failAll(); // too long to frame
+            }
+            return;
+        }
+        cut(0, pos); // the next pipelined response moves to the front
+        state = H_HEADERS;
+        finish(status);
+    }
+}
+
+void httpPoll(void) {
+    int received;
+    if (pending == 0) {
+        return;
+    }
+    if (length < HTTP_BUFFER_SIZE) {
+        received = sl_Recv(httpSocket, &buffer[length], HTTP_BUFFER_SIZE - length, SL_MSG_DONTWAIT);
+        if (received == SL_EAGAIN) {
+            return;
+        } else if (received <= 0) { // error or closed by the server
+            failAll();
+            return;
+        }
+        length += received;
+    }
+    dispatch();
+}
@@ -0,0 +1,31 @@
+/*
+ * http.h
+ *
+ *  HTTP/1.1 client on the open TLS socket. Requests can be pipelined, the
+ *  responses are framed by Content-Length or chunked encoding as they come
+ *  in and handed back in order. Chunk headers are cut out in place, so the
+ *  body always sits in one piece in the receive buffer.
+ */
+
+#ifndef HTTP_H_
+#define HTTP_H_
+
+#include <stdbool.h>
+
+#define HTTP_BUFFER_SIZE 2048 // longest response, headers and all
+#define HTTP_PIPELINE    2    // requests waiting for their response
+
+// body received so far, same start on every call of one response
+typedef void (*HttpBodyCallback)(const char *body, int length, void *arg);
+// status code once the response is complete, -1 when it was lost
+typedef void (*HttpDoneCallback)(int status, void *arg);
+
+void httpOpen(int sock);
+// sends a full request, either callback may be NULL, false when the
+// pipeline is full or the send failed
+bool httpSend(const char *request, int length, HttpBodyCallback onBody, HttpDoneCallback onDone, void *arg);
+// reads what has arrived without blocking and completes finished responses
+void httpPoll(void);
+int httpPending(void);
+
+#endif /* HTTP_H_ */
@@ -5,78 +5,139 @@
  *      Author: Troi-Ryan Stoeffler
  */
 
-#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 
 #include "json.h"
 
-typedef struct JsonVar {
-    char name[20];
-    char value[20];
-} JsonVar;
+enum {
+    J_SEEK = 0, // waiting for the first brace
+    J_STRUCT,   // between tokens
+    J_STRING,
+    J_ESCAPE,
+    J_PRIMITIVE,
+    J_DONE
+};
 
-static JsonVar reportedVals[MAX_VAL];
-static int currIndex = 0;
+void jsonInit(JsonParser *parser, const char *scope, JsonCallback callback, void *arg) {
+    memset(parser, 0, sizeof(*parser));
+    parser->scope = scope;
+    parser->scopeLength = strlen(scope);
+    parser->callback = callback;
+    parser->arg = arg;
+    parser->state = J_SEEK;
+}
+
+bool jsonDone(const JsonParser *parser) {
+    return parser->state == J_DONE;
+}
 
-// simple json parser going through each thing
-void parseJSON(char *json) {
-    bool quoteMode = false, colonMode = false, reportMode = false;
-    static char str[20] = "", strIndex = 0;
-    char i, *j;
-    j = json;
-    currIndex = 0;
-    for (i = 0; i < MAX_VAL; i++) {
-        reportedVals[i] = (JsonVar) { .name = "", .value = "" };
+static bool inArray(const JsonParser *parser) {
+    return parser->depth < JSON_MAX_DEPTH && ((parser->arrays >> parser->depth) & 1);
+}
+
+// a complete string or primitive value
+static void value(JsonParser *parser, const char *buf, int start, int length) {
+    if (parser->callback && parser->scopeDepth && parser->depth == parser->scopeDepth && !inArray(parser)) {
+        parser->callback(&buf[parser->keyStart], parser->keyLength, &buf[start], length, parser->arg);
     }
-    while (*j != '\0') {
-        if (quoteMode) {
-            if (strIndex < 20) {
-                str[strIndex++] = *j;
-            }
-        }
-        if (*j == '\"') {
-            if (!quoteMode) {
-                quoteMode = true;
-                strIndex = 0;
-            } else {
-                quoteMode = false;
-                str[strIndex - 1] = '\0';
-                if (strstr(str, "reported") != NULL) {
-                    reportMode = true;
-                } else {
-                    if (reportMode) {
-                        if (currIndex < MAX_VAL) {
-                            if (colonMode) {
-                                strcpy(reportedVals[currIndex++].value, str);
-                                colonMode = false;
-                            } else {
-                                strcpy(reportedVals[currIndex].name, str);
-                            }
-                        }
-                    }
-                }
-            }
-        } else if (*j == ':') {
-            colonMode = true;
-        } else if (*j == '{') {
-            colonMode = false;
-        } else if (*j == '}') {
-            colonMode = false;
-            if (reportMode) {
-                return;
-            }
+}
+
+static void openContainer(JsonParser *parser, const char *buf, bool array) {
+    if (!array && parser->depth > 0 && !inArray(parser) && parser->scopeDepth == 0 &&
+        parser->keyLength == parser->scopeLength &&
+        memcmp(&buf[parser->keyStart], parser->scope, parser->scopeLength) == 0) {
+        parser->scopeDepth = parser->depth + 1;
+    }
+    parser->depth++;
+    if (parser->depth < JSON_MAX_DEPTH) {
+        if (array) {
+            parser->arrays |= 1UL << parser->depth;
+        } else {
+            parser->arrays &= ~(1UL << parser->depth);
         }
-        j++;
     }
+    parser->expectKey = !array;
 }
 
-char* getValue(char *name) {
-    int i;
-    for (i = 0; i < currIndex; i++) {
-        if(strcmp(reportedVals[i].name, name) == 0) {
-            return reportedVals[i].value;
+static void closeContainer(JsonParser *parser) {
+    if (parser->depth == parser->scopeDepth) {
+        parser->scopeDepth = 0;
+    }
+    parser->depth--;
+    parser->expectKey = false;
+    if (parser->depth == 0) {
+        parser->state = J_DONE;
+    }
+}
+
+static void structural(JsonParser *parser, const char *buf, char c) {
+    switch (c) {
+        case ' ': case '\t': case '\r': case '\n':
+            break;
+        case '"':
+            parser->tokenStart = parser->pos + 1;
+            parser->state = J_STRING;
+            break;
+        case '{':
+        case '[':
+            openContainer(parser, buf, c == '[');
+            break;
+        case '}':
+        case ']':
+            closeContainer(parser);
+            break;
+        case ':':
+            parser->expectKey = false;
+            break;
+        case ',':
+            parser->expectKey = !inArray(parser);
+            break;
+        default: // number, true, false or null
+            parser->tokenStart = parser->pos;
+            parser->state = J_PRIMITIVE;
+            break;
+    }
+}
+
+bool jsonFeed(JsonParser *parser, const char *buf, int length) {
+    char c;
+    for (; parser->pos < length && parser->state != J_DONE; parser->pos++) {
+        c = buf[parser->pos];
+        switch (parser->state) {
+            case J_SEEK:
+                if (c == '{') {
+                    parser->state = J_STRUCT;
+                    openContainer(parser, buf, false);
+                }
+                break;
+            case J_STRING:
+                if (c == '\\') {
+                    parser->state = J_ESCAPE;
+                } else if (c == '"') {
+                    parser->state = J_STRUCT;
+                    if (parser->expectKey) {
+                        parser->keyStart = parser->tokenStart;
+                        parser->keyLength = parser->pos - parser->tokenStart;
+                    } else {
+                        value(parser, buf, parser->tokenStart, parser->pos - parser->tokenStart);
+                    }
+                }
+                break;
+            case J_ESCAPE:
+                parser->state = J_STRING;
+                break;
+            case J_PRIMITIVE:
+                if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    value(parser, buf, parser->tokenStart, parser->pos - parser->tokenStart);
+                    parser->state = J_STRUCT;
+                    structural(parser, buf, c); // the delimiter still counts
+                }
+                break;
+            default:
+                structural(parser, buf, c);
+                break;
         }
     }
-    return NULL;
+    return parser->state == J_DONE;
 }
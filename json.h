@@ -3,14 +3,45 @@
  *
  *  Created on: Mar 11, 2020
  *      Author: Troi-Ryan Stoeffler
+ *
+ *  Resumable tokenizer for the shadow documents. The response is fed in as
+ *  it arrives, each call carries on from where the last one stopped. Values
+ *  are never copied: members of the object under the scope key are handed
+ *  to the callback as spans into the caller's buffer, which has to keep the
+ *  earlier bytes in place while more are appended. String spans leave out
+ *  the quotes and keep escapes as they are.
  */
 
 #ifndef JSON_H_
 #define JSON_H_
 
-#define MAX_VAL 10
+#include <stdbool.h>
+
+#define JSON_MAX_DEPTH 32 // nesting tracked by the array bitmask
+
+typedef void (*JsonCallback)(const char *key, int keyLength,
+                             const char *value, int valueLength, void *arg);
+
+typedef struct JsonParser {
+    const char *scope;     // key whose object members get reported
+    int scopeLength;
+    JsonCallback callback;
+    void *arg;
+    int pos;               // next byte of the buffer to look at
+    unsigned char state;
+    unsigned char depth;
+    unsigned char scopeDepth; // depth of the scope object, 0 outside of it
+    bool expectKey;
+    unsigned long arrays;  // bit d is set when depth d is an array
+    int tokenStart;        // first byte of the string or primitive being read
+    int keyStart, keyLength;
+} JsonParser;
 
-void parseJSON(char *json);
-char* getValue(char *name);
+// callback may be NULL when only the end of the document matters
+void jsonInit(JsonParser *parser, const char *scope, JsonCallback callback, void *arg);
+// scans buf up to length, returns true once the outermost object is closed;
+// anything before its opening brace, like the HTTP headers, is skipped
+bool jsonFeed(JsonParser *parser, const char *buf, int length);
+bool jsonDone(const JsonParser *parser);
 
 #endif /* JSON_H_ */
@@ -32,17 +32,32 @@
 // GFX stuff includes
 #include "Adafruit_GFX.h"
 #include "Adafruit_SSD1351.h"
+#include "framebuffer.h"
+#include "spi_dma.h"
 #include "test.h"
 #include "map.h"
+#include "tiles.h"
+#include "game.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "replay.h"
+#include "accel.h"
 #include "sound.h"
 #include "aws_if.h"
 #include "json.h"
+#include "shadow.h"
+#include "score.h"
 
 // macros for some constants
 #define SPI_IF_BIT_RATE  800000
 #define TR_BUFF_SIZE     100
-#define PAC_SIZE         4
-#define MAX_VEL          1
+#define TEXT_COLOR       0xFFFF
+#define TEXT_BG_COLOR    0x0000
+#if ENABLE_MQTT == 1
+#define SYNC_TICKS       6  // ~200 ms between location updates
+#else
+#define SYNC_TICKS       33 // ~1.1 s between POST/GET pairs
+#endif
 
 #define START_STATE  0
 #define GAME_STATE   1
@@ -58,33 +73,11 @@ extern void (* const g_pfnVectors[])(void);
 extern uVectorEntry __vector_table;
 #endif
 
-// pac struct
-struct Pac {
-    int x;
-    int y;
-    int score;
-};
-
-struct Baddie {
-    int id;
-    int x;
-    int y;
-    int velX;
-    int velY;
-    int color;
-    char dirQueue[8];
-    bool ready;
-    bool validMoves[4];
-};
 // static function prototypes
-static void updatePacLoc(struct Pac *Pac, int *xVel, int *yVel); // updates pac loc based on vel
 static int adjustVel(int vel, const int *velFactor); // adjusts raw readout from accelerometer to usable vel
-static long dropFrame(long frameCount); // tracks number of dropped frames
 static char *integerToString(int i);
 static char *coordsToString(int i, int j);
 static unsigned long getCurrentSysTimeMS(void);
-void decideVelocities(struct Baddie *bad); // decides next move direction of bad based on queue & valid moves
-static void determineValidMoves(struct Baddie *bad); // sets valid moves of bads
 static void BoardInit(void);
 
 static void mainGameLogic(void); // game logic for playing
@@ -93,7 +86,23 @@ static void startScreenLogic(void); // logic for init
 static void titleScreenLogic(void); // logic for init
 static void gameLoop(void); // loop over logics based on state
 
-static int pellet_counter = 0;
+// board backends for the game core
+static void readAccel(Game *game, int *xVel, int *yVel);
+static void syncShadow(Game *game);
+static void presentTiles(void);
+#if ENABLE_MQTT == 1
+static void readShadowMessage(const char *topic, int topicLength, const char *payload, int length, void *arg);
+static ShadowLoc sentLoc[NUM_BADDIES + 1]; // last published, pac first
+#endif
+
+static const GameIO boardIO = {
+    readAccel, syncShadow,
+    setSprite, markTileDirty, drawScore, presentTiles,
+    playSound,
+    NULL // the profiler times the whole step instead
+};
+
+static Game game;
 
 // main function definition
 void main() {
@@ -110,6 +119,9 @@ void main() {
     // I2C Init
     I2C_IF_Open(I2C_MASTER_MODE_FST);
 
+    // sample the accelerometer in the background
+    InitAccel();
+
     // enable spi clock
     MAP_PRCMPeripheralClkEnable(PRCM_GSPI,PRCM_RUN_MODE_CLK);
 
@@ -131,13 +143,36 @@ void main() {
     // enable spi for communication
     MAP_SPIEnable(GSPI_BASE);
 
+    // let frame flushes run on the uDMA in the background
+    InitSpiDma();
+
+#if ENABLE_PROFILER == 1 || ENABLE_REPLAY == 1 || ENABLE_SERVER == 1
+    // console pins are left unmuxed by PinMuxConfig, route them for the dumps
+    // and the network status
+    MAP_PRCMPeripheralClkEnable(PRCM_UARTA0, PRCM_RUN_MODE_CLK);
+    MAP_PinTypeUART(PIN_55, PIN_MODE_3);
+    MAP_PinTypeUART(PIN_57, PIN_MODE_3);
+    InitTerm();
+#endif
+#if ENABLE_PROFILER == 1
+    InitProfiler();
+#endif
+
 #if ENABLE_SERVER == 1
     // connect to the network
     networkConnect();
+#if ENABLE_MQTT == 1
+    if (!networkListen(readShadowMessage, NULL)) {
+        Report("shadow sync offline, retrying in the background\n\r");
+    }
+#endif
 #endif
 
-    // Initialize adafruit, then call the game loop
+    // Initialize adafruit, draw into the framebuffer, then call the game loop
     Adafruit_Init();
+    setFrameBuffer(true);
+    setTextColor(TEXT_COLOR, TEXT_BG_COLOR); // opaque text can use the cached glyph blits
+    gameInit(&game, &boardIO);
     gameLoop();
 }
 
@@ -185,36 +220,56 @@ static char *coordsToString(int i, int j) {
 
 
 // MAIN GAME LOOP STUFF
-static int frameDrop = 0;
-static long dropFrame(long delay) {
-    frameDrop++;
-    return (delay += 888800) < 0 ? dropFrame(delay) : delay;
-}
-
 static unsigned long getCurrentSysTimeMS(void) {
     // slow clock keeps track of real time, used to establish connection and seed random
-    // convert PRCMSlowClkCtrGet ticks to time
-    return (unsigned long) ((unsigned long long) PRCMSlowClkCtrGet() / 32768.0 * 1000.0);
+    // convert PRCMSlowClkCtrGet ticks (32768 Hz) to time
+    return (unsigned long) ((PRCMSlowClkCtrGet() * 1000) >> 15);
 }
 
-static int tickTimer = 0, tickCounter = 0, selectedBaddie = -1;
+static int tickTimer = 0, tickCounter = 0;
 static char state;
-static bool skipFrameDrop;
+#if ENABLE_REPLAY == 1
+// prints the input log as hex, oldest byte first, for the host to play back
+static void dumpReplay(void) {
+    unsigned char chunk[32];
+    int offset = 0, n, i;
+    Report("replay %d bytes\n\r", replaySize());
+    while ((n = replayCopy(chunk, offset, sizeof(chunk))) > 0) {
+        for (i = 0; i < n; i++) {
+            Report("%02x", chunk[i]);
+        }
+        Report("\n\r");
+        offset += n;
+    }
+}
+#endif
+
+#if ENABLE_PROFILER == 1 || ENABLE_REPLAY == 1
+// console keys: see profPoll, plus 'd' to dump the input log
+static void consolePoll(void) {
+    switch (profPoll()) {
+#if ENABLE_REPLAY == 1
+        case 'd':
+            dumpReplay();
+            break;
+#endif
+        default:
+            break;
+    }
+}
+#endif
+
 static void gameLoop(void) {
     // main game loop
-    unsigned long prevTime = getCurrentSysTimeMS();
-    long newDelay = 0;
-    skipFrameDrop = false;
     tickTimer = 0;
     state = TITLE_SCREEN; // initial state
+    InitScheduler();
 
     while (1) {
-        if (skipFrameDrop) {
-            frameDrop = 0;
-            skipFrameDrop = false;
-        }
+        schedBeginFrame(); // sleeps until this frame is due
+        PROF_SCOPE_BEGIN(PROF_FRAME);
 
-        do {
+        while (schedStep()) { // extra steps when catching up on late frames
             switch (state) {
                 case TITLE_SCREEN:
                     titleScreenLogic();
@@ -230,435 +285,280 @@ static void gameLoop(void) {
                     break;
             }
 
-        } while (frameDrop-- > 0); // once a certain number of frames drop, reset frames
-        updateSoundModules();
-
-        // timing handling
-        newDelay = (long)(33.33 - (((long) getCurrentSysTimeMS() - (long) prevTime)) * 26666.67);
-        frameDrop = 0;
-        if (newDelay < 0) { // dropped a frame
-            newDelay = dropFrame(newDelay);
         }
-        MAP_UtilsDelay((unsigned long) newDelay);
-        prevTime = getCurrentSysTimeMS();
+        PROF_SCOPE_BEGIN(PROF_FLUSH);
+        flushFrame(); // send everything drawn this tick in one pass
+        PROF_SCOPE_END(PROF_FLUSH);
+        PROF_SCOPE_BEGIN(PROF_SOUND);
+        updateSoundModules();
+        PROF_SCOPE_END(PROF_SOUND);
+        PROF_SCOPE_END(PROF_FRAME);
+#if ENABLE_SERVER == 1
+        PROF_SCOPE_BEGIN(PROF_NET_RECV);
+        networkReceive(); // every frame, keeps the connection alive on every screen
+        PROF_SCOPE_END(PROF_NET_RECV);
+#endif
+#if ENABLE_PROFILER == 1 || ENABLE_REPLAY == 1
+        consolePoll();
+#endif
     }
 }
 
 // INITIAL STATE STUFF
-const int blockSize = WIDTH / MAP_SIZE;
-
-static struct Pac pac; // structure that keeps track of the pac's loc
-static struct Baddie badGuys[4] = {
-                             { 0, -1, -1, 0, 0, BAD_1_COLOR, "", false },
-                             { 1, -1, -1, 0, 0, BAD_2_COLOR, "", false },
-                             { 2, -1, -1, 0, 0, BAD_3_COLOR, "", false },
-                             { 3, -1, -1, 0, 0, BAD_4_COLOR, "", false }
-                            };
-static int xVel = 0, yVel = 0; // velocities of the pac
-
-static void drawScore(void) {
-    fillRect(12, 4, 17, 8, 0x0000); // clears current written score
-    setCursor(12,4);
-    Outstr(integerToString(pac.score)); // prints score in upper right
+static void presentTiles(void) {
+    PROF_SCOPE_BEGIN(PROF_RENDER);
+    composeTiles(); // send the tiles the sprites moved across
+    PROF_SCOPE_END(PROF_RENDER);
 }
 
 static void startScreenLogic(void) {
-    fillScreen(0x0000); // first clear the screen
-    int i, j, k, initBaddie = 0;
-    for (i = 0; i < 4; i++) { // init all bads to impossible location so program knows they aren't initialized
-        badGuys[i].x = -1;
-        badGuys[i].y = -1;
-    }
-    pellet_counter = 0;
-    // initial stuff
-    // iterate through map, setting info based on values in each entry
-    for (i = 0; i < MAP_SIZE; i++) {
-        for (j = 0; j < MAP_SIZE; j++) {
-            if (map[j][i] == WALL) {
-                // draw wall tile
-                fillRect(i * blockSize, j * blockSize, blockSize, blockSize, WALL_COLOR);
-            } else if (map[j][i] == POINT || map[j][i] == PLACEHOLDER) { // point pac
-                // draw point pellet, reset inactive pellets to active
-                map[j][i] = POINT;
-                pellet_counter++;
-                k =  blockSize / 2; // middle of tile to draw pellet
-                fillRect(i * blockSize + blockSize / 2 - k / 2, j * blockSize + blockSize / 2 - k / 2, k, k, POINT_COLOR);
-            } else if (map[j][i] == SPAWN) { // start loc player
-                // set pac location
-                pac.y = j*4;
-                pac.x = i*4;
-                drawScore();
-            } else if (map[j][i] == ENEMY) { // start loc baddies
-                // init next bad
-                if (initBaddie >= 4) continue; // do not init more than 4 bads
-                badGuys[initBaddie].y = j*4;
-                badGuys[initBaddie].x = i*4;
-                badGuys[initBaddie].velY = 0;
-                badGuys[initBaddie].velX = 0;
-                strcpy(badGuys[initBaddie].dirQueue, ""); // clear dir queue
-                badGuys[initBaddie].ready = false;
-                determineValidMoves(&badGuys[initBaddie]);
-                decideVelocities(&badGuys[initBaddie]); // set random move dir
-                initBaddie++;
-            }
-        }
-    }
+    unsigned long seed = getCurrentSysTimeMS();
+#if ENABLE_REPLAY == 1
+    replayLevel(seed); // the log replays from here
+#endif
+    gameReset(&game, seed); // restore pellets, pac and bads to their spawns
+    // draw the whole maze in one pass, it covers the screen so no clear needed
+    drawMaze();
+    resetSprites();
+    forgetScore(); // score has to be drawn from scratch
+    drawScore(game.pac.score);
     tickTimer = 0;
     tickCounter = 0;
-    selectedBaddie = -1;
-    skipFrameDrop = true;
+#if ENABLE_MQTT == 1
+    memset(sentLoc, 0xFF, sizeof(sentLoc)); // publish every location once
+#endif
+    schedResync(); // drawing the maze took a while, don't catch up on it
     state = GAME_STATE; // switch to main game state, there is a possibility for a title screen
 }
 
 // MAIN GAME STUFF
-static bool yCollision(int x, int y, int yVel) {
-    // Wall check
-    const int blockSize = WIDTH / MAP_SIZE; // set pix size of grid tiles
-    int blockX, blockY;
-    blockX = (x + 2) / blockSize; // the X coor of grid tile that mid pixel of top/bottom edge lies in
-    if (yVel < 0) {
-        blockY = (y + yVel) / blockSize; // Y coor of grid tile that mid pixel of top edge lies
-    } else {
-        blockY = (y + yVel + PAC_SIZE - 1) / blockSize; // Y coor of grid tile that mid pixel of bottom edge lies
-    }
-    return map[blockY][blockX] == WALL; // check map tile that enemy would move into
+// function to scale a signed, filtered accelerometer axis by the velocity factor
+// (max vel essentially)
+static int adjustVel(int vel, const int *velFactor) {
+    return -(vel * (*velFactor) / (255 / 2)); // adjust the velocity accordingly
 }
 
-static bool xCollision(int x, int y, int xVel) {
-    // Wall check
-    const int blockSize = WIDTH / MAP_SIZE; // set pix size of grid tiles
-    int blockX, blockY;
-    blockY = (y+2) / blockSize; // the Y coor of grid tile that mid pixel of left/right edge lies in
-    if (xVel < 0) {
-        blockX = (x + xVel) / blockSize; // X coor of grid tile that mid pixel of left edge lies
-    } else {
-        blockX = (x + xVel + PAC_SIZE - 1) / blockSize; // X coor of grid tile that mid pixel of right edge lies
-    }
-    return map[blockY][blockX] == WALL; // check map tile that enemy would move into
-}
+static const char *queueKeys[NUM_BADDIES] = { "b1_q", "b2_q", "b3_q", "b4_q" };
+static const char *locKeys[NUM_BADDIES] = { "b1_loc", "b2_loc", "b3_loc", "b4_loc" };
 
-bool enemyHit(struct Pac* pac, struct Baddie* bad) {
-    // check if enemy and pac share grid coords
-    return ((int)pac->x/4 == (int)bad->x/4 && (int)pac->y/4 == (int)bad->y/4);
-}
+static JsonParser shadowParser;
+static ShadowState shadow;
 
-void decideVelocities(struct Baddie *bad) {
-    char dirChoice = 4, i;
-    if (bad->dirQueue[0] != '\0') { // dir queue not empty
-        do {
-            if (bad->dirQueue[0] == '\0') {
-                break;
-            }
-            dirChoice = bad->dirQueue[0] - '0';
-            i = 1;
-            while (bad->dirQueue[i - 1] != '\0') {
-                bad->dirQueue[i - 1] = bad->dirQueue[i];
-                i++;
-            }
-            if (bad->dirQueue[0] == '\0') {
-                bad->ready = true; // set enemy ready to recieve next dir
-            }
-        } while (!bad->validMoves[dirChoice]); // find first valid move in queue, set that as dir
-    } else if(bad->id != selectedBaddie) { // queue empty
-        srand((unsigned int) getCurrentSysTimeMS());
-        int sanityCheck = 0; // prevents looping forever in case no valid moves
-        dirChoice = rand() % 4; // choose ran num 0-3 to start in valid moves
-        while (!bad->validMoves[dirChoice] && sanityCheck < 4) {
-            dirChoice++; // iterate through dir till valid found
-            sanityCheck++;
-            if (dirChoice == 4) dirChoice = 0;
+// hands the queues received so far to the baddies that wait for commands,
+// runs from the game step so replays see them on the same tick
+static void applyShadow(Game *game) {
+    int i;
+    for (i = 0; i < NUM_BADDIES; i++) {
+        struct Baddie *bad = &game->bads[i];
+        if (!SHADOW_HAS(&shadow, SHADOW_B1_Q + i) || shadow.badQueue[i][0] == '\0') {
+            continue; // nothing new
+        }
+        if (bad->dirQueue[0] == '\0' && !bad->ready) { // badGuy is ready to recieve new commands
+            memcpy(bad->dirQueue, shadow.badQueue[i], sizeof(bad->dirQueue)); // copy vals to queue
+            bad->dirQueue[sizeof(bad->dirQueue) - 1] = '\0';
+            game->selectedBaddie = i;
+            shadow.badQueue[i][0] = '\0'; // used up
+#if ENABLE_REPLAY == 1
+            replayQueue(game->inputTimer, i, bad->dirQueue);
+#endif
         }
-    }
-    switch (dirChoice) {
-        case 0:
-            bad->velY = -1; // move up
-            break;
-        case 1:
-            bad->velX = -1; // move left
-            break;
-        case 2:
-            bad->velX = 1; // move down
-            break;
-        case 3:
-            bad->velY = 1; // move right
-            break;
     }
 }
 
-static void updateBaddieLoc(struct Baddie* bad) {
-    if(bad->velY != 0) {
-        if (!yCollision(bad->x, bad->y, bad->velY)) { // if there's no collision, move
-            bad->y += bad->velY;
-            bad->x = ((bad->x + 2) / 4) * 4; // fix pac x to left side of grid tile
-        } else {
-            bad->velY = 0;
+// adds the acks for baddies done with their queue, returns a bit per ack
+static unsigned char buildAcks(Game *game) {
+    unsigned char acked = 0;
+    int i;
+    for (i = 0; i < NUM_BADDIES; i++) {
+        if (game->bads[i].ready && buildRequest((char *) queueKeys[i], "ready")) {
+            acked |= 1 << i;
         }
     }
-    if(bad->velX != 0) {
-        if (!xCollision(bad->x, bad->y, bad->velX)) {
-            bad->x += bad->velX;
-            bad->y = ((bad->y + 2) / 4) * 4; // fix pac y to top side of grid tile
-        } else {
-            bad->velX = 0;
+    return acked;
+}
+
+// the acks went out, the baddies can take new commands again. A queue
+// still in the shadow was read before the ack and is the one just run
+static void clearAcks(Game *game, unsigned char acked) {
+    int i;
+    for (i = 0; i < NUM_BADDIES; i++) {
+        if ((acked >> i) & 1) {
+            game->bads[i].ready = false;
+            shadow.badQueue[i][0] = '\0';
         }
     }
-    determineValidMoves(bad); // update valid moves based on new position
 }
 
-// function that updates the Pac's location accordingly and keeps it within bounds
-static void updatePacLoc(struct Pac *pac, int *xVel, int *yVel) {
-
-    bool yGreater = abs(*yVel) > abs(*xVel); // determine greater vel
-    if(*yVel > MAX_VEL) *yVel = MAX_VEL; // bind vel to +-1
-    if(*yVel < -MAX_VEL) *yVel = -MAX_VEL;
-    if(*xVel > MAX_VEL) *xVel = MAX_VEL;
-    if(*xVel < -MAX_VEL) *xVel = -MAX_VEL;
-    if (*yVel == 0 && *xVel == 0) return; // no movement
+#if ENABLE_MQTT == 1
+// update or get/accepted document, the new queues wait in the shadow
+static void readShadowMessage(const char *topic, int topicLength, const char *payload, int length, void *arg) {
+    jsonInit(&shadowParser, "reported", shadowStore, &shadow);
+    jsonFeed(&shadowParser, payload, length);
+}
 
-    if(yCollision(pac->x, pac->y, *yVel) && xCollision(pac->x, pac->y, *xVel)) { // there's a collision in both directions
-        *xVel = 0;
-        *yVel = 0;
+// publishes the locations that moved and the acks, nothing counts as sent
+// unless the publish went out. Acks go out on the tick a baddie is done,
+// moves wait for SYNC_TICKS since the last publish
+static void publishState(Game *game) {
+    ShadowLoc now[NUM_BADDIES + 1];
+    unsigned char moved = 0, acked;
+    bool waiting = false;
+    int i;
+
+    for (i = 0; i < NUM_BADDIES; i++) {
+        waiting |= game->bads[i].ready;
+    }
+    if (tickCounter < SYNC_TICKS && !waiting) {
         return;
-        // don't move
     }
-    if(yGreater) { // y is greater
-        if (!yCollision(pac->x, pac->y, *yVel)) { // no collision moving in y
-            (*pac).y += *yVel;
-            (*pac).x = (((*pac).x + 2) / 4) * 4;
-            return;
-            // move y, position x on rails
-        }
-        yGreater = false;
+    now[0].x = game->pac.x;
+    now[0].y = game->pac.y;
+    for (i = 0; i < NUM_BADDIES; i++) {
+        now[i + 1].x = game->bads[i].x;
+        now[i + 1].y = game->bads[i].y;
     }
-    if(!yGreater) { // either x is greater or y collided
-        if (!xCollision(pac->x, pac->y, *xVel)) { // no collision moving in y
-            (*pac).x += *xVel;
-            (*pac).y = (((*pac).y + 2) / 4) * 4;
-            return;
-            // move x, position y on rails
+    for (i = 0; i <= NUM_BADDIES; i++) {
+        if ((now[i].x != sentLoc[i].x || now[i].y != sentLoc[i].y) &&
+            buildRequest(i == 0 ? "pac_loc" : (char *) locKeys[i - 1], coordsToString(now[i].x, now[i].y))) {
+            moved |= 1 << i;
         }
-        if (!yCollision(pac->x, pac->y, *yVel)) { // no collision moving in y
-            (*pac).y += *yVel;
-            (*pac).x = (((*pac).x + 2) / 4) * 4;
-            return;
-            // move y, position x on rails
+    }
+    acked = buildAcks(game);
+    if (publishRequest()) {
+        for (i = 0; i <= NUM_BADDIES; i++) {
+            if ((moved >> i) & 1) {
+                sentLoc[i] = now[i];
+            }
         }
+        clearAcks(game, acked);
+        tickCounter = 0;
     }
 }
+#else
+static ShadowState staging;      // GET being parsed, only a 200 makes it the shadow
+static unsigned char postAcks;   // acks in the POST waiting for its response
+static unsigned char getAcks;    // acks in the POST ahead of the GET, which may not see them yet
+
+// GET body so far, the parser carries on where it stopped
+static void readShadow(const char *body, int length, void *arg) {
+    jsonFeed(&shadowParser, body, length);
+}
 
-// function to return the adjusted two's complement representation of what was returned
-// by the accelerometer.  Also scale it accordingly to the velocity factor (max vel essentially)
-static int adjustVel(int vel, const int *velFactor) {
-    if (vel > 255 / 2) { // essentially check if it wrapped around to 255 (negative)
-        vel -= 255;
+static void shadowDone(int status, void *arg) {
+    int i;
+    if (status == 200) {
+        for (i = 0; i < NUM_BADDIES; i++) {
+            if ((getAcks >> i) & 1) { // the queue from before the ack, already run
+                staging.present &= ~(1 << (SHADOW_B1_Q + i));
+                staging.badQueue[i][0] = '\0';
+            }
+        }
+        shadow = staging;
     }
-    return -(vel * (*velFactor) / (255 / 2)); // adjust the velocity accordingly
+    getAcks = 0;
 }
 
-static void parseGETRequest(char *request) {
-    parseJSON(request);
-    char *val;
-    if (badGuys[0].dirQueue[0] == '\0' && !badGuys[0].ready) { // badGuy is ready to recieve new commands
-        val = getValue("b1_q"); // retireve shadow update
-        if (strcmp(val, "ready") != 0) { // there was something to recieve
-            strcpy(badGuys[0].dirQueue, val); // copy vals to queue
-            selectedBaddie = 0;
-        }
+static void postDone(int status, void *arg) {
+    if (status == 200) {
+        clearAcks(&game, postAcks);
     }
-    if (badGuys[1].dirQueue[0] == '\0' && !badGuys[1].ready) {
-        val = getValue("b2_q");
-        if (strcmp(val, "ready") != 0) {
-            strcpy(badGuys[1].dirQueue, val);
-            selectedBaddie = 1;
-        }
+    postAcks = 0;
+}
+
+// sends our state and asks for the shadow every SYNC_TICKS
+static void postShadow(Game *game) {
+    int i;
+    if (tickCounter < SYNC_TICKS || httpPending() != 0) { //only continue once the last pair was answered
+        return;
     }
-    if (badGuys[2].dirQueue[0] == '\0' && !badGuys[2].ready) {
-        val = getValue("b3_q");
-        if (strcmp(val, "ready") != 0) {
-            strcpy(badGuys[2].dirQueue, val);
-            selectedBaddie = 2;
-        }
+    tickCounter = 0;
+    buildRequest("pac_loc", coordsToString(game->pac.x, game->pac.y));
+    for (i = 0; i < NUM_BADDIES; i++) {
+        buildRequest((char *) locKeys[i], coordsToString(game->bads[i].x, game->bads[i].y));
     }
-    if (badGuys[3].dirQueue[0] == '\0' && !badGuys[3].ready) {
-        val = getValue("b4_q");
-        if (strcmp(val, "ready") != 0) {
-            strcpy(badGuys[3].dirQueue, val);
-            selectedBaddie = 3;
+    postAcks = buildAcks(game);
+    if (sendRequest(NULL, postDone, NULL)) { // POST and GET back to back
+        shadowClear(&staging);
+        jsonInit(&shadowParser, "reported", shadowStore, &staging);
+        getAcks = postAcks;
+        if (!receiveString(readShadow, shadowDone, NULL)) {
+            getAcks = 0;
         }
+    } else {
+        postAcks = 0; // the baddies stay ready and ack next time
     }
 }
+#endif
 
-static unsigned char ACCDEV = 0x18, xREG = 0x3, yREG = 0x5; // device and registers for accel
 static const int velFactor = 15; // max velocity;
-static bool pollReceiveMode = false, requestFlag = false;
-static char pointX[12], pointY[12], pointIndex = 0;
 
-// this is called every 33 ms, barring the that frames are skipped!
-static void mainGameLogic(void) {
-    if (tickTimer >= 2) { // get new data 10 times a second
-        static char *receive;
-        unsigned char dataBuf; // buffer that holds what was returned from a register
-        tickTimer = 0;
-        I2C_IF_Write(ACCDEV, &xREG, 1, 0); // get the x and y accelerometer information using i2c
-        I2C_IF_Read(ACCDEV, &dataBuf, 1);  // and adjust the velocities accordingly.
-        yVel = adjustVel((int) dataBuf, &velFactor);
-        I2C_IF_Write(ACCDEV, &yREG, 1, 0);  // the x and y values from the registers are flipped
-        I2C_IF_Read(ACCDEV, &dataBuf, 1);   // since we found that they changed the wrong axis
-        xVel = adjustVel((int) dataBuf, &velFactor);
-
-        if (pollReceiveMode) { // retireve shadow update
-            receive = networkReceive();
-            if (strlen(receive) > 4) {
-                if (!requestFlag) {
-                    parseGETRequest(receive);
-                }
-                pollReceiveMode = false;
-            }
-        }
+static void readAccel(Game *game, int *xVel, int *yVel) {
+    int tiltX, tiltY;
+    PROF_SCOPE_BEGIN(PROF_INPUT);
+    accelTilt(&tiltX, &tiltY); // averaged since the last read, no I2C wait here
+    *yVel = adjustVel(tiltX, &velFactor); // the x and y values from the registers are flipped
+    *xVel = adjustVel(tiltY, &velFactor); // since we found that they changed the wrong axis
+#if ENABLE_REPLAY == 1
+    replayAccel(*xVel, *yVel);
+#endif
+    PROF_SCOPE_END(PROF_INPUT);
+}
 
-        if (tickCounter > 10) { // alternate between POST and GET every 2 seconds
-            tickCounter = 0;
+static void syncShadow(Game *game) {
+    applyShadow(game); // every tick, responses and messages arrive in networkReceive
+    if (tickCounter < SYNC_TICKS) {
+        tickCounter++;
+    }
 #if ENABLE_SERVER == 1
-            if (!pollReceiveMode) { //only continue if received the response to the old request
-                if (requestFlag = !requestFlag) { // if now true
-                    buildRequest("pac_loc", coordsToString(pac.x, pac.y));
-                    buildRequest("b1_loc", coordsToString(badGuys[0].x, badGuys[0].y));
-                    buildRequest("b2_loc", coordsToString(badGuys[1].x, badGuys[1].y));
-                    buildRequest("b3_loc", coordsToString(badGuys[2].x, badGuys[2].y));
-                    buildRequest("b4_loc", coordsToString(badGuys[3].x, badGuys[3].y));
-                    if (badGuys[0].ready) {
-                        badGuys[0].ready = false;
-                        buildRequest("b1_q", "ready");
-                    }
-                    if (badGuys[1].ready) {
-                        badGuys[1].ready = false;
-                        buildRequest("b2_q", "ready");
-                    }
-                    if (badGuys[2].ready) {
-                        badGuys[2].ready = false;
-                        buildRequest("b3_q", "ready");
-                    }
-                    if (badGuys[3].ready) {
-                        badGuys[3].ready = false;
-                        buildRequest("b4_q", "ready");
-                    }
-                    receive = sendRequest();
-                } else { // if now false
-                    receive = receiveString();
-                }
-                if (strlen(receive) <= 4) {
-                    pollReceiveMode = true;
-                } else {
-                    if (!requestFlag) {
-                        parseGETRequest(receive);
-                    }
-                    pollReceiveMode = false;
-                }
-            }
+    PROF_SCOPE_BEGIN(PROF_NET_SEND);
+#if ENABLE_MQTT == 1
+    publishState(game);
+#else
+    postShadow(game);
 #endif
-        } else {
-            tickCounter++;
-        }
-    } else {
-        tickTimer++;
-    }
-    if (xVel != 0 || yVel != 0) {
-        fillRect(pac.x, pac.y, PAC_SIZE, PAC_SIZE, 0x0000);  // erase the old location of the pac
-    }
-    updatePacLoc(&pac, &xVel, &yVel); // update the pac's location
-    fillRect(pac.x, pac.y, PAC_SIZE, PAC_SIZE, PLAYER_COLOR); // draw new pac on the screen
-    int bad;
-    pointIndex = 0;
-    for (bad = 0; bad < 4; bad++) { // iterate through bads
-        // get grid coord of cur bad
-        int badGridX = badGuys[bad].x/4;
-        int badGridY = badGuys[bad].y/4;
-        fillRect(badGuys[bad].x, badGuys[bad].y, PAC_SIZE, PAC_SIZE, 0x0000); // clear bad from screen
-        // Check the grid locs around bad and set them to fill them with point pellet to prevent enemy from erasing them
-        if (map[badGridY][badGridX] == POINT) {
-            pointX[pointIndex] = badGridX;
-            pointY[pointIndex++] = badGridY;
-        }
-        // check position below
-        if ((badGuys[bad].y + (blockSize / 2)) / 4 != badGridY && map[badGridY + 1][badGridX] == POINT) {
-            pointX[pointIndex] = badGridX;
-            pointY[pointIndex++] = badGridY + 1;
-        }
-        // check position to right
-        if ((badGuys[bad].x + (blockSize / 2)) / 4 != badGridX && map[badGridY][badGridX + 1] == POINT) {
-            pointX[pointIndex] = badGridX + 1;
-            pointY[pointIndex++] = badGridY;
-        }
-        updateBaddieLoc(&badGuys[bad]); // try to move bad
-        // if velocities zero (collision)
-        if (badGuys[bad].velX == 0 && badGuys[bad].velY == 0) {
-            decideVelocities(&badGuys[bad]); // next move in queue or random valid
-        }
-        fillRect(badGuys[bad].x, badGuys[bad].y, PAC_SIZE, PAC_SIZE, badGuys[bad].color); // redraw enemy in ne loc
-        if(enemyHit(&pac, &badGuys[bad])) { // check if enemy collision with pac
-            tickTimer = 0;
-            state = GOVER_STATE; // gg u loose
-            return;
-        }
-    }
-    int i, k = blockSize / 2;
-    // fill all point tiles that were erased by bads
-    for (i = 0; i < pointIndex; i++) {
-        for (bad = 0; bad < 4; bad++) {
-            if (pointX[i] == badGuys[bad].x/4 && pointY[i] == badGuys[bad].y/4) {
-                break;
-            }
-            if (bad == 3) {
-                fillRect(pointX[i] * blockSize + blockSize / 2 - k / 2, pointY[i] * blockSize + blockSize / 2 - k / 2, k, k, POINT_COLOR);
-            }
-        }
-    }
+    PROF_SCOPE_END(PROF_NET_SEND);
+#endif
+}
 
-    if(map[pac.y/blockSize][pac.x/blockSize] == POINT) {
-        // update score if pac has entered a point tile
-        map[pac.y/blockSize][pac.x/blockSize] = PLACEHOLDER;
-        pac.score++;
-        pellet_counter--;
-        if (pellet_counter == 0) {
-            tickTimer = 0;
-            state = GOVER_STATE;
-        }
-        drawScore();
-        playSound(BEEP);
+// this is called every 33 ms, barring the that frames are skipped!
+static void mainGameLogic(void) {
+    GameResult result;
+    PROF_SCOPE_BEGIN(PROF_LOGIC);
+    result = gameStep(&game);
+    PROF_SCOPE_END(PROF_LOGIC);
+    if (result != GAME_RUNNING) { // caught or cleared the screen
+        tickTimer = 0;
+        state = GOVER_STATE;
     }
 }
 
 // GAME OVER STUFF
 static void gameOverLogic(void) {
-    if (tickTimer == 0 && pellet_counter > 0) {
+    if (tickTimer == 0 && game.pellets > 0) {
         // clear screen
-        fillRect(0, 0, WIDTH, HEIGHT, 0x0000);
+        fillRectFast(0, 0, WIDTH, HEIGHT, 0x0000);
         setCursor(WIDTH / 2 - 32, HEIGHT / 2 - 16);
         Outstr("GAME OVER");
         setCursor(WIDTH / 2 - 32, HEIGHT / 2 - 8);
         Outstr("Score: ");
         // draw final score
-        Outstr(integerToString(pac.score));
+        Outstr(integerToString(game.pac.score));
         playSound(DEATH);
-    } else if (tickTimer == 0 && pellet_counter == 0) {
+    } else if (tickTimer == 0 && game.pellets == 0) {
         // clear screen
-        fillRect(0, 0, WIDTH, HEIGHT, 0x0000);
+        fillRectFast(0, 0, WIDTH, HEIGHT, 0x0000);
         setCursor(WIDTH / 2 - 32, HEIGHT / 2 - 16);
         Outstr("SCREEN CLEARED");
         setCursor(WIDTH / 2 - 32, HEIGHT / 2 - 8);
         Outstr("Score: ");
         // draw final score
-        Outstr(integerToString(pac.score));
+        Outstr(integerToString(game.pac.score));
         playSound(DEATH);
     }
-    if (tickTimer > 30 * 5 && pellet_counter > 0) { // wait five seconds (30 frames * 5)
-        pollReceiveMode = false;
-        requestFlag = false;
+    if (tickTimer > 30 * 5 && game.pellets > 0) { // wait five seconds (30 frames * 5)
         tickTimer = 0;
         state = TITLE_SCREEN;
-    } else if (tickTimer > 30 * 5 && pellet_counter == 0) { // wait five seconds (30 frames * 5)
-        pollReceiveMode = false;
-        requestFlag = false;
+    } else if (tickTimer > 30 * 5 && game.pellets == 0) { // wait five seconds (30 frames * 5)
         tickTimer = 0;
         state = START_STATE;
     } else {
@@ -668,7 +568,7 @@ static void gameOverLogic(void) {
 
 static void titleScreenLogic() {
     if (tickTimer == 0) {
-        fillRect(0, 0, WIDTH, HEIGHT, 0x0000);
+        fillRectFast(0, 0, WIDTH, HEIGHT, 0x0000);
         setCursor(WIDTH / 2 - 32, HEIGHT / 2 - 16);
         Outstr("PAC MAN");
     }
@@ -677,16 +577,5 @@ static void titleScreenLogic() {
     } else {
         tickTimer++;
     }
-    pac.score = 0;
-}
-
-static void determineValidMoves(struct Baddie* bad) {
-    // U
-    bad->validMoves[0] = !yCollision(bad->x, bad->y, -1);
-    // L
-    bad->validMoves[1] = !xCollision(bad->x, bad->y, -1);
-    // R
-    bad->validMoves[2] = !xCollision(bad->x, bad->y, 1);
-    // D
-    bad->validMoves[3] = !yCollision(bad->x, bad->y, 1);
+    game.pac.score = 0;
 }
@@ -0,0 +1,82 @@
+/*
+ * map.c
+ *
+ *  Level layout as bitboards, bit x of a row is column x
+ */
+
+#include <string.h>
+
+#include "map.h"
+
+// '#' wall, 'o' pellet, 'P' pac spawn, 'E' baddie spawn
+const unsigned long wallBoard[MAP_SIZE] = {
+    0xFFFFFFFF, // ################################
+    0xA0800105, // #.#.....#oooooooooooooo#.....#.#
+    0xA0B7ED05, // #.#.....#o##o######o##o#.....#.#
+    0xA0B7ED05, // #.#.....#o##o######o##o#.....#.#
+    0xA0B18D05, // #.#.....#o##ooo##ooo##o#.....#.#
+    0xBFBDBDFD, // #.#######o####o##o####o#######.#
+    0xA03DBC05, // #.#ooooooo####o##o####ooooooo#.#
+    0xAEF00FDD, // #.###o######oooooooo####o###o#.#
+    0xAEF7EFDD, // #.###o######o######o####o###o#.#
+    0xA037EC05, // #.#ooooooo##o######o##ooooooo#.#
+    0xAFB18DF5, // #.#o#####o##ooo##ooo##o#####o#.#
+    0xAFBDBDF5, // #.#o#####o####o##o####o#####o#.#
+    0xA1BDBD85, // #.#oooo##o####o##o####o##oooo#.#
+    0xBD8001BD, // #.####o##oooooEEEEooooo##o####.#
+    0xBDEFF7BD, // #.####o####o########o####o####.#
+    0xADEFF7B5, // #.#o##o####o########o####o##o#.#
+    0xAC0FF035, // #.#o##oooooo########oooooo##o#.#
+    0xADEFF7B5, // #.#o##o####o########o####o##o#.#
+    0xA1EFF785, // #.#oooo####o########o####oooo#.#
+    0xAD8001B5, // #.#o##o##oooooooooooooo##o##o#.#
+    0xADBFFDB5, // #.#o##o##o############o##o##o#.#
+    0xADBFFDB5, // #.#o##o##o############o##o##o#.#
+    0xAD8181B5, // #.#o##o##oooooo##oooooo##o##o#.#
+    0xBDFDBFBD, // #.####o#######o##o#######o####.#
+    0xBDFDBFBD, // #.####o#######o##o#######o####.#
+    0xA0000005, // #.#ooooooooooooPooooooooooooo#.#
+    0xADFFFFB5, // #.#o##o##################o##o#.#
+    0xADFFFFB5, // #.#o##o##################o##o#.#
+    0xADFFFFB5, // #.#o##o##################o##o#.#
+    0xADFFFFB5, // #.#o##o##################o##o#.#
+    0xA1FFFF85, // #.#oooo##################oooo#.#
+    0xFFFFFFFF, // ################################
+};
+
+static const unsigned long pelletStart[MAP_SIZE] = {
+    0x00000000, 0x007FFE00, 0x00481200, 0x00481200,
+    0x004E7200, 0x00424200, 0x1FC243F8, 0x110FF020,
+    0x11081020, 0x1FC813F8, 0x104E7208, 0x10424208,
+    0x1E424278, 0x027C3E40, 0x02100840, 0x12100848,
+    0x13F00FC8, 0x12100848, 0x1E100878, 0x127FFE48,
+    0x12400248, 0x12400248, 0x127E7E48, 0x02024040,
+    0x02024040, 0x1FFF7FF8, 0x12000048, 0x12000048,
+    0x12000048, 0x12000048, 0x1E000078, 0x00000000
+};
+
+unsigned long pelletBoard[MAP_SIZE];
+
+const MapPos pacSpawn = { 15, 25 };
+const MapPos enemySpawns[NUM_ENEMY_SPAWNS] = {
+    { 14, 13 }, { 15, 13 }, { 16, 13 }, { 17, 13 }
+};
+
+void resetPellets(void) {
+    memcpy(pelletBoard, pelletStart, sizeof(pelletBoard));
+}
+
+static int popcount(unsigned long v) {
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    v = (v + (v >> 4)) & 0x0F0F0F0F;
+    return ((v * 0x01010101) >> 24) & 0xFF;
+}
+
+int countPellets(void) {
+    int i, count = 0;
+    for (i = 0; i < MAP_SIZE; i++) {
+        count += popcount(pelletBoard[i]);
+    }
+    return count;
+}
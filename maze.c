@@ -0,0 +1,118 @@
+/*
+ * maze.c
+ *
+ *  Open direction masks and the junction graph of the maze
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+
+#include "map.h"
+#include "maze.h"
+
+const signed char dirX[4] = { 0, -1, 1, 0 }; // U L R D
+const signed char dirY[4] = { -1, 0, 0, 1 };
+
+// open directions of every tile, two tiles per byte, low nibble is the even column
+static unsigned char openMask[MAP_SIZE][MAP_SIZE / 2];
+// one bit per junction tile for every row
+static unsigned long junctionBoard[MAP_SIZE];
+
+static Junction junctions[MAX_JUNCTIONS];
+static int numJunctions = 0;
+
+unsigned char tileMask(int tx, int ty) {
+    return (openMask[ty][tx >> 1] >> ((tx & 1) * 4)) & 0xF;
+}
+
+// entities never overlap a wall, so a probe that lands in a tile the entity
+// already overlaps (off the grid lines, or a zero velocity) is always open
+bool yCollision(int x, int y, int yVel) {
+    if (yVel == 0 || (y & (TILE_PIXELS - 1))) return false;
+    return !(tileMask((x + 2) / TILE_PIXELS, y / TILE_PIXELS) & (yVel < 0 ? OPEN_UP : OPEN_DOWN));
+}
+
+bool xCollision(int x, int y, int xVel) {
+    if (xVel == 0 || (x & (TILE_PIXELS - 1))) return false;
+    return !(tileMask(x / TILE_PIXELS, (y + 2) / TILE_PIXELS) & (xVel < 0 ? OPEN_LEFT : OPEN_RIGHT));
+}
+
+bool isJunction(int tx, int ty) {
+    return (junctionBoard[ty] >> tx) & 1;
+}
+
+int junctionCount(void) {
+    return numJunctions;
+}
+
+const Junction *getJunction(unsigned char index) {
+    return &junctions[index];
+}
+
+static bool isOpen(int tx, int ty) {
+    return tx >= 0 && ty >= 0 && tx < MAP_SIZE && ty < MAP_SIZE && !IS_WALL(tx, ty);
+}
+
+static unsigned char junctionAt(int tx, int ty) {
+    int i;
+    for (i = 0; i < numJunctions; i++) {
+        if (junctions[i].x == tx && junctions[i].y == ty) return i;
+    }
+    return NO_JUNCTION;
+}
+
+// tiles between junctions are straight, so just keep going. A corridor
+// that hits a wall or never reaches a junction is no corridor at all
+unsigned char walkCorridor(int tx, int ty, int dir, unsigned char *length) {
+    int steps;
+    *length = 0;
+    for (steps = 0; steps < MAP_SIZE * MAP_SIZE; steps++) {
+        if (!(tileMask(tx, ty) & (1 << dir))) break; // also keeps the walk on the map
+        tx += dirX[dir];
+        ty += dirY[dir];
+        if (isJunction(tx, ty)) {
+            *length = steps + 1;
+            return junctionAt(tx, ty);
+        }
+    }
+    return NO_JUNCTION;
+}
+
+void buildMaze(void) {
+    int tx, ty, dir;
+    unsigned char open;
+    Junction *j;
+
+    numJunctions = 0;
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        junctionBoard[ty] = 0;
+        for (tx = 0; tx < MAP_SIZE; tx++) {
+            open = 0;
+            if (isOpen(tx, ty - 1)) open |= OPEN_UP;
+            if (isOpen(tx - 1, ty)) open |= OPEN_LEFT;
+            if (isOpen(tx + 1, ty)) open |= OPEN_RIGHT;
+            if (isOpen(tx, ty + 1)) open |= OPEN_DOWN;
+            if (tx & 1) {
+                openMask[ty][tx >> 1] |= open << 4;
+            } else {
+                openMask[ty][tx >> 1] = open;
+            }
+            if (!IS_WALL(tx, ty) && open != (OPEN_UP | OPEN_DOWN) && open != (OPEN_LEFT | OPEN_RIGHT)) {
+                // a dropped junction would leave corridors running past it
+                assert(numJunctions < MAX_JUNCTIONS);
+                if (numJunctions == MAX_JUNCTIONS) continue;
+                junctionBoard[ty] |= 1UL << tx;
+                junctions[numJunctions].x = tx;
+                junctions[numJunctions].y = ty;
+                numJunctions++;
+            }
+        }
+    }
+
+    // every junction is known now, link them up
+    for (j = junctions; j < junctions + numJunctions; j++) {
+        for (dir = 0; dir < 4; dir++) {
+            j->next[dir] = walkCorridor(j->x, j->y, dir, &j->length[dir]);
+        }
+    }
+}
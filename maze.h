@@ -0,0 +1,51 @@
+/*
+ * maze.h
+ *
+ *  Maze topology built from the wall bitboard at init: open directions per
+ *  tile and a graph of junctions joined by straight corridors. Baddies
+ *  count pixels down a corridor and only look at the maze on junctions.
+ */
+
+#ifndef MAZE_H_
+#define MAZE_H_
+
+#include <stdbool.h>
+
+#include "map.h"
+
+// open direction bits, in the same order as validMoves
+#define OPEN_UP    0x1
+#define OPEN_LEFT  0x2
+#define OPEN_RIGHT 0x4
+#define OPEN_DOWN  0x8
+
+#define TILE_PIXELS 4 // pixel size of a map tile
+
+#define MAX_JUNCTIONS 128 // the maze has 112
+#define NO_JUNCTION   0xFF
+
+// a tile that is not a straight corridor: a crossing, a turn or a dead end
+typedef struct Junction {
+    unsigned char x, y;      // tile
+    unsigned char next[4];   // junction reached going U L R D, NO_JUNCTION for a wall
+    unsigned char length[4]; // corridor length in tiles
+} Junction;
+
+extern const signed char dirX[4]; // U L R D
+extern const signed char dirY[4];
+
+void buildMaze(void); // walls never change, so this only has to run once
+
+unsigned char tileMask(int tx, int ty);
+// true when a tile sized entity at pixel (x, y) would hit a wall moving by
+// one pixel, from the mid pixel of the edge it moves towards
+bool yCollision(int x, int y, int yVel);
+bool xCollision(int x, int y, int xVel);
+bool isJunction(int tx, int ty);
+
+int junctionCount(void);
+const Junction *getJunction(unsigned char index);
+// follows the corridor from a tile until the next junction
+unsigned char walkCorridor(int tx, int ty, int dir, unsigned char *length);
+
+#endif /* MAZE_H_ */
@@ -0,0 +1,242 @@
+/*
+ * mqtt.c
+ *
+ *  MQTT 3.1.1 packet framing over a non-blocking socket
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "simplelink.h"
+
+#include "mqtt.h"
+
+// control packet types, upper nibble of the first byte
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_SUBSCRIBE   0x82 // reserved flags are 0010
+#define MQTT_PINGREQ     0xC0
+
+#define MQTT_HEADER_MAX  5   // type and up to four length bytes
+#define MQTT_HEAD_SIZE   128 // variable header of a sent packet, the topic is most of it
+
+static int mqttSocket = -1;
+static MqttCallback callback;
+static void *callbackArg;
+static bool connected = false;
+static unsigned short packetId = 0;
+static int idlePolls = 0;
+static int connectPolls = 0; // polls spent waiting for the CONNACK
+
+static unsigned char buffer[MQTT_BUFFER_SIZE];
+static int length = 0;
+static long skip = 0; // bytes left of a packet too big for the buffer
+
+// forgets the socket, the owner closes it and connects again
+static void drop(void) {
+    connected = false;
+    mqttSocket = -1;
+}
+
+// writes the remaining length, returns the bytes used
+static int putLength(unsigned char *out, int value) {
+    int n = 0;
+    do {
+        out[n] = value & 0x7F;
+        value >>= 7;
+        if (value > 0) {
+            out[n] |= 0x80;
+        }
+        n++;
+    } while (value > 0);
+    return n;
+}
+
+static int putString(unsigned char *out, const char *text, int textLength) {
+    out[0] = textLength >> 8;
+    out[1] = textLength & 0xFF;
+    memcpy(&out[2], text, textLength);
+    return textLength + 2;
+}
+
+// sends the fixed header and then the body in place
+static bool sendPacket(unsigned char type, const unsigned char *head, int headLength,
+                       const char *body, int bodyLength) {
+    unsigned char fixed[MQTT_HEADER_MAX];
+    int n;
+    fixed[0] = type;
+    n = 1 + putLength(&fixed[1], headLength + bodyLength);
+    if (sl_Send(mqttSocket, fixed, n, 0) < 0 ||
+        (headLength > 0 && sl_Send(mqttSocket, head, headLength, 0) < 0) ||
+        (bodyLength > 0 && sl_Send(mqttSocket, body, bodyLength, 0) < 0)) {
+        drop();
+        return false;
+    }
+    idlePolls = 0;
+    return true;
+}
+
+bool mqttConnect(int sock, const char *clientId, MqttCallback onMessage, void *arg) {
+    unsigned char head[12];
+    int idLength = strlen(clientId);
+
+    mqttSocket = sock;
+    callback = onMessage;
+    callbackArg = arg;
+    connected = false;
+    connectPolls = 0;
+    length = 0;
+    skip = 0;
+
+    putString(head, "MQTT", 4);
+    head[6] = 4;    // protocol level 3.1.1
+    head[7] = 0x02; // clean session
+    head[8] = MQTT_KEEPALIVE >> 8;
+    head[9] = MQTT_KEEPALIVE & 0xFF;
+    head[10] = idLength >> 8; // the payload is the length prefixed client id
+    head[11] = idLength & 0xFF;
+    return sendPacket(MQTT_CONNECT, head, sizeof(head), clientId, idLength);
+}
+
+bool mqttSubscribe(const char *topic) {
+    unsigned char head[MQTT_HEAD_SIZE];
+    int topicLength = strlen(topic), n;
+    if (topicLength + 5 > (int) sizeof(head)) {
+        return false;
+    }
+    packetId++;
+    head[0] = packetId >> 8;
+    head[1] = packetId & 0xFF;
+    n = 2 + putString(&head[2], topic, topicLength);
+    head[n++] = 0; // QoS 0
+    return sendPacket(MQTT_SUBSCRIBE, head, n, NULL, 0);
+}
+
+bool mqttPublish(const char *topic, const char *payload, int payloadLength) {
+    unsigned char head[MQTT_HEAD_SIZE];
+    int topicLength = strlen(topic);
+    if (topicLength + 2 > (int) sizeof(head)) {
+        return false;
+    }
+    return sendPacket(MQTT_PUBLISH, head, putString(head, topic, topicLength), payload, payloadLength);
+}
+
+bool mqttConnected(void) {
+    return connected;
+}
+
+bool mqttAlive(void) {
+    return mqttSocket >= 0;
+}
+
+// remaining length at buffer[1], returns the header size or 0 while incomplete
+static int getLength(long *value) {
+    int i;
+    *value = 0;
+    for (i = 1; i < MQTT_HEADER_MAX && i < length; i++) {
+        *value |= (long) (buffer[i] & 0x7F) << (7 * (i - 1));
+        if ((buffer[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// false on a protocol error, the connection has to be dropped then
+static bool handlePacket(const unsigned char *packet, int header, int size) {
+    const unsigned char *body = &packet[header];
+    unsigned char ack[2];
+    int topicLength, offset;
+
+    switch (packet[0] & 0xF0) {
+        case MQTT_CONNACK:
+            connected = size >= 2 && body[1] == 0; // return code 0 is accepted
+            return connected;
+        case MQTT_PUBLISH:
+            if (size < 2) {
+                return false;
+            }
+            topicLength = (body[0] << 8) | body[1];
+            offset = 2 + topicLength;
+            switch (packet[0] & 0x06) {
+                case 0x00: // QoS 0, what was subscribed for
+                    break;
+                case 0x02: // QoS 1 carries a packet id to acknowledge
+                    if (offset + 2 > size) {
+                        return false;
+                    }
+                    ack[0] = body[offset];
+                    ack[1] = body[offset + 1];
+                    offset += 2;
+                    sendPacket(MQTT_PUBACK, ack, 2, NULL, 0);
+                    break;
+                default: // QoS 2 was never granted
+                    return false;
+            }
+            if (offset > size) {
+                return false;
+            }
+            if (callback) {
+                callback((const char *) &body[2], topicLength,
+                         (const char *) &body[offset], size - offset, callbackArg);
+            }
+            return true;
+        default: // SUBACK, PINGRESP
+            return true;
+    }
+}
+
+void mqttPoll(void) {
+    long size;
+    int received, header, used;
+
+    if (mqttSocket < 0) {
+        return;
+    }
+    if (!connected && ++connectPolls > MQTT_CONNECT_POLLS) { // the broker never answered
+        drop();
+        return;
+    }
+    if (++idlePolls >= MQTT_PING_POLLS) {
+        sendPacket(MQTT_PINGREQ, NULL, 0, NULL, 0);
+    }
+
+    received = sl_Recv(mqttSocket, &buffer[length], MQTT_BUFFER_SIZE - length, SL_MSG_DONTWAIT);
+    if (received == SL_EAGAIN) {
+        return;
+    } else if (received <= 0) { // error or closed by the broker
+        drop();
+        return;
+    }
+    length += received;
+
+    while (length > 0) {
+        if (skip > 0) { // tail of an oversized packet
+            used = skip < length ? skip : length;
+            skip -= used;
+        } else {
+            if ((header = getLength(&size)) == 0) {
+                if (length >= MQTT_HEADER_MAX) { // malformed length
+                    drop();
+                }
+                return;
+            }
+            if (header + size > MQTT_BUFFER_SIZE) {
+                skip = header + size;
+                continue;
+            }
+            if (length < header + size) {
+                return;
+            }
+            if (!handlePacket(buffer, header, size)) {
+                drop();
+                return;
+            }
+            used = header + size;
+        }
+        memmove(buffer, &buffer[used], length - used);
+        length -= used;
+    }
+}
@@ -0,0 +1,41 @@
+/*
+ * mqtt.h
+ *
+ *  Minimal MQTT 3.1.1 client on the open TLS socket. QoS 0 publishes and
+ *  subscriptions only, which is all the shadow topics need. Incoming
+ *  packets are framed from a non-blocking receive buffer and PUBLISH
+ *  payloads are handed to the message callback in place.
+ */
+
+#ifndef MQTT_H_
+#define MQTT_H_
+
+#include <stdbool.h>
+
+// shadow over MQTT on 8883, builds that poll it over HTTPS pass -DENABLE_MQTT=0
+#ifndef ENABLE_MQTT
+#define ENABLE_MQTT 1
+#endif
+
+#define MQTT_PORT          8883
+#define MQTT_BUFFER_SIZE   2048 // largest packet kept, bigger ones are skipped, a whole get/accepted document fits
+#define MQTT_KEEPALIVE     60   // seconds the broker waits for a packet
+#define MQTT_PING_POLLS    900  // ~30 s when polled every frame
+#define MQTT_CONNECT_POLLS 300  // ~10 s for the CONNACK before giving up
+
+typedef void (*MqttCallback)(const char *topic, int topicLength,
+                             const char *payload, int payloadLength, void *arg);
+
+// sends CONNECT, packets can follow without waiting for the CONNACK
+bool mqttConnect(int sock, const char *clientId, MqttCallback onMessage, void *arg);
+bool mqttSubscribe(const char *topic);
+bool mqttPublish(const char *topic, const char *payload, int length);
+// reads what has arrived without blocking, delivers messages and keeps
+// the connection alive, call it once per frame
+void mqttPoll(void);
+bool mqttConnected(void);
+// false once the connection failed or was dropped, the socket is then
+// left for the caller to close and connect again
+bool mqttAlive(void);
+
+#endif /* MQTT_H_ */
@@ -0,0 +1,126 @@
+/*
+ * profiler.c
+ *
+ *  Per phase frame timing on the SysTick counter
+ */
+
+#include <stdbool.h>
+
+// Driverlib includes
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "hw_ints.h"
+#include "rom.h"
+#include "rom_map.h"
+#include "systick.h"
+#include "uart.h"
+
+// Common interface includes
+#include "uart_if.h"
+
+#include "profiler.h"
+
+#define SYSTICK_MASK  0x00FFFFFF // 24 bit down counter, wraps every ~209 ms
+#define CYCLES_PER_US 80
+
+typedef struct ProfStats {
+    unsigned long count;
+    unsigned long min, max;
+    unsigned long long sum;
+    unsigned short hist[PROF_BUCKETS];
+} ProfStats;
+
+static ProfStats stats[PROF_PHASES];
+static const char *phaseNames[PROF_PHASES] = {
+    "frame", "input", "net_recv", "net_send", "logic", "render", "flush", "sound"
+};
+
+void InitProfiler(void) {
+    MAP_SysTickPeriodSet(SYSTICK_MASK + 1);
+    MAP_SysTickEnable();
+    profReset();
+}
+
+unsigned long profBegin(void) {
+    return MAP_SysTickValueGet();
+}
+
+// 0-3 us get their own bucket, after that four buckets per power of two
+static int bucketOf(unsigned long us) {
+    int octave = 0, b;
+    if (us < 4) return us;
+    while ((us >> octave) >= 8) octave++;
+    b = 4 + octave * 4 + ((us >> octave) - 4);
+    return b < PROF_BUCKETS ? b : PROF_BUCKETS - 1;
+}
+
+// largest value that lands in bucket b
+static unsigned long bucketTop(int b) {
+    int octave, sub;
+    if (b < 4) return b;
+    octave = (b - 4) / 4;
+    sub = (b - 4) % 4;
+    return ((unsigned long) (5 + sub) << octave) - 1;
+}
+
+void profEnd(ProfPhase phase, unsigned long start) {
+    ProfStats *s = &stats[phase];
+    unsigned long us = ((start - MAP_SysTickValueGet()) & SYSTICK_MASK) / CYCLES_PER_US;
+    int b = bucketOf(us);
+
+    if (s->count == 0 || us < s->min) s->min = us;
+    if (us > s->max) s->max = us;
+    s->sum += us;
+    s->count++;
+    if (s->hist[b] != 0xFFFF) s->hist[b]++;
+}
+
+void profReset(void) {
+    int i, b;
+    for (i = 0; i < PROF_PHASES; i++) {
+        stats[i].count = 0;
+        stats[i].min = stats[i].max = 0;
+        stats[i].sum = 0;
+        for (b = 0; b < PROF_BUCKETS; b++) {
+            stats[i].hist[b] = 0;
+        }
+    }
+}
+
+// upper bound of the bucket holding the 99th percentile sample
+static unsigned long percentile99(ProfStats *s) {
+    unsigned long want = s->count - s->count / 100, seen = 0;
+    int b;
+    for (b = 0; b < PROF_BUCKETS; b++) {
+        seen += s->hist[b];
+        if (seen >= want) return bucketTop(b);
+    }
+    return s->max;
+}
+
+void profDump(void) {
+    int i;
+    Report("phase       count     min     avg    p99<     max (us)\n\r");
+    for (i = 0; i < PROF_PHASES; i++) {
+        ProfStats *s = &stats[i];
+        if (s->count == 0) continue;
+        Report("%-9s %7lu %7lu %7lu %7lu %7lu\n\r", phaseNames[i], s->count, s->min,
+               (unsigned long) (s->sum / s->count), percentile99(s), s->max);
+    }
+}
+
+int profPoll(void) {
+    long key;
+    if (!MAP_UARTCharsAvail(CONSOLE)) return -1;
+    key = MAP_UARTCharGetNonBlocking(CONSOLE);
+    switch (key) {
+        case 'p':
+            profDump();
+            return -1;
+        case 'r':
+            profReset();
+            Report("profiler reset\n\r");
+            return -1;
+    }
+    return key;
+}
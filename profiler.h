@@ -0,0 +1,45 @@
+/*
+ * profiler.h
+ *
+ *  Per phase frame timing. Each phase keeps min/max/sum and a log scale
+ *  histogram in fixed RAM, profDump() prints them over the UART console.
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+// off in release firmware, profiling builds pass -DENABLE_PROFILER=1
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0
+#endif
+
+#define PROF_BUCKETS 72 // 4 linear buckets, then 4 per power of two
+
+typedef enum {
+    PROF_FRAME = 0, // whole tick, logic through flush
+    PROF_INPUT,     // draining the accelerometer samples
+    PROF_NET_RECV,  // networkReceive and parsing
+    PROF_NET_SEND,  // sendRequest / receiveString
+    PROF_LOGIC,     // gameStep, includes the input/net/render it calls out to
+    PROF_RENDER,    // tile compositing and score
+    PROF_FLUSH,     // queueing the framebuffer flush
+    PROF_SOUND,     // updateSoundModules
+    PROF_PHASES
+} ProfPhase;
+
+void InitProfiler(void);
+unsigned long profBegin(void);
+void profEnd(ProfPhase phase, unsigned long start);
+void profReset(void);
+void profDump(void);
+int profPoll(void); // 'p' on the console dumps, 'r' resets, returns any other key or -1
+
+#if ENABLE_PROFILER == 1
+#define PROF_SCOPE_BEGIN(phase) unsigned long phase##_start = profBegin()
+#define PROF_SCOPE_END(phase)   profEnd(phase, phase##_start)
+#else
+#define PROF_SCOPE_BEGIN(phase)
+#define PROF_SCOPE_END(phase)
+#endif
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,150 @@
+/*
+ * replay.c
+ *
+ *  Ring buffer input recorder and its playback reader
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "replay.h"
+
+#define MAX_QUEUE 15 // longest direction string a queue record holds
+#define RING(i)   ((i) & (REPLAY_BUFFER_SIZE - 1))
+
+static unsigned char ring[REPLAY_BUFFER_SIZE];
+static unsigned int head = 0, tail = 0; // free running, head - tail bytes are in use
+static int lastX = 0, lastY = 0;
+
+// size of a whole record from its first two bytes
+static int recordLength(unsigned char tag, unsigned char info) {
+    switch (tag) {
+        case REC_LEVEL: return 5;
+        case REC_ACCEL: return 3;
+        case REC_QUEUE: return 2 + (info & 0xF);
+        default:        return 1;
+    }
+}
+
+static void append(const unsigned char *rec, int n) {
+    int i;
+    // drop whole records from the old end so the log always starts on a tag
+    while (REPLAY_BUFFER_SIZE - (head - tail) < (unsigned int) n) {
+        tail += recordLength(ring[RING(tail)], ring[RING(tail + 1)]);
+    }
+    for (i = 0; i < n; i++) {
+        ring[RING(head + i)] = rec[i];
+    }
+    head += n;
+}
+
+void replayReset(void) {
+    head = tail = 0;
+    lastX = lastY = 0;
+}
+
+void replayLevel(unsigned long seed) {
+    unsigned char rec[5] = { REC_LEVEL, seed, seed >> 8, seed >> 16, seed >> 24 };
+    append(rec, 5);
+    lastX = lastY = 0;
+}
+
+void replayAccel(int xVel, int yVel) {
+    unsigned char rec[3] = { REC_ACCEL, xVel - lastX, yVel - lastY };
+    if (xVel == lastX && yVel == lastY) {
+        rec[0] = REC_HOLD;
+        append(rec, 1);
+        return;
+    }
+    append(rec, 3);
+    lastX = xVel;
+    lastY = yVel;
+}
+
+void replayQueue(int tick, int id, const char *dirs) {
+    unsigned char rec[2 + MAX_QUEUE];
+    int n = strlen(dirs);
+    if (n > MAX_QUEUE) n = MAX_QUEUE;
+    rec[0] = REC_QUEUE;
+    rec[1] = (tick << 6) | (id << 4) | n;
+    memcpy(&rec[2], dirs, n);
+    append(rec, 2 + n);
+}
+
+int replaySize(void) {
+    return head - tail;
+}
+
+int replayCopy(unsigned char *out, int offset, int max) {
+    int i, n = (int) (head - tail) - offset;
+    if (n > max) n = max;
+    for (i = 0; i < n; i++) {
+        out[i] = ring[RING(tail + offset + i)];
+    }
+    return n > 0 ? n : 0;
+}
+
+void replayOpen(ReplayReader *reader, const unsigned char *data, int length) {
+    reader->data = data;
+    reader->length = length;
+    reader->pos = 0;
+    reader->xVel = reader->yVel = 0;
+}
+
+static unsigned char peek(ReplayReader *reader, int offset) {
+    return reader->pos + offset < reader->length ? reader->data[reader->pos + offset] : 0;
+}
+
+static bool skip(ReplayReader *reader) {
+    int n = recordLength(peek(reader, 0), peek(reader, 1));
+    if (reader->pos + n > reader->length) {
+        reader->pos = reader->length;
+        return false;
+    }
+    reader->pos += n;
+    return true;
+}
+
+bool replayNextLevel(ReplayReader *reader, unsigned long *seed) {
+    while (reader->pos < reader->length && peek(reader, 0) != REC_LEVEL) {
+        skip(reader);
+    }
+    if (reader->pos + 5 > reader->length) return false;
+    *seed = peek(reader, 1) | (unsigned long) peek(reader, 2) << 8 |
+            (unsigned long) peek(reader, 3) << 16 | (unsigned long) peek(reader, 4) << 24;
+    reader->xVel = reader->yVel = 0;
+    reader->pos += 5;
+    return true;
+}
+
+bool replayNextAccel(ReplayReader *reader, int *xVel, int *yVel) {
+    while (peek(reader, 0) == REC_QUEUE) { // commands nobody picked up
+        skip(reader);
+    }
+    switch (peek(reader, 0)) {
+        case REC_ACCEL:
+            if (reader->pos + 3 > reader->length) return false;
+            reader->xVel += (signed char) peek(reader, 1);
+            reader->yVel += (signed char) peek(reader, 2);
+            break;
+        case REC_HOLD:
+            break;
+        default: // end of the log or of the level
+            return false;
+    }
+    skip(reader);
+    *xVel = reader->xVel;
+    *yVel = reader->yVel;
+    return true;
+}
+
+bool replayNextQueue(ReplayReader *reader, int tick, int *id, char *dirs) {
+    int n = peek(reader, 1) & 0xF;
+    if (peek(reader, 0) != REC_QUEUE || (peek(reader, 1) >> 6) != tick ||
+        reader->pos + 2 + n > reader->length) return false;
+    *id = (peek(reader, 1) >> 4) & 0x3;
+    memcpy(dirs, &reader->data[reader->pos + 2], n);
+    dirs[n] = '\0';
+    reader->pos += 2 + n;
+    return true;
+}
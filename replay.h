@@ -0,0 +1,49 @@
+/*
+ * replay.h
+ *
+ *  Input log for reproducing a session. Every level start, accelerometer
+ *  read and applied network command is appended to a RAM ring buffer as a
+ *  compact record, oldest records are dropped when it fills up. Feeding
+ *  the records back through a ReplayReader with the same level seed
+ *  replays the game tick for tick, host/sim -r does that with a dump.
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdbool.h>
+
+// off in release firmware, debug builds pass -DENABLE_REPLAY=1
+#ifndef ENABLE_REPLAY
+#define ENABLE_REPLAY 0
+#endif
+
+#define REPLAY_BUFFER_SIZE 4096 // bytes, power of two
+
+// record tags, each is followed by its payload
+#define REC_LEVEL 0x01 // 4 byte seed, little endian
+#define REC_ACCEL 0x02 // x and y change since the last read, signed bytes
+#define REC_HOLD  0x03 // read came back the same as the last one
+#define REC_QUEUE 0x04 // tick << 6 | id << 4 | length, then the queued directions
+
+void replayReset(void);
+void replayLevel(unsigned long seed);
+void replayAccel(int xVel, int yVel);
+void replayQueue(int tick, int id, const char *dirs); // tick is Game.inputTimer, 0 to 3
+int replaySize(void);
+int replayCopy(unsigned char *out, int offset, int max); // offset 0 is the oldest byte, returns the bytes copied
+
+typedef struct ReplayReader {
+    const unsigned char *data;
+    int length, pos;
+    int xVel, yVel; // last read, accel records are relative to it
+} ReplayReader;
+
+// playback, each call consumes one record of the asked for kind
+void replayOpen(ReplayReader *reader, const unsigned char *data, int length);
+bool replayNextLevel(ReplayReader *reader, unsigned long *seed); // skips ahead to the next level
+bool replayNextAccel(ReplayReader *reader, int *xVel, int *yVel);
+// false once the next record is no queue applied on this tick
+bool replayNextQueue(ReplayReader *reader, int tick, int *id, char *dirs);
+
+#endif /* REPLAY_H_ */
@@ -0,0 +1,86 @@
+/*
+ * request.c
+ *
+ *  Shadow update serializer
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "request.h"
+
+static char request[REQUEST_SIZE]; // POST being built, headers and all
+static int requestLength = 0;      // write cursor, 0 until the first field
+static bool firstElem = true;
+
+static void append(const char *text, int length) {
+    memcpy(&request[requestLength], text, length);
+    requestLength += length;
+}
+
+// starts from the constant headers
+static void beginRequest(void) {
+    memcpy(request, POST_HEAD DATA_PREF, sizeof(POST_HEAD DATA_PREF) - 1);
+    requestLength = sizeof(POST_HEAD DATA_PREF) - 1;
+    firstElem = true;
+}
+
+// writes the body length right aligned into the Content-Length slot
+static void patchContentLength(int length) {
+    char *slot = &request[sizeof(POST_HEAD) - 1 - strlen(CLHEADER2) - CL_DIGITS];
+    int i = CL_DIGITS - 1;
+    do {
+        slot[i--] = '0' + length % 10;
+        length /= 10;
+    } while (length > 0 && i >= 0);
+    while (i >= 0) {
+        slot[i--] = ' '; // optional whitespace after the colon
+    }
+}
+
+bool buildRequest(char *var, char *text) {
+    int varLength = strlen(var), textLength = strlen(text);
+    int need;
+
+    if (requestLength == 0) {
+        beginRequest();
+    }
+    need = (firstElem ? 0 : 3) + varLength + textLength + 6; // the comma only after the first field
+    if (requestLength + need > REQUEST_SIZE - (int) (sizeof(DATA_SUFF) - 1)) {
+        return false;
+    }
+    if (!firstElem) {
+        append(",\r\n", 3);
+    }
+    append("\"", 1);
+    append(var, varLength);
+    append("\": \"", 4);
+    append(text, textLength);
+    append("\"", 1);
+    firstElem = false;
+    return true;
+}
+
+bool requestStarted(void) {
+    return requestLength != 0;
+}
+
+int finishRequest(const char **out) {
+    int length;
+    if (requestLength == 0) { // nothing was built, still send an empty update
+        beginRequest();
+    }
+    // close the body, buildRequest always leaves room for the suffix
+    append(DATA_SUFF, sizeof(DATA_SUFF) - 1);
+    patchContentLength(requestLength - (sizeof(POST_HEAD) - 1));
+    length = requestLength;
+    requestLength = 0;
+    *out = request;
+    return length;
+}
+
+int finishBody(const char **out) {
+    int length = finishRequest(out) - (sizeof(POST_HEAD) - 1);
+    *out += sizeof(POST_HEAD) - 1; // the HTTP headers in front of it are skipped
+    return length;
+}
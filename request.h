@@ -0,0 +1,42 @@
+/*
+ * request.h
+ *
+ *  Shadow update built in one fixed buffer with a write cursor. The
+ *  constant header block goes in first and fields are appended behind it,
+ *  Content-Length is patched into its space padded slot once the body is
+ *  closed. Nothing here touches the network, aws_if sends the result.
+ */
+
+#ifndef REQUEST_H_
+#define REQUEST_H_
+
+#include <stdbool.h>
+
+#define POSTHEADER "POST /things/CC3200_Thing/shadow HTTP/1.1\r\n"
+#define GETHEADER "GET /things/CC3200_Thing/shadow HTTP/1.1\r\n"
+#define HOSTHEADER "Host: a1euv4eww1wx8z-ats.iot.us-west-2.amazonaws.com\r\n"
+#define CHEADER "Connection: Keep-Alive\r\n"
+#define CTHEADER "Content-Type: application/json; charset=utf-8\r\n"
+#define CLHEADER1 "Content-Length: "
+#define CLHEADER2 "\r\n\r\n"
+
+#define DATA_PREF "{\"state\": {\r\n\"desired\" : {\r\n"
+#define DATA_SUFF "\r\n}}}\r\n\r\n"
+
+#define REQUEST_SIZE 512
+#define CL_DIGITS    4
+#define CL_SLOT      "    " // CL_DIGITS spaces
+#define POST_HEAD    POSTHEADER HOSTHEADER CHEADER CTHEADER CLHEADER1 CL_SLOT CLHEADER2
+#define GET_REQUEST  GETHEADER HOSTHEADER CHEADER "\r\n"
+
+// adds "var": "text" to the body, fields that would not fit are dropped
+// and return false
+bool buildRequest(char *var, char *text);
+bool requestStarted(void); // a field was added since the last finish
+// closes the body and hands back the whole POST, an empty update when
+// nothing was built; the next buildRequest starts a new one
+int finishRequest(const char **out);
+// same, but only the JSON document without the HTTP headers
+int finishBody(const char **out);
+
+#endif /* REQUEST_H_ */
@@ -0,0 +1,38 @@
+/*
+ * rng.c
+ *
+ *  xorshift32 pseudo random numbers
+ */
+
+#include "rng.h"
+
+void rngSeed(Rng *rng, unsigned long seed) {
+    rng->state = seed & 0xFFFFFFFF;
+    if (rng->state == 0) {
+        rng->state = 0x9E3779B9; // xorshift gets stuck on zero
+    }
+}
+
+void rngSeedStream(Rng *rng, unsigned long seed, unsigned int n) {
+    // murmur3 finalizer over seed and stream, nearby seeds end up far apart
+    unsigned long h = (seed + (n + 1) * 0x9E3779B9UL) & 0xFFFFFFFF;
+    h ^= h >> 16;
+    h = (h * 0x85EBCA6BUL) & 0xFFFFFFFF;
+    h ^= h >> 13;
+    h = (h * 0xC2B2AE35UL) & 0xFFFFFFFF;
+    h ^= h >> 16;
+    rngSeed(rng, h);
+}
+
+unsigned long rngNext(Rng *rng) {
+    unsigned long x = rng->state;
+    x ^= (x << 13) & 0xFFFFFFFF; // masked so a 64 bit long gives the same sequence
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xFFFFFFFF;
+    rng->state = x;
+    return x;
+}
+
+unsigned int rngRange(Rng *rng, unsigned int n) {
+    return rngNext(rng) % n;
+}
@@ -0,0 +1,21 @@
+/*
+ * rng.h
+ *
+ *  Small deterministic xorshift32 generator. The same seed always gives
+ *  the same sequence, on the board or on a host.
+ */
+
+#ifndef RNG_H_
+#define RNG_H_
+
+typedef struct Rng {
+    unsigned long state; // never zero
+} Rng;
+
+void rngSeed(Rng *rng, unsigned long seed);
+// independent stream number n of a seed, so entities don't share a sequence
+void rngSeedStream(Rng *rng, unsigned long seed, unsigned int n);
+unsigned long rngNext(Rng *rng);
+unsigned int rngRange(Rng *rng, unsigned int n); // 0 to n - 1
+
+#endif /* RNG_H_ */
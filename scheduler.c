@@ -0,0 +1,88 @@
+/*
+ * scheduler.c
+ *
+ *  Fixed timestep scheduler with integer deadlines on the slow clock
+ */
+
+#include <stdbool.h>
+
+// Driverlib includes
+#include "hw_types.h"
+#include "rom.h"
+#include "rom_map.h"
+#include "prcm.h"
+#include "utils.h"
+
+#include "scheduler.h"
+
+#define PERIOD_TICKS (SCHED_CLOCK_HZ / SCHED_FPS) // whole ticks per frame
+#define PERIOD_REM   (SCHED_CLOCK_HZ % SCHED_FPS) // leftover ticks, spread over SCHED_FPS frames
+#define LOOPS_PER_TICK 800 // UtilsDelay loops (3 cycles at 80 MHz) in one tick, rounded down
+
+static unsigned long long deadline; // slow clock tick the next frame is due at
+static unsigned int fraction;       // carried PERIOD_REM, in 1/SCHED_FPS ticks
+static unsigned int stepsDue;
+static unsigned long dropped;
+static bool resync;
+
+static void advance(void) {
+    deadline += PERIOD_TICKS;
+    fraction += PERIOD_REM;
+    if (fraction >= SCHED_FPS) {
+        fraction -= SCHED_FPS;
+        deadline++;
+    }
+}
+
+void InitScheduler(void) {
+    deadline = PRCMSlowClkCtrGet();
+    fraction = 0;
+    stepsDue = 0;
+    dropped = 0;
+    resync = false;
+}
+
+void schedBeginFrame(void) {
+    unsigned long long now = PRCMSlowClkCtrGet();
+
+    if (resync) {
+        deadline = now;
+        fraction = 0;
+        resync = false;
+    }
+
+    if (now < deadline) {
+        // coarse delay first, then poll the counter so we never oversleep
+        MAP_UtilsDelay((unsigned long) (deadline - now - 1) * LOOPS_PER_TICK + 1);
+        while (PRCMSlowClkCtrGet() < deadline);
+        now = deadline;
+    }
+
+    // one step for the deadline we just hit plus one for every period we are behind
+    stepsDue = 0;
+    while (deadline <= now && stepsDue < SCHED_MAX_STEPS) {
+        advance();
+        stepsDue++;
+    }
+    if (deadline <= now) { // too far behind, give up on the rest
+        while (deadline <= now) {
+            advance();
+            dropped++;
+        }
+    }
+}
+
+bool schedStep(void) {
+    if (stepsDue == 0) return false;
+    stepsDue--;
+    return true;
+}
+
+void schedResync(void) {
+    stepsDue = 0;
+    resync = true;
+}
+
+unsigned long schedDropped(void) {
+    return dropped;
+}
@@ -0,0 +1,25 @@
+/*
+ * scheduler.h
+ *
+ *  Fixed timestep frame pacing on the 32768 Hz slow clock. Deadlines are
+ *  kept in whole clock ticks with the fraction of a period carried over, so
+ *  30 frames always take exactly one second. Late frames are caught up by
+ *  running extra logic steps, up to SCHED_MAX_STEPS per frame.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdbool.h>
+
+#define SCHED_CLOCK_HZ  32768 // slow clock rate
+#define SCHED_FPS       30    // logic steps per second
+#define SCHED_MAX_STEPS 4     // logic steps run in one frame before lag is dropped
+
+void InitScheduler(void);
+void schedBeginFrame(void); // sleeps until the next deadline and works out the steps due
+bool schedStep(void);       // true while a logic step is still due this frame
+void schedResync(void);     // drop any lag, e.g. after a long level setup
+unsigned long schedDropped(void); // steps given up on since init
+
+#endif /* SCHEDULER_H_ */
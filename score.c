@@ -0,0 +1,37 @@
+/*
+ * score.c
+ *
+ *  Score readout that repaints only the digits that changed
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "score.h"
+
+static char drawnScore[SCORE_DIGITS + 1] = ""; // digits currently shown on the panel
+
+void drawScore(int score) {
+    char digits[SCORE_DIGITS + 1];
+    int i, len;
+
+    sprintf(digits, "%d", score);
+    len = strlen(drawnScore); // before the loop writes over the terminator
+    // only repaint the digit cells that changed, usually just the last one
+    for (i = 0; digits[i] != '\0'; i++) {
+        if (i >= len || digits[i] != drawnScore[i]) {
+            drawChar(SCORE_X + i * 6, SCORE_Y, digits[i], SCORE_COLOR, SCORE_BG_COLOR, 1);
+            drawnScore[i] = digits[i];
+        }
+    }
+    if (len > i) { // score got shorter, clear the leftover cells
+        fillRect(SCORE_X + i * 6, SCORE_Y, (len - i) * 6, 8, SCORE_BG_COLOR);
+    }
+    drawnScore[i] = '\0';
+}
+
+void forgetScore(void) {
+    drawnScore[0] = '\0';
+}
@@ -0,0 +1,20 @@
+/*
+ * score.h
+ *
+ *  Score readout in the top left corner. It remembers the digits on the
+ *  panel and repaints only the cells that changed, each as one glyph blit.
+ */
+
+#ifndef SCORE_H_
+#define SCORE_H_
+
+#define SCORE_X        12
+#define SCORE_Y        4
+#define SCORE_COLOR    0xFFFF
+#define SCORE_BG_COLOR 0x0000
+#define SCORE_DIGITS   11 // a negative int at most
+
+void drawScore(int score);
+void forgetScore(void); // the screen was redrawn, the next score goes out whole
+
+#endif /* SCORE_H_ */
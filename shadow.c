@@ -0,0 +1,109 @@
+/*
+ * shadow.c
+ *
+ *  Perfect hash from shadow keys to typed fields
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "shadow.h"
+
+// (key[1] + 4 * length) & 15 is unique over the nine keys, the slot still
+// has to match the whole key to reject anything else
+#define SHADOW_HASH(key, length) (((unsigned char) (key)[1] + ((length) << 2)) & 15)
+
+typedef struct {
+    const char *name;
+    unsigned char length;
+    unsigned char field;
+} ShadowKey;
+
+static const ShadowKey slots[16] = {
+    [1]  = { "b1_q", 4, SHADOW_B1_Q },
+    [2]  = { "b2_q", 4, SHADOW_B2_Q },
+    [3]  = { "b3_q", 4, SHADOW_B3_Q },
+    [4]  = { "b4_q", 4, SHADOW_B4_Q },
+    [9]  = { "b1_loc", 6, SHADOW_B1_LOC },
+    [10] = { "b2_loc", 6, SHADOW_B2_LOC },
+    [11] = { "b3_loc", 6, SHADOW_B3_LOC },
+    [12] = { "b4_loc", 6, SHADOW_B4_LOC },
+    [13] = { "pac_loc", 7, SHADOW_PAC_LOC },
+};
+
+void shadowClear(ShadowState *state) {
+    memset(state, 0, sizeof(*state));
+}
+
+// reads a signed decimal, returns the index after it or -1 without digits
+static int readInt(const char *text, int i, int length, int *out) {
+    bool negative = false;
+    int start, value = 0;
+    while (i < length && text[i] == ' ') {
+        i++;
+    }
+    if (i < length && text[i] == '-') {
+        negative = true;
+        i++;
+    }
+    start = i;
+    while (i < length && text[i] >= '0' && text[i] <= '9') {
+        value = value * 10 + (text[i++] - '0');
+    }
+    if (i == start) {
+        return -1;
+    }
+    *out = negative ? -value : value;
+    return i;
+}
+
+// locations are sent as "x y"
+static bool readLoc(const char *text, int length, ShadowLoc *loc) {
+    int i = readInt(text, 0, length, &loc->x);
+    return i >= 0 && readInt(text, i, length, &loc->y) >= 0;
+}
+
+// queues are directions '0' to '3' that fit a dirQueue, anything else
+// would be dropped or index past validMoves
+static bool validQueue(const char *text, int length) {
+    int i;
+    if (length > SHADOW_QUEUE_SIZE - 1) {
+        return false;
+    }
+    for (i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '3') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void shadowStore(const char *key, int keyLength, const char *value, int valueLength, void *arg) {
+    ShadowState *state = arg;
+    const ShadowKey *slot;
+    int field, i;
+
+    if (keyLength < 4 || keyLength > 7) {
+        return;
+    }
+    slot = &slots[SHADOW_HASH(key, keyLength)];
+    if (slot->length != keyLength || memcmp(slot->name, key, keyLength) != 0) {
+        return;
+    }
+    field = slot->field;
+
+    if (field >= SHADOW_B1_Q) {
+        i = field - SHADOW_B1_Q;
+        if (valueLength == 5 && memcmp(value, "ready", 5) == 0) {
+            valueLength = 0; // nothing queued
+        } else if (!validQueue(value, valueLength)) {
+            return;
+        }
+        memcpy(state->badQueue[i], value, valueLength);
+        state->badQueue[i][valueLength] = '\0';
+    } else if (!readLoc(value, valueLength,
+                        field == SHADOW_PAC_LOC ? &state->pacLoc : &state->badLoc[field - SHADOW_B1_LOC])) {
+        return;
+    }
+    state->present |= 1 << field;
+}
@@ -0,0 +1,42 @@
+/*
+ * shadow.h
+ *
+ *  Typed view of the device shadow. The known keys are resolved while the
+ *  response is parsed, through a perfect hash on the key length and its
+ *  second character, so readers use the fields directly.
+ */
+
+#ifndef SHADOW_H_
+#define SHADOW_H_
+
+#include <stdbool.h>
+
+#include "game.h"
+
+#define SHADOW_QUEUE_SIZE 8 // same as a baddie's dirQueue
+
+typedef enum {
+    SHADOW_PAC_LOC = 0,
+    SHADOW_B1_LOC, SHADOW_B2_LOC, SHADOW_B3_LOC, SHADOW_B4_LOC,
+    SHADOW_B1_Q, SHADOW_B2_Q, SHADOW_B3_Q, SHADOW_B4_Q,
+    SHADOW_FIELDS
+} ShadowField;
+
+typedef struct ShadowLoc {
+    int x, y;
+} ShadowLoc;
+
+typedef struct ShadowState {
+    unsigned short present; // bit per ShadowField found since shadowClear
+    ShadowLoc pacLoc;
+    ShadowLoc badLoc[NUM_BADDIES];
+    char badQueue[NUM_BADDIES][SHADOW_QUEUE_SIZE]; // directions '0'-'3', empty for "ready"
+} ShadowState;
+
+#define SHADOW_HAS(state, field) (((state)->present >> (field)) & 1)
+
+void shadowClear(ShadowState *state);
+// JsonCallback that stores a known key into the ShadowState given as arg
+void shadowStore(const char *key, int keyLength, const char *value, int valueLength, void *arg);
+
+#endif /* SHADOW_H_ */
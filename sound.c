@@ -23,6 +23,8 @@
 #include "timer_if.h"
 #include "gpio.h"
 
+static void Tick_Timer_IF_Start(unsigned long ulBase, unsigned long ulTimer, unsigned long ulValue);
+
 static bool freqFlag = false, isGenerating = false;
 static char *empty = "";
 char *song = "";
@@ -27,6 +27,5 @@ void DeInitSoundModules();
 void updateSoundModules(void);
 
 void frequencyGenerator(void);
-static void Tick_Timer_IF_Start(unsigned long ulBase, unsigned long ulTimer, unsigned long ulValue);
 
 #endif /* SOUND_H_ */
@@ -0,0 +1,221 @@
+/*
+ * spi_dma.c
+ *
+ *  Descriptor queue feeding the GSPI TX uDMA channel
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+// Driverlib includes
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "hw_mcspi.h"
+#include "hw_ints.h"
+#include "gpio.h"
+#include "spi.h"
+#include "udma.h"
+#include "rom.h"
+#include "rom_map.h"
+#include "prcm.h"
+#include "interrupt.h"
+
+#include "Adafruit_SSD1351.h"
+#include "spi_dma.h"
+
+#define DMA_CHANNEL UDMA_CH31_GSPI_TX
+
+typedef struct DmaDesc {
+    const unsigned char *src;
+    unsigned long count;
+    unsigned long period; // non zero when src is a pattern to repeat
+    unsigned char dc;
+    unsigned char bytes[DMA_INLINE_SIZE]; // used when src is NULL
+    DmaDoneCallback done;
+    void *arg;
+} DmaDesc;
+
+// channel control table, the uDMA needs it 1024 byte aligned
+#if defined(ccs)
+#pragma DATA_ALIGN(dmaControlTable, 1024)
+static tDMAControlTable dmaControlTable[64];
+#elif defined(ewarm)
+#pragma data_alignment=1024
+static tDMAControlTable dmaControlTable[64];
+#else
+static tDMAControlTable dmaControlTable[64] __attribute__((aligned(1024)));
+#endif
+
+static DmaDesc queue[DMA_QUEUE_SIZE];
+static volatile unsigned int head = 0, tail = 0; // main pushes at head, ISR pops at tail
+static volatile bool busy = false;
+static unsigned long sentOfHead = 0; // bytes of queue[tail] already sent
+static unsigned long rxFlush;
+
+// programs the channel with the next chunk of queue[tail]
+static void startChunk(void) {
+    DmaDesc *desc = &queue[tail % DMA_QUEUE_SIZE];
+    const unsigned char *src = desc->src ? desc->src : desc->bytes;
+    unsigned long n = desc->count - sentOfHead;
+    unsigned long offset = sentOfHead;
+
+    if (desc->period) { // every chunk restarts at the top of the pattern
+        offset = 0;
+        if (n > desc->period) n = desc->period;
+    }
+    if (n > DMA_MAX_TRANSFER) n = DMA_MAX_TRANSFER;
+
+    GPIOPinWrite(GPIOA3_BASE, 0x10, desc->dc); // the previous chunk is fully out, safe to switch DC
+
+    MAP_SPIDisable(GSPI_BASE);
+    MAP_SPIWordCountSet(GSPI_BASE, n);
+    MAP_uDMAChannelTransferSet(DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+                               (void *) (src + offset),
+                               (void *) (GSPI_BASE + MCSPI_O_TX0), n);
+    MAP_uDMAChannelEnable(DMA_CHANNEL);
+    MAP_SPIEnable(GSPI_BASE);
+    sentOfHead += n;
+}
+
+static void startBus(void) {
+    busy = true;
+    sentOfHead = 0;
+    MAP_SPIDisable(GSPI_BASE);
+    MAP_SPIFIFOEnable(GSPI_BASE, SPI_TX_FIFO);
+    MAP_SPIDmaEnable(GSPI_BASE, SPI_TX_DMA);
+    MAP_SPICSEnable(GSPI_BASE);            // enable internal chip select
+    GPIOPinWrite(GPIOA1_BASE, 0x80, 0x00); // enable OC
+    startChunk();
+}
+
+static void stopBus(void) {
+    GPIOPinWrite(GPIOA1_BASE, 0x80, 0xff); // sets OC
+    MAP_SPICSDisable(GSPI_BASE);           // disable the internal chip select
+    MAP_SPIDisable(GSPI_BASE);
+    MAP_SPIDmaDisable(GSPI_BASE, SPI_TX_DMA);
+    MAP_SPIFIFODisable(GSPI_BASE, SPI_TX_FIFO);
+    MAP_SPIWordCountSet(GSPI_BASE, 0);
+    MAP_SPIEnable(GSPI_BASE);
+    // throw away whatever was clocked in so polled writes stay in step
+    while (MAP_SPIDataGetNonBlocking(GSPI_BASE, &rxFlush));
+    busy = false;
+}
+
+void InitSpiDma(void) {
+    MAP_PRCMPeripheralClkEnable(PRCM_UDMA, PRCM_RUN_MODE_CLK);
+    MAP_PRCMPeripheralReset(PRCM_UDMA);
+    MAP_uDMAEnable();
+    MAP_uDMAControlBaseSet(dmaControlTable);
+
+    MAP_uDMAChannelAssign(DMA_CHANNEL);
+    MAP_uDMAChannelAttributeDisable(DMA_CHANNEL, UDMA_ATTR_ALL);
+    MAP_uDMAChannelControlSet(DMA_CHANNEL | UDMA_PRI_SELECT,
+                              UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_1);
+
+    MAP_SPIFIFOLevelSet(GSPI_BASE, 1, 1);
+    MAP_SPIIntRegister(GSPI_BASE, SpiDmaIntHandler);
+    MAP_IntPrioritySet(INT_GSPI, DMA_INT_PRIORITY);
+    MAP_SPIIntEnable(GSPI_BASE, SPI_INT_EOW);
+    head = tail = 0;
+    busy = false;
+}
+
+void SpiDmaIntHandler(void) {
+    DmaDesc *desc = &queue[tail % DMA_QUEUE_SIZE];
+    unsigned long status = MAP_SPIIntStatus(GSPI_BASE, true);
+
+    MAP_SPIIntClear(GSPI_BASE, status);
+    if (!(status & SPI_INT_EOW)) return;
+
+    if (sentOfHead < desc->count) { // descriptor is longer than one transfer
+        startChunk();
+        return;
+    }
+    if (desc->done) {
+        desc->done(desc->arg);
+    }
+    tail++;
+    sentOfHead = 0;
+    if (tail != head) {
+        startChunk();
+    } else {
+        stopBus();
+    }
+}
+
+static void push(unsigned char dc, const unsigned char *src, unsigned long count,
+                 unsigned long period, DmaDoneCallback done, void *arg) {
+    DmaDesc *desc;
+
+    while (head - tail >= DMA_QUEUE_SIZE); // wait for a free slot
+    desc = &queue[head % DMA_QUEUE_SIZE];
+    desc->src = src;
+    desc->count = count;
+    desc->period = period;
+    desc->dc = dc;
+    desc->done = done;
+    desc->arg = arg;
+
+    MAP_IntMasterDisable();
+    head++;
+    if (!busy) {
+        startBus();
+    }
+    MAP_IntMasterEnable();
+}
+
+void spiDmaQueue(unsigned char dc, const unsigned char *src, unsigned long count,
+                 DmaDoneCallback done, void *arg) {
+    if (count == 0) {
+        if (done) done(arg);
+        return;
+    }
+    push(dc, src, count, 0, done, arg);
+}
+
+void spiDmaQueueRepeat(unsigned char dc, const unsigned char *pattern, unsigned long period,
+                       unsigned long count) {
+    if (count == 0 || period == 0 || period > DMA_MAX_TRANSFER) return;
+    push(dc, pattern, count, period, NULL, NULL);
+}
+
+void spiDmaQueueInline(unsigned char dc, const unsigned char *bytes, unsigned char count) {
+    DmaDesc *desc;
+
+    if (count == 0 || count > DMA_INLINE_SIZE) return;
+    while (head - tail >= DMA_QUEUE_SIZE); // wait for a free slot
+    desc = &queue[head % DMA_QUEUE_SIZE];
+    memcpy(desc->bytes, bytes, count);
+    push(dc, NULL, count, 0, NULL, NULL);
+}
+
+void spiDmaQueueWindow(int x, int y, int w, int h) {
+    unsigned char cmd, range[2];
+
+    cmd = SSD1351_CMD_SETCOLUMN;
+    range[0] = x;
+    range[1] = x + w - 1;
+    spiDmaQueueInline(DMA_COMMAND, &cmd, 1);
+    spiDmaQueueInline(DMA_DATA, range, 2);
+
+    cmd = SSD1351_CMD_SETROW;
+    range[0] = y;
+    range[1] = y + h - 1;
+    spiDmaQueueInline(DMA_COMMAND, &cmd, 1);
+    spiDmaQueueInline(DMA_DATA, range, 2);
+
+    cmd = SSD1351_CMD_WRITERAM;
+    spiDmaQueueInline(DMA_COMMAND, &cmd, 1);
+}
+
+bool spiDmaBusy(void) {
+    return busy;
+}
+
+int spiDmaFree(void) {
+    return DMA_QUEUE_SIZE - (head - tail);
+}
+
+void spiDmaWait(void) {
+    while (busy);
+}
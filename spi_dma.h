@@ -0,0 +1,45 @@
+/*
+ * spi_dma.h
+ *
+ *  Asynchronous uDMA transfers to the OLED over GSPI. Bursts are queued as
+ *  descriptors and drained in the background by the SPI end-of-word
+ *  interrupt, so the CPU can go back to game logic while pixels go out.
+ */
+
+#ifndef SPI_DMA_H_
+#define SPI_DMA_H_
+
+#include <stdbool.h>
+
+#define DMA_QUEUE_SIZE   64   // descriptors in flight, power of two
+#define DMA_MAX_TRANSFER 1024 // uDMA limit for one basic mode transfer
+#define DMA_INLINE_SIZE  4    // bytes that can be copied into a descriptor
+
+#define DMA_INT_PRIORITY INT_PRIORITY_LVL_0 // ahead of every timer, a late end of transfer stalls the queue
+
+#define DMA_COMMAND 0x00 // DC level for command bytes
+#define DMA_DATA    0xff // DC level for data bytes
+
+typedef void (*DmaDoneCallback)(void *arg);
+
+void InitSpiDma(void);
+
+// queues count bytes from src, src must stay untouched until done is called
+void spiDmaQueue(unsigned char dc, const unsigned char *src, unsigned long count,
+                 DmaDoneCallback done, void *arg);
+// queues count bytes made of pattern repeated back to back, period is the
+// pattern length in bytes and at most DMA_MAX_TRANSFER
+void spiDmaQueueRepeat(unsigned char dc, const unsigned char *pattern, unsigned long period,
+                       unsigned long count);
+// queues up to DMA_INLINE_SIZE bytes that are copied into the descriptor
+void spiDmaQueueInline(unsigned char dc, const unsigned char *bytes, unsigned char count);
+// queues the SETCOLUMN/SETROW/WRITERAM sequence for a window
+void spiDmaQueueWindow(int x, int y, int w, int h);
+
+bool spiDmaBusy(void);
+int spiDmaFree(void); // descriptors that can be queued without waiting
+void spiDmaWait(void);
+
+void SpiDmaIntHandler(void);
+
+#endif /* SPI_DMA_H_ */
@@ -43,8 +43,8 @@ void delay(unsigned long ulCount){
 
 //*****************************************************************************
 void testfastlines(unsigned int color1, unsigned int color2) {
-	unsigned int x;
-	unsigned int y;
+	int x;
+	int y;
 
    fillScreen(BLACK);
    for (y=0; y < height()-1; y+=8) {
@@ -60,7 +60,7 @@ void testfastlines(unsigned int color1, unsigned int color2) {
 //*****************************************************************************
 
 void testdrawrects(unsigned int color) {
-	unsigned int x;
+	int x;
 
  fillScreen(BLACK);
  for (x=0; x < height()-1; x+=6) {
@@ -157,8 +157,8 @@ void testroundrects() {
 
 //*****************************************************************************
 void testlines(unsigned int color) {
-	unsigned int x;
-	unsigned int y;
+	int x;
+	int y;
 
    fillScreen(BLACK);
    for (x=0; x < width()-1; x+=6) {
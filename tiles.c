@@ -0,0 +1,159 @@
+/*
+ * tiles.c
+ *
+ *  Renders the map grid as 4x4 pixel tiles
+ */
+
+#include <stdbool.h>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_SSD1351.h"
+#include "framebuffer.h"
+#include "map.h"
+#include "tiles.h"
+
+// pellets are a 2x2 dot in the middle of their tile
+#define PELLET_SIZE  (TILE_SIZE / 2)
+#define PELLET_START (TILE_SIZE / 2 - PELLET_SIZE / 2)
+
+typedef struct Sprite {
+    int x, y;
+    unsigned int color;
+    bool visible;
+} Sprite;
+
+static Sprite sprites[MAX_SPRITES];
+static unsigned long dirtyTiles[MAP_SIZE]; // one bit per column for every row
+
+// color of pixel (px, py) inside tile (tx, ty)
+static unsigned int tilePixel(int tx, int ty, int px, int py) {
+    if (IS_WALL(tx, ty)) {
+        return WALL_COLOR;
+    }
+    if (HAS_PELLET(tx, ty) &&
+        px >= PELLET_START && px < PELLET_START + PELLET_SIZE &&
+        py >= PELLET_START && py < PELLET_START + PELLET_SIZE) {
+        return POINT_COLOR;
+    }
+    return 0x0000;
+}
+
+// renders pixel row y of the whole maze in panel order
+static void renderMazeRow(int y, unsigned char *row) {
+    int i, px;
+    unsigned int color;
+    for (i = 0; i < MAP_SIZE; i++) {
+        for (px = 0; px < TILE_SIZE; px++) {
+            color = tilePixel(i, y / TILE_SIZE, px, y % TILE_SIZE);
+            *row++ = color >> 8;
+            *row++ = color;
+        }
+    }
+}
+
+// draws walls and pellets as one full screen window, row by row
+void drawMaze(void) {
+    static unsigned char row[WIDTH * 2];
+    int y;
+
+    if (isFrameBufferEnabled()) {
+        for (y = 0; y < HEIGHT; y++) {
+            renderMazeRow(y, row);
+            fbBlit(0, y, WIDTH, 1, row);
+        }
+        return;
+    }
+
+    beginWindow(0, 0, WIDTH, HEIGHT);
+    for (y = 0; y < HEIGHT; y++) {
+        renderMazeRow(y, row);
+        pushPixels(row, WIDTH);
+    }
+    endWindow();
+}
+
+void resetSprites(void) {
+    int i;
+    for (i = 0; i < MAX_SPRITES; i++) {
+        sprites[i].visible = false;
+    }
+    for (i = 0; i < MAP_SIZE; i++) {
+        dirtyTiles[i] = 0;
+    }
+}
+
+void markTileDirty(int tx, int ty) {
+    if (tx < 0 || ty < 0 || tx >= MAP_SIZE || ty >= MAP_SIZE) return;
+    dirtyTiles[ty] |= 1UL << tx;
+}
+
+// marks every tile under a sprite sized box at (x, y)
+static void markSpriteTiles(int x, int y) {
+    int tx, ty;
+    for (ty = y / TILE_SIZE; ty <= (y + SPRITE_SIZE - 1) / TILE_SIZE; ty++) {
+        for (tx = x / TILE_SIZE; tx <= (x + SPRITE_SIZE - 1) / TILE_SIZE; tx++) {
+            markTileDirty(tx, ty);
+        }
+    }
+}
+
+void setSprite(int id, int x, int y, unsigned int color) {
+    Sprite *sprite = &sprites[id];
+    if (sprite->visible && sprite->x == x && sprite->y == y && sprite->color == color) {
+        return; // nothing moved
+    }
+    if (sprite->visible) {
+        markSpriteTiles(sprite->x, sprite->y); // old spot gets its tiles back
+    }
+    sprite->x = x;
+    sprite->y = y;
+    sprite->color = color;
+    sprite->visible = true;
+    markSpriteTiles(x, y);
+}
+
+// color of screen pixel (x, y): the tile under it, then any sprite on top
+static unsigned int composePixel(int x, int y) {
+    int i;
+    unsigned int color = tilePixel(x / TILE_SIZE, y / TILE_SIZE, x % TILE_SIZE, y % TILE_SIZE);
+    for (i = 0; i < MAX_SPRITES; i++) {
+        if (sprites[i].visible &&
+            x >= sprites[i].x && x < sprites[i].x + SPRITE_SIZE &&
+            y >= sprites[i].y && y < sprites[i].y + SPRITE_SIZE) {
+            color = sprites[i].color;
+        }
+    }
+    return color;
+}
+
+// recomposes the dirty tiles, each horizontal run of them goes out as one block
+void composeTiles(void) {
+    static unsigned char block[WIDTH * TILE_SIZE * 2];
+    int tx, ty, start, x, y;
+    unsigned char *p;
+    unsigned int color;
+
+    for (ty = 0; ty < MAP_SIZE; ty++) {
+        tx = 0;
+        while (dirtyTiles[ty] != 0 && tx < MAP_SIZE) {
+            if (!(dirtyTiles[ty] & (1UL << tx))) {
+                tx++;
+                continue;
+            }
+            start = tx;
+            while (tx < MAP_SIZE && (dirtyTiles[ty] & (1UL << tx))) {
+                dirtyTiles[ty] &= ~(1UL << tx);
+                tx++;
+            }
+            p = block;
+            for (y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; y++) {
+                for (x = start * TILE_SIZE; x < tx * TILE_SIZE; x++) {
+                    color = composePixel(x, y);
+                    *p++ = color >> 8;
+                    *p++ = color;
+                }
+            }
+            drawImage(start * TILE_SIZE, ty * TILE_SIZE, (tx - start) * TILE_SIZE, TILE_SIZE, block);
+        }
+    }
+}
@@ -0,0 +1,26 @@
+/*
+ * tiles.h
+ *
+ *  Renders the map grid as 4x4 pixel tiles
+ */
+
+#ifndef TILES_H_
+#define TILES_H_
+
+#include "Adafruit_GFX.h"
+#include "map.h"
+
+#define TILE_SIZE (WIDTH / MAP_SIZE)
+
+#define SPRITE_SIZE 4
+#define MAX_SPRITES 5 // the pac and four baddies, later ids draw on top
+
+void drawMaze(void);
+
+// sprites are composited over the tiles, only tiles they touched get resent
+void resetSprites(void);
+void setSprite(int id, int x, int y, unsigned int color);
+void markTileDirty(int tx, int ty);
+void composeTiles(void);
+
+#endif /* TILES_H_ */